@@ -36,7 +36,7 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 namespace lsst {
@@ -57,6 +57,11 @@ namespace logging {
  * the number of swaps, the number of block input operations, and the number 
  * of output operations.  Which of these are save with the log message 
  * is controlled by a bit map.  
+ *
+ * When LogRecord::setMonotonicStamps() has been turned on, the start and 
+ * end messages carry the MONOTONIC property like all other records; the 
+ * time spent in the block should then be computed from these rather than
+ * from the TIMESTAMPs, which move with adjustments to the system clock.
  */
 class BlockTimingLog : public Log {
 public:
@@ -275,19 +280,7 @@ public:
      * Indicate that the section of code being traced (e.g. a function body)
      * is starting.
      */
-    void start() {
-        if (sends(_tracelev)) {
-            std::string msg("Starting ");
-            msg += _funcName;
-
-            LogRecord rec(getThreshold(), _tracelev, getPreamble(), 
-                          willShowAll());
-            rec.addComment(msg);
-            rec.addProperty(STATUS, START);
-            if (_usageFlags) addUsageProps(rec);
-            send(rec);
-        }
-    }
+    void start();
 
     /**
      * Indicate that the section of code being instrumented (e.g. a function body)
@@ -302,19 +295,7 @@ public:
      * Indicate that the section of code being instrumented (e.g. a function body)
      * is finished.
      */
-    void done() {
-        if (sends(_tracelev)) {
-            std::string msg("Ending ");
-            msg += _funcName;
-
-            LogRecord rec(getThreshold(), _tracelev, getPreamble(), 
-                          willShowAll());
-            rec.addComment(msg);
-            rec.addProperty(STATUS, END);
-            if (_usageFlags) addUsageProps(rec);
-            send(rec);
-        }
-    }
+    void done();
 
     /**
      * return the instrumenting message level, the importance to be given to the 
@@ -334,11 +315,29 @@ public:
      */
     void addUsageProps(LogRecord& rec);
 
+    /**
+     * allocate the memory for a BlockTimingLog, reusing that of one 
+     * previously deleted in the calling thread if possible.
+     */
+    static void *operator new(std::size_t size);
+
+    /**
+     * release the memory of a BlockTimingLog, keeping it for reuse by 
+     * the calling thread.
+     */
+    static void operator delete(void *ptr, std::size_t size);
+
+    /**
+     * the maximum number of released BlockTimingLog allocations a thread 
+     * holds for reuse
+     */
+    static const std::size_t MAX_POOLED;
+
 private:
     int _tracelev;
     int _pusageFlags, _usageFlags;
     std::string _funcName;
-    std::unique_ptr<struct rusage> _usage;
+    struct rusage _usage;
 };
 
 }}}     // end lsst::pex::logging
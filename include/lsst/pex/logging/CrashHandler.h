@@ -0,0 +1,148 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file CrashHandler.h
+ * @brief definition of the CrashHandler class
+ */
+#ifndef LSST_PEX_LOGGING_CRASHHANDLER_H
+#define LSST_PEX_LOGGING_CRASHHANDLER_H
+
+#include "lsst/pex/logging/LogDestination.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief an optional handler for fatal signals that records the last log 
+ * messages and the crash site.
+ *
+ * When a process dies from SIGSEGV, SIGBUS or SIGABRT, messages that were
+ * logged just before the crash are often the most valuable, and the 
+ * crash itself is never logged.  Once installed, the CrashHandler catches
+ * these signals and, using only async-signal-safe write(2) calls, writes 
+ * the following to each of a set of pre-opened file descriptors:
+ * <ol>
+ *   <li> the contents of the flight recorder:  a fixed-size ring buffer 
+ *        holding the most recent records, already rendered to text as 
+ *        they were logged;
+ *   <li> a FATAL record (from the Log named "logging") naming the signal;
+ *   <li> a backtrace of the crashing thread.
+ * </ol>
+ * The signal is then passed on to the action that was in effect when the
+ * handler was installed:  a handler function installed earlier (e.g. by 
+ * a crash reporter or a runtime) is called, and otherwise the signal is 
+ * re-raised with that action, so the process still terminates (and dumps
+ * core) as it would have without the handler.
+ *
+ * The flight recorder only sees records sent to a Log that it has been 
+ * added to as a destination:
+ * @code
+ *   CrashHandler::install(logfd);
+ *   Log::getDefaultLog().addDestination(CrashHandler::getFlightRecorder());
+ * @endcode
+ *
+ * A crash caused by a stack overflow can only be reported from a thread
+ * that has an alternate signal stack to run the handler on.  install() 
+ * gives one to the thread that calls it; other threads that should be 
+ * covered must call protectThread().  A stack overflow in any other 
+ * thread kills the process without a report.
+ *
+ * Destination streams are flushed after each record, so records already 
+ * written to a stream are not lost in the crash.  Records still waiting 
+ * in a destination's writer queue (see LogDestination::startWriter()) 
+ * are unformatted and cannot be rendered safely from a signal handler; 
+ * the flight recorder is the means of preserving them.  
+ */
+class CrashHandler {
+public:
+
+    /**
+     * the maximum number of file descriptors the crash report can be 
+     * written to
+     */
+    enum { MAX_DESCRIPTORS = 8 };
+
+    /**
+     * install the handler for SIGSEGV, SIGBUS and SIGABRT.  If the handler 
+     * is already installed, this only adds the descriptor.
+     * @param fd             a file descriptor, already open for writing, 
+     *                          to write the crash report to.  
+     * @param recorderSize   the size in bytes of the flight recorder's 
+     *                          buffer.  This is allocated when the handler 
+     *                          is first installed.
+     */
+    static void install(int fd=2, std::size_t recorderSize=65536);
+
+    /**
+     * give the calling thread an alternate signal stack, so that the 
+     * handler can report a stack overflow in that thread.  The stack is
+     * freed when the thread exits.  This is done for the thread that 
+     * calls install(); calling it again in the same thread does nothing.
+     */
+    static void protectThread();
+
+    /**
+     * add a file descriptor to write the crash report to.  The descriptor
+     * must remain open for as long as the handler is installed.  
+     * Descriptors beyond MAX_DESCRIPTORS are ignored.
+     */
+    static void addDescriptor(int fd);
+
+    /**
+     * restore the signal actions that were in effect before install() 
+     * and forget the registered descriptors.  The flight recorder 
+     * continues to record.
+     */
+    static void uninstall();
+
+    /**
+     * return true if the handler is installed
+     */
+    static bool isInstalled();
+
+    /**
+     * return the flight recorder destination.  Add it to a Log to have 
+     * that Log's records included in a crash report.  Null is returned if
+     * install() has not been called.
+     */
+    static std::shared_ptr<LogDestination> getFlightRecorder();
+
+    /**
+     * write the current contents of the flight recorder to a file 
+     * descriptor.  This only uses async-signal-safe calls.
+     */
+    static void dumpFlightRecorder(int fd);
+
+private:
+    CrashHandler();
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_CRASHHANDLER_H
@@ -105,6 +105,17 @@ public:
         log(-1*verbosity, message);
     }
 
+    /**
+     * print a debug message with a particular verbosity.  This is the 
+     * same as debug(int, const std::string&) except that no copy of the 
+     * message is made unless it will be printed.
+     * @param verbosity    the verbosity level of this message.
+     * @param message      the message to print.
+     */
+    void debug(int verbosity, boost::string_view message) {
+        log(-1*verbosity, message);
+    }
+
     /**
      * print a debug message with a particular verbosity.  The decision 
      * whether to print this message is done at runtime (just like a normal
@@ -140,10 +151,24 @@ public:
      * @param ap           the inputs to the formatting.
      */
     void debug(int verbosity, const char *fmt, va_list ap) {
-        if (-1 * verbosity < getThreshold()) return;
+        if (! _records(-1 * verbosity)) return;
         _format(-1*verbosity, fmt, ap);
     }
 
+    /**
+     * print a message with a particular verbosity, formatted from a 
+     * "{}"-style format string given with LSST_FMT() (see FormatString).
+     * The message is only formatted if it will be printed.
+     * @param verbosity    the verboseness to associate with this message
+     * @param fmt          the format string
+     * @param args         the values to fill its fields with
+     */
+    template <typename S, typename... Args>
+    typename std::enable_if<IsFormatString<S>::value>::type
+    debug(int verbosity, S fmt, const Args&... args) {
+        log(-1*verbosity, fmt, args...);
+    }
+
     /**
      * conditionally print the given debug message if VERBOSITY is less 
      * than or equal to LSST_MAX_DEBUG.  This condition is evaluated at 
@@ -156,6 +181,18 @@ public:
         }
     }
 
+    /**
+     * conditionally print the given debug message if VERBOSITY is less 
+     * than or equal to LSST_MAX_DEBUG.  No copy of the message is made 
+     * unless it will be printed.
+     */
+    template<int VERBOSITY>
+    void debug(boost::string_view message) {
+        if (LSST_MAX_DEBUG <= 0 || VERBOSITY <= LSST_MAX_DEBUG) {
+            log(-1*VERBOSITY, message);
+        }
+    }
+
     /**
      * conditionally print a debug message via a format string if VERBOSITY 
      * is less than or equal to LSST_MAX_DEBUG.  This condition is evaluated 
@@ -174,6 +211,22 @@ public:
         }
     }
 
+    /**
+     * conditionally print a debug message via a "{}"-style format string
+     * (given with LSST_FMT()) if VERBOSITY is less than or equal to 
+     * LSST_MAX_DEBUG.  This condition is evaluated at compile-time, and 
+     * the format string is checked against the arguments at compile-time.
+     * @param fmt      the format string
+     * @param args     the values to fill its fields with
+     */
+    template<int VERBOSITY, typename S, typename... Args>
+    typename std::enable_if<IsFormatString<S>::value>::type
+    debug(S fmt, const Args&... args) {
+        if (LSST_MAX_DEBUG <= 0 || VERBOSITY <= LSST_MAX_DEBUG) {
+            log(-1*VERBOSITY, fmt, args...);
+        }
+    }
+
 };
 
 /**
@@ -205,6 +258,19 @@ void debug(const std::string& name, const char *fmt, ...) {
     }
 }
 
+/**
+ * send a debug message, formatted from a "{}"-style format string given 
+ * with LSST_FMT(), to a named log.  This message will not be printed if 
+ * VERBOSITY > LSST_MAX_DEBUG.  
+ */
+template <int VERBOSITY, typename S, typename... Args>
+typename std::enable_if<IsFormatString<S>::value>::type
+debug(const std::string& name, S fmt, const Args&... args) {
+    if (LSST_MAX_DEBUG <= 0 || VERBOSITY <= LSST_MAX_DEBUG) {
+        Debug(name).debug(VERBOSITY, fmt, args...);
+    }
+}
+
 
 }}}     // end lsst::pex::logging
 
@@ -0,0 +1,198 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file DebugCapture.h
+ * @brief definition of the DebugCapture class
+ */
+#ifndef LSST_PEX_LOGGING_DEBUGCAPTURE_H
+#define LSST_PEX_LOGGING_DEBUGCAPTURE_H
+
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/BlockTimingLog.h"
+
+#include <cstddef>
+#include <deque>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief a scope that holds back debugging messages and records them only 
+ * if something goes wrong.
+ *
+ * While a DebugCapture is in effect, messages logged by the creating 
+ * thread that fall below their Log's threshold (but at or above the 
+ * capture threshold) are not discarded; instead, they are kept, 
+ * unformatted, in a buffer.  What happens to them depends on how the 
+ * scope turns out:
+ * <ul>
+ *   <li> If a message at or above the flush threshold (WARN by default) is
+ *        logged inside the scope, the buffered records are written out 
+ *        ahead of it, and any further captured records are written as 
+ *        they arrive.  
+ *   <li> If the scope is exited because an exception is being thrown, the
+ *        buffered records are written out.  (A capture that begins and 
+ *        ends normally within a destructor run while another exception
+ *        unwinds the stack is not affected by that exception.)
+ *   <li> Otherwise, the buffered records are discarded when the scope 
+ *        ends.
+ * </ul>
+ * @code
+ *   {
+ *       DebugCapture capture(log);
+ *       processVisit(visit);      // debug detail appears only if this 
+ *   }                             //   throws or logs a warning
+ * @endcode
+ *
+ * Only the most recent records are kept (1000 by default); older ones 
+ * are dropped and counted, and the count is reported when the buffer is
+ * written.  Captured records are written to the destinations of the Log 
+ * given to the constructor, subject to the destinations' own thresholds.
+ *
+ * When constructed with a BlockTimingLog, the block's start() and done()
+ * messages are issued at the beginning and end of the scope, so that a 
+ * flushed capture shows where the block began and ended.  
+ *
+ * A DebugCapture must be destroyed by the thread that created it, in 
+ * the reverse order of construction.  When scopes are nested, a record 
+ * is kept by the innermost scope whose threshold it meets, and a 
+ * triggering message flushes all of them.
+ */
+class DebugCapture {
+public:
+
+    /**
+     * start capturing debugging messages for the current thread.
+     * @param log             the Log whose destinations captured records 
+     *                          are written to if they are flushed.
+     * @param threshold       the lowest importance of the messages to 
+     *                          capture
+     * @param flushThreshold  the importance of a message that will cause 
+     *                          the captured records to be written out.
+     * @param maxRecords      the maximum number of records to keep; when
+     *                          this is exceeded, the oldest are dropped.
+     */
+    explicit DebugCapture(const Log& log, int threshold=Log::DEBUG, 
+                          int flushThreshold=Log::WARN, 
+                          std::size_t maxRecords=1000);
+
+    /**
+     * start capturing debugging messages for the current thread over 
+     * the execution of a block of code instrumented with a 
+     * BlockTimingLog.  The block's start() message is issued after the 
+     * capture is in effect; its done() message, when the capture ends.
+     * @param block           the BlockTimingLog instrumenting the block.  
+     *                          It must outlive this DebugCapture.
+     * @param threshold       the lowest importance of the messages to 
+     *                          capture
+     * @param flushThreshold  the importance of a message that will cause 
+     *                          the captured records to be written out.
+     * @param maxRecords      the maximum number of records to keep; when
+     *                          this is exceeded, the oldest are dropped.
+     */
+    explicit DebugCapture(BlockTimingLog& block, int threshold=Log::DEBUG, 
+                          int flushThreshold=Log::WARN, 
+                          std::size_t maxRecords=1000);
+
+    /**
+     * end the capture.  The buffered records are written out if the 
+     * scope is being exited because of an exception; otherwise, they are
+     * discarded.
+     */
+    ~DebugCapture();
+
+    /**
+     * write out the buffered records now and keep writing captured 
+     * records as they arrive.  This is what happens automatically when 
+     * a message at or above the flush threshold is logged.
+     */
+    void flush();
+
+    /**
+     * return true if the captured records have been written out, either
+     * because of a flush() or a triggering message.
+     */
+    bool isTriggered() const { return _triggered; }
+
+    /**
+     * return the number of records currently buffered
+     */
+    std::size_t getCount() const { return _records.size(); }
+
+    /**
+     * return the number of records dropped because the buffer was full
+     */
+    std::size_t getDroppedCount() const { return _dropped; }
+
+    /**
+     * return the lowest importance of the messages being captured
+     */
+    int getThreshold() const { return _threshold; }
+
+    /**
+     * return the importance of a message that will cause the captured 
+     * records to be written out.
+     */
+    int getFlushThreshold() const { return _flushThreshold; }
+
+    /**
+     * return true if any DebugCapture is in effect in the current thread.
+     */
+    static bool isActive() { return Log::_capture != 0; }
+
+private:
+    friend class Log;
+
+    DebugCapture(const DebugCapture&);
+    DebugCapture& operator=(const DebugCapture&);
+
+    void _init();
+    void _writeOut();
+
+    /*
+     * keep a record that did not pass its Log's threshold
+     */
+    static void _keep(const LogRecord& record);
+
+    /*
+     * flush all captures in effect if importance triggers any of them
+     */
+    static void _check(int importance);
+    static void _flushAll(DebugCapture *capture);
+
+    Log _log;
+    BlockTimingLog *_block;
+    int _threshold, _flushThreshold;
+    std::size_t _max, _dropped;
+    bool _triggered;
+    std::deque<LogRecord> _records;
+    DebugCapture *_prev;
+    int _uncaught;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_DEBUGCAPTURE_H
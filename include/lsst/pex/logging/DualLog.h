@@ -119,6 +119,13 @@ public:
      */
     void setFileThreshold(int thresh) { _file->setThreshold(thresh); }
 
+    /**
+     * return the destination for the log file set at construction time.
+     * This can be used, for example, to give the file its own writer 
+     * thread (see LogDestination::startWriter()).
+     */
+    LogDestination& getFileDestination() { return *_file; }
+
     /**
      * create a new log and set it as the default Log
      * @param preamble      a list of data properties that should be included 
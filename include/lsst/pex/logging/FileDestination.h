@@ -35,6 +35,8 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <fstream>
+#include <memory>
+#include <cstddef>
 
 namespace lsst {
 namespace pex {
@@ -45,6 +47,18 @@ namespace logging {
  *
  * This class makes it easier to attach files to Logs via Python via 
  * Log.addDestination().
+ *
+ * Like any ofstream, the file is buffered, so a record may not reach the
+ * disk until well after it is logged.  Where some records must survive a 
+ * crash of the process or the machine (e.g. for auditing), a durability 
+ * threshold can be set with setDurability().  A record at or above that 
+ * threshold is flushed and the file synced to disk (via fsync()) before 
+ * write() returns.  Syncing is slow, so records arriving from several 
+ * threads at about the same time share a single sync (a "group commit"):
+ * while one sync is underway, the records that arrive queue up behind it
+ * and are committed together by the next.  A sync can also be made to 
+ * wait briefly for other records to join it.  Records below the threshold
+ * stay buffered as usual (though a sync commits any written before it).
  */
 class FileDestination : public LogDestination {
 public:
@@ -64,33 +78,15 @@ public:
     FileDestination(const std::string& filepath,
                     const std::shared_ptr<LogFormatter>& formatter, 
                     int threshold=threshold::PASS_ALL,
-                    bool truncate=false) 
-        : LogDestination(new std::ofstream(filepath.c_str(),
-                                           truncate ? std::ios::out 
-                                                    : std::ios::app), 
-                         formatter, threshold),
-          _path(filepath) 
-    { }
+                    bool truncate=false);
     FileDestination(const char *filepath,
                     const std::shared_ptr<LogFormatter>& formatter, 
                     int threshold=threshold::PASS_ALL,
-                    bool truncate=false)
-        : LogDestination(new std::ofstream(filepath,
-                                           truncate ? std::ios::out 
-                                                    : std::ios::app), 
-                         formatter, threshold),
-          _path(filepath) 
-    { }
+                    bool truncate=false);
     FileDestination(const boost::filesystem::path& filepath,
                     const std::shared_ptr<LogFormatter>& formatter, 
                     int threshold=threshold::PASS_ALL,
-                    bool truncate=false)
-        : LogDestination(new std::ofstream(filepath.string().c_str(),
-                                           truncate ? std::ios::out 
-                                                    : std::ios::app), 
-                         formatter, threshold),
-          _path(filepath) 
-    { }
+                    bool truncate=false);
     //@}
 
     //@{
@@ -119,8 +115,62 @@ public:
 
     const boost::filesystem::path& getPath() const { return _path; }
 
+    /**
+     * make records at or above a given importance durable:  write() will 
+     * not return until such a record has been synced to disk.  When the 
+     * destination has a writer thread (see startWriter()), it is the 
+     * writer thread that waits; call flushWriter() to wait for queued 
+     * records.  This should not be called while other threads are writing
+     * to this destination.
+     * @param importance  the minimum importance of durable records
+     * @param maxDelay    the longest time in microseconds a sync will wait
+     *                      for other records to join it before starting.  
+     *                      With 0 (the default), a sync starts right away,
+     *                      and only records arriving while it is underway
+     *                      are grouped into the next.
+     * @throws lsst::pex::exceptions::RuntimeError  if the file cannot be 
+     *                      opened for syncing
+     *
+     * If a sync fails (e.g. with EIO or ENOSPC), the records it was to 
+     * make durable are not reported as durable:  write() throws a 
+     * RuntimeError giving the error for each of them.
+     */
+    void setDurability(int importance, int maxDelay=0);
+
+    /**
+     * stop making records durable; all records will be buffered.  
+     */
+    void clearDurability();
+
+    /**
+     * return true if some records are made durable
+     */
+    bool isDurable() const { return _commit.get() != 0; }
+
+    /**
+     * return the minimum importance of durable records.  If isDurable() 
+     * returns false, the value is meaningless.
+     */
+    int getDurableThreshold() const;
+
+    /**
+     * return the number of times the file has been synced since 
+     * setDurability() was called.  
+     */
+    std::size_t getSyncCount() const;
+
 protected:
+    /**
+     * format a record and write it to the file, syncing the file if the 
+     * record is to be made durable.
+     */
+    virtual void _writeRecord(const LogRecord& rec, const std::string *text);
+
     boost::filesystem::path _path;
+
+private:
+    class Commit;
+    std::unique_ptr<Commit> _commit;   // the durability state, if any
 };
 
 }}}     // end lsst::pex::logging
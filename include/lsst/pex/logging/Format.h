@@ -0,0 +1,580 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file Format.h
+ * @brief a type-safe, "{}"-style message formatting API
+ */
+#ifndef LSST_PEX_LOGGING_FORMAT_H
+#define LSST_PEX_LOGGING_FORMAT_H
+
+#include "lsst/daf/base/DateTime.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <boost/utility/string_view.hpp>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief the base class of compile-time format strings
+ *
+ * Format strings are written in the style of Python's str.format() (and 
+ * the fmt library):  each "{}" is replaced by the next argument, which 
+ * may be of any type.  A field may carry a specification after a colon, 
+ * as in "{:>8.3f}":
+ * @code
+ *   [[fill]align][sign][#][0][width][.precision][type]
+ * @endcode
+ * where align is one of '<', '>' or '^'; sign is '+', '-' or ' '; 
+ * '#' adds a base prefix (e.g. "0x") to integers; '0' pads numbers with 
+ * zeros; precision gives the number of digits for floating-point values 
+ * and the maximum length for strings; and type is one of
+ * <ul>
+ *   <li> d, x, X, o, b, c for integers, chars and bools (decimal, hex, 
+ *        octal, binary, character),
+ *   <li> e, E, f, F, g, G, % for floating-point values,
+ *   <li> s for strings and bools,
+ *   <li> p for pointers.
+ * </ul>
+ * "{{" and "}}" stand for literal braces.  A DateTime is written as an 
+ * ISO-8601 UTC time (or with type 'n', as nanoseconds); other types are 
+ * written with their operator<<(), unless FormatValue has been 
+ * specialized for them.
+ *
+ * Format strings are given with the LSST_FMT() macro, which makes the 
+ * string's contents available to the compiler:
+ * @code
+ *   log.info(LSST_FMT("matched {} of {} sources (rms={:.3f})"), 
+ *            nmatch, nsrc, rms);
+ * @endcode
+ * The string is then parsed at compile time and checked against the 
+ * types of the arguments; a mismatch (e.g. a missing argument or "{:d}" 
+ * applied to a double) is a compilation error.  (C++14 offers no way to
+ * inspect a plain string literal passed as a function argument at compile
+ * time, hence the macro.)  Formatting happens only if the message will be
+ * recorded, in one pass, directly into a FormatBuffer.
+ */
+struct FormatString { };
+
+/**
+ * wrap a string literal for use as a compile-time checked format string
+ */
+#define LSST_FMT(s)                                                         \
+    [] {                                                                    \
+        struct _LsstFormatString : ::lsst::pex::logging::FormatString {     \
+            static constexpr const char *data() { return s; }               \
+            static constexpr std::size_t size() { return sizeof(s) - 1; }   \
+        };                                                                  \
+        return _LsstFormatString();                                         \
+    }()
+
+/**
+ * @brief the parsed specification of a replacement field
+ */
+struct FormatSpec {
+    char fill;       ///< the padding character
+    char align;      ///< '<', '>', '^', or 0 for the type's default
+    char sign;       ///< '+', '-', ' ', or 0 for the default ('-')
+    bool alt;        ///< true if '#' was given
+    bool zero;       ///< true if '0' was given
+    int width;       ///< the minimum width, or 0
+    int precision;   ///< the precision, or -1 if none was given
+    char type;       ///< the type character, or 0 if none was given
+
+    constexpr FormatSpec() 
+        : fill(' '), align(0), sign(0), alt(false), zero(false), width(0), 
+          precision(-1), type(0)
+    { }
+};
+
+/**
+ * @brief a character buffer that messages are formatted into
+ *
+ * The first few hundred characters are stored within the object itself, 
+ * so formatting a typical message into a FormatBuffer on the stack 
+ * allocates no memory.  
+ */
+class FormatBuffer {
+public:
+    FormatBuffer() : _data(_inline), _size(0), _capacity(INLINE) { }
+    ~FormatBuffer() { if (_data != _inline) delete [] _data; }
+
+    /**
+     * append characters to the buffer
+     */
+    void append(const char *s, std::size_t n) {
+        char *to = reserve(n);
+        for(std::size_t i=0; i < n; ++i) to[i] = s[i];
+        _size += n;
+    }
+
+    /**
+     * append a character repeated n times
+     */
+    void append(std::size_t n, char c) {
+        char *to = reserve(n);
+        for(std::size_t i=0; i < n; ++i) to[i] = c;
+        _size += n;
+    }
+
+    /**
+     * append a single character
+     */
+    void push_back(char c) { 
+        if (_size == _capacity) _grow(1);
+        _data[_size++] = c; 
+    }
+
+    /**
+     * make room for n more characters and return a pointer to where they
+     * should be written.  Call commit() once they have been.
+     */
+    char *reserve(std::size_t n) {
+        if (_size + n > _capacity) _grow(n);
+        return _data + _size;
+    }
+
+    /**
+     * add n characters written after a call to reserve() to the contents
+     */
+    void commit(std::size_t n) { _size += n; }
+
+    /**
+     * pad the characters appended since position start out to the width 
+     * given by a spec, according to its fill and alignment.
+     * @param start     the size of the buffer before the field was written
+     * @param spec      the field's specification
+     * @param align     the alignment to use if spec does not give one
+     */
+    void align(std::size_t start, const FormatSpec& spec, char align);
+
+    const char *data() const { return _data; }
+    std::size_t size() const { return _size; }
+    void clear() { _size = 0; }
+
+    /**
+     * return the contents as a string_view
+     */
+    boost::string_view view() const { 
+        return boost::string_view(_data, _size); 
+    }
+
+    /**
+     * return a copy of the contents
+     */
+    std::string str() const { return std::string(_data, _size); }
+
+private:
+    enum { INLINE = 500 };
+
+    FormatBuffer(const FormatBuffer&);
+    FormatBuffer& operator=(const FormatBuffer&);
+
+    void _grow(std::size_t n);
+
+    char *_data;
+    std::size_t _size, _capacity;
+    char _inline[INLINE];
+};
+
+/**
+ * @brief how values of a type are written into a FormatBuffer.  
+ *
+ * Specializations are provided for the built-in types, strings, pointers 
+ * and DateTime.  For any other type, the default writes the value with 
+ * operator<<() and then pads it to the field's width.  To format a type of
+ * your own differently, specialize this template for it, providing
+ * @code
+ *   static void format(FormatBuffer& out, const T& value, 
+ *                      const FormatSpec& spec);
+ * @endcode
+ * The compile-time check accepts any specification for such types.
+ */
+template <typename T, typename Enable=void>
+struct FormatValue {
+    static void format(FormatBuffer& out, const T& value, 
+                       const FormatSpec& spec);
+};
+
+//@cond
+namespace formatting {
+
+    /*
+     * the ways a format string can be wrong
+     */
+    enum Error { OK, UNMATCHED_BRACE, BAD_SPEC, INDEXED_FIELD, 
+                 TOO_FEW_ARGS, TOO_MANY_ARGS, BAD_TYPE };
+
+    /*
+     * the categories of argument that the specifications are checked 
+     * against
+     */
+    enum Kind { NONE, BOOL, CHAR, INTEGER, FLOAT, STRING, POINTER, OTHER };
+
+    template <typename T>
+    constexpr Kind kindOf() {
+        typedef typename std::decay<T>::type U;
+        return (std::is_same<U, bool>::value) ? BOOL 
+             : (std::is_same<U, char>::value) ? CHAR
+             : (std::is_integral<U>::value || std::is_enum<U>::value) 
+                                                  ? INTEGER
+             : (std::is_floating_point<U>::value) ? FLOAT
+             : (std::is_same<U, const char*>::value || 
+                std::is_same<U, char*>::value ||
+                std::is_same<U, std::string>::value ||
+                std::is_same<U, boost::string_view>::value) ? STRING
+             : (std::is_pointer<U>::value) ? POINTER 
+             : OTHER;
+    }
+
+    constexpr bool isAlign(char c) { return c == '<' || c == '>' || c == '^'; }
+    constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    /*
+     * return true if a type character is absent (0) or one of chars
+     */
+    constexpr bool oneOf(char c, const char *chars) {
+        if (c == '\0') return true;
+        for(; *chars != '\0'; ++chars) 
+            if (c == *chars) return true;
+        return false;
+    }
+
+    /*
+     * parse the specification of a field, starting just after its ':'.  
+     * Return a pointer to the closing '}', or null if the specification 
+     * is malformed.
+     */
+    constexpr const char *parseSpec(const char *p, const char *end, 
+                                    FormatSpec& spec) 
+    {
+        if (p + 1 < end && isAlign(p[1]) && *p != '{' && *p != '}') {
+            spec.fill = p[0];
+            spec.align = p[1];
+            p += 2;
+        }
+        else if (p < end && isAlign(*p)) {
+            spec.align = *p++;
+        }
+        if (p < end && (*p == '+' || *p == '-' || *p == ' ')) spec.sign = *p++;
+        if (p < end && *p == '#') { spec.alt = true; ++p; }
+        if (p < end && *p == '0') { spec.zero = true; ++p; }
+        while (p < end && isDigit(*p)) spec.width = spec.width*10 + (*p++ - '0');
+        if (p < end && *p == '.') {
+            ++p;
+            if (p == end || ! isDigit(*p)) return nullptr;
+            spec.precision = 0;
+            while (p < end && isDigit(*p)) 
+                spec.precision = spec.precision*10 + (*p++ - '0');
+        }
+        if (p < end && *p != '}') spec.type = *p++;
+        if (p >= end || *p != '}') return nullptr;
+        return p;
+    }
+
+    /*
+     * return true if a specification can be applied to a kind of argument
+     */
+    constexpr bool accepts(Kind kind, const FormatSpec& spec) {
+        switch (kind) {
+        case BOOL:
+            return spec.precision < 0 && oneOf(spec.type, "sdxXob");
+        case CHAR:
+        case INTEGER:
+            return spec.precision < 0 && oneOf(spec.type, "dxXobc");
+        case FLOAT:
+            return oneOf(spec.type, "eEfFgG%");
+        case STRING:
+            return spec.sign == 0 && ! spec.alt && oneOf(spec.type, "s");
+        case POINTER:
+            return spec.precision < 0 && oneOf(spec.type, "p");
+        default:
+            return true;
+        }
+    }
+
+    /*
+     * check a format string against the types of its arguments
+     */
+    template <typename... Args>
+    constexpr Error check(const char *s, std::size_t n) {
+        const Kind kinds[] = { kindOf<Args>()..., NONE };
+        const std::size_t nargs = sizeof...(Args);
+        std::size_t arg = 0;
+        const char *end = s + n;
+        for(const char *p = s; p < end; ++p) {
+            if (*p == '}') {
+                if (p + 1 < end && p[1] == '}') { ++p; continue; }
+                return UNMATCHED_BRACE;
+            }
+            if (*p != '{') continue;
+            if (p + 1 < end && p[1] == '{') { ++p; continue; }
+
+            ++p;
+            FormatSpec spec;
+            if (p < end && isDigit(*p)) return INDEXED_FIELD;
+            if (p < end && *p == ':') {
+                p = parseSpec(p+1, end, spec);
+                if (p == nullptr) return BAD_SPEC;
+            }
+            else if (p >= end || *p != '}') {
+                return UNMATCHED_BRACE;
+            }
+            if (arg >= nargs) return TOO_FEW_ARGS;
+            if (! accepts(kinds[arg], spec)) return BAD_TYPE;
+            ++arg;
+        }
+        return (arg < nargs) ? TOO_MANY_ARGS : OK;
+    }
+
+    /*
+     * a type-erased reference to an argument
+     */
+    class ArgRef {
+    public:
+        ArgRef() : _value(0), _write(0) { }
+
+        template <typename T>
+        ArgRef(const T& value) : _value(&value), _write(&ArgRef::_thunk<T>) { }
+
+        template <std::size_t N>
+        ArgRef(const char (&value)[N]) : _value(value), _write(&ArgRef::_chars) 
+        { }
+
+        void write(FormatBuffer& out, const FormatSpec& spec) const {
+            _write(out, _value, spec);
+        }
+
+    private:
+        template <typename T>
+        static void _thunk(FormatBuffer& out, const void *value, 
+                           const FormatSpec& spec) 
+        {
+            FormatValue<T>::format(out, *static_cast<const T*>(value), spec);
+        }
+
+        static void _chars(FormatBuffer& out, const void *value, 
+                           const FormatSpec& spec);
+
+        const void *_value;
+        void (*_write)(FormatBuffer&, const void*, const FormatSpec&);
+    };
+
+    /*
+     * write a format string whose fields have already been checked, 
+     * taking the arguments from an array.
+     */
+    void vformat(FormatBuffer& out, boost::string_view fmt, 
+                 const ArgRef *args, std::size_t nargs);
+
+    void writeInteger(FormatBuffer& out, bool negative, 
+                      unsigned long long magnitude, const FormatSpec& spec);
+    void writeFloat(FormatBuffer& out, double value, const FormatSpec& spec);
+    void writeString(FormatBuffer& out, boost::string_view value, 
+                     const FormatSpec& spec);
+    void writePointer(FormatBuffer& out, const void *value, 
+                      const FormatSpec& spec);
+
+    /*
+     * an output stream that appends to a FormatBuffer
+     */
+    class BufferStream : public std::ostream {
+    public:
+        explicit BufferStream(FormatBuffer& out);
+        ~BufferStream();
+    private:
+        class Buf;
+        Buf *_buf;
+    };
+}
+//@endcond
+
+/**
+ * check, at compile time, a format string given with LSST_FMT() against 
+ * the types of the arguments that will fill it.  This does nothing at 
+ * run time.
+ */
+template <typename S, typename... Args>
+void checkFormat() {
+    static_assert(std::is_base_of<FormatString, S>::value, 
+                  "the format string must be given with LSST_FMT()");
+    constexpr formatting::Error err = 
+        formatting::check<Args...>(S::data(), S::size());
+    static_assert(err != formatting::UNMATCHED_BRACE, 
+                  "unmatched brace in format string");
+    static_assert(err != formatting::BAD_SPEC,
+                  "malformed field specification in format string");
+    static_assert(err != formatting::INDEXED_FIELD,
+                  "numbered fields are not supported in format strings");
+    static_assert(err != formatting::TOO_FEW_ARGS,
+                  "too few arguments for format string");
+    static_assert(err != formatting::TOO_MANY_ARGS,
+                  "too many arguments for format string");
+    static_assert(err != formatting::BAD_TYPE,
+                  "format specification does not suit the argument's type");
+}
+
+/**
+ * format a message into a buffer according to a format string given with
+ * LSST_FMT().  A format string that does not match the arguments is 
+ * rejected at compile time.
+ */
+template <typename S, typename... Args>
+void formatTo(FormatBuffer& out, S, const Args&... args) {
+    checkFormat<S, Args...>();
+
+    const formatting::ArgRef refs[] = { formatting::ArgRef(args)..., 
+                                        formatting::ArgRef() };
+    formatting::vformat(out, boost::string_view(S::data(), S::size()), 
+                        refs, sizeof...(Args));
+}
+
+/**
+ * format a message into a string according to a format string given with
+ * LSST_FMT().  
+ */
+template <typename S, typename... Args>
+std::string formatToString(S fmt, const Args&... args) {
+    FormatBuffer out;
+    formatTo(out, fmt, args...);
+    return out.str();
+}
+
+/**
+ * true if S is the type of a format string created with LSST_FMT()
+ */
+template <typename S>
+struct IsFormatString : std::is_base_of<FormatString, S> { };
+
+//@cond
+template <typename T, typename Enable>
+void FormatValue<T, Enable>::format(FormatBuffer& out, const T& value, 
+                                    const FormatSpec& spec) 
+{
+    std::size_t start = out.size();
+    {
+        formatting::BufferStream strm(out);
+        strm << value;
+    }
+    out.align(start, spec, '<');
+}
+
+template <typename T>
+struct FormatValue<T, typename std::enable_if<
+                          (std::is_integral<T>::value && 
+                           ! std::is_same<T, bool>::value &&
+                           ! std::is_same<T, char>::value) ||
+                          std::is_enum<T>::value>::type> 
+{
+    static void format(FormatBuffer& out, const T& value, 
+                       const FormatSpec& spec) 
+    {
+        typedef typename std::conditional<std::is_enum<T>::value,
+                                          std::underlying_type<T>,
+                                          std::common_type<T> >::type::type I;
+        I v = static_cast<I>(value);
+        bool negative = (v < I(0));
+        unsigned long long magnitude = negative 
+            ? 0ULL - static_cast<unsigned long long>(v) 
+            : static_cast<unsigned long long>(v);
+        formatting::writeInteger(out, negative, magnitude, spec);
+    }
+};
+
+template <typename T>
+struct FormatValue<T, typename std::enable_if<
+                          std::is_floating_point<T>::value>::type> 
+{
+    static void format(FormatBuffer& out, const T& value, 
+                       const FormatSpec& spec) 
+    {
+        formatting::writeFloat(out, static_cast<double>(value), spec);
+    }
+};
+
+template <>
+struct FormatValue<bool> {
+    static void format(FormatBuffer& out, const bool& value, 
+                       const FormatSpec& spec);
+};
+
+template <>
+struct FormatValue<char> {
+    static void format(FormatBuffer& out, const char& value, 
+                       const FormatSpec& spec);
+};
+
+template <>
+struct FormatValue<const char*> {
+    static void format(FormatBuffer& out, const char *value, 
+                       const FormatSpec& spec);
+};
+
+template <>
+struct FormatValue<char*> : FormatValue<const char*> { };
+
+template <>
+struct FormatValue<std::string> {
+    static void format(FormatBuffer& out, const std::string& value, 
+                       const FormatSpec& spec) 
+    {
+        formatting::writeString(out, value, spec);
+    }
+};
+
+template <>
+struct FormatValue<boost::string_view> {
+    static void format(FormatBuffer& out, const boost::string_view& value, 
+                       const FormatSpec& spec) 
+    {
+        formatting::writeString(out, value, spec);
+    }
+};
+
+template <typename T>
+struct FormatValue<T*, typename std::enable_if<
+                           ! std::is_same<typename std::remove_cv<T>::type, 
+                                          char>::value>::type>
+{
+    static void format(FormatBuffer& out, T *value, const FormatSpec& spec) {
+        formatting::writePointer(out, value, spec);
+    }
+};
+
+template <>
+struct FormatValue<lsst::daf::base::DateTime> {
+    static void format(FormatBuffer& out, 
+                       const lsst::daf::base::DateTime& value, 
+                       const FormatSpec& spec);
+};
+//@endcond
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_FORMAT_H
@@ -0,0 +1,147 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LatencyHistogram.h
+ * @brief definition of the LatencyHistogram class
+ */
+#ifndef LSST_PEX_LOGGING_LATENCYHISTOGRAM_H
+#define LSST_PEX_LOGGING_LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief a histogram of latencies with bounded relative error
+ *
+ * The histogram is log-linear, in the manner of HdrHistogram:  each power
+ * of two (in nanoseconds) is divided into SUB_BUCKETS equal buckets, so 
+ * any recorded latency is known to within 1/SUB_BUCKETS (about 6%) of its
+ * value, from a nanosecond up to a little over a minute.  Longer 
+ * latencies are counted in the last bucket, but the maximum is kept 
+ * exactly.  This makes the histogram suitable for finding the tail of a
+ * distribution (e.g. the rare 100 ms stall among millions of 
+ * microsecond-long writes), which an average hides.
+ *
+ * Recording is safe from any number of threads.  To keep threads from 
+ * contending for the same counters, a histogram can be divided into 
+ * shards; each thread records into one shard, chosen when the thread 
+ * first records.  Copying a histogram merges its shards, giving a 
+ * consistent-enough snapshot for reporting, and histograms can be merged
+ * into one another with merge().
+ */
+class LatencyHistogram {
+public:
+    enum { 
+        /** the number of buckets per power of two, as a power of two */
+        SUB_BUCKET_BITS = 4,     
+        /** the number of buckets per power of two */
+        SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+        /** latencies of 2^MAX_BITS ns or more go in the last bucket */
+        MAX_BITS = 36,
+        /** the total number of buckets */
+        NBUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS
+    };
+
+    /**
+     * create an empty histogram
+     * @param shards   the number of shards to divide the counters among
+     */
+    explicit LatencyHistogram(int shards=1);
+
+    /**
+     * create an unsharded copy of a histogram 
+     */
+    LatencyHistogram(const LatencyHistogram& that);
+
+    /**
+     * replace the contents of this histogram with those of another
+     */
+    LatencyHistogram& operator=(const LatencyHistogram& that);
+
+    ~LatencyHistogram();
+
+    /**
+     * count a latency 
+     * @param nanos   the latency in nanoseconds
+     */
+    void record(std::uint64_t nanos);
+
+    /**
+     * add the counts of another histogram to this one
+     */
+    void merge(const LatencyHistogram& that);
+
+    /**
+     * return the number of latencies recorded
+     */
+    std::uint64_t getCount() const;
+
+    /**
+     * return the longest latency recorded in nanoseconds
+     */
+    std::uint64_t getMax() const;
+
+    /**
+     * return the latency in nanoseconds below which a given percentage of
+     * the recorded latencies fall.  The value is the upper end of the 
+     * bucket containing the percentile (but no more than the maximum), so 
+     * it overestimates by at most 1/SUB_BUCKETS.  Zero is returned if 
+     * nothing has been recorded.
+     * @param percent   the percentile, from 0 to 100
+     */
+    std::uint64_t getPercentile(double percent) const;
+
+    /**
+     * print a summary of the distribution:  the count and the 50th, 90th,
+     * 99th and 99.9th percentiles and the maximum, in microseconds.
+     */
+    void write(std::ostream& strm) const;
+
+    /**
+     * return the index of the bucket that counts a given latency
+     */
+    static int bucketFor(std::uint64_t nanos);
+
+    /**
+     * return the largest latency counted by a given bucket
+     */
+    static std::uint64_t bucketLimit(int bucket);
+
+private:
+    struct Shard;
+
+    int _nshards;
+    Shard *_shards;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_LATENCYHISTOGRAM_H
@@ -33,12 +33,17 @@
 #include "lsst/daf/base/PropertySet.h"
 #include "lsst/pex/logging/LogRecord.h"
 #include "lsst/pex/logging/LogDestination.h"
+#include "lsst/pex/logging/ScopedThreshold.h"
+#include "lsst/pex/logging/LogMetrics.h"
+#include "lsst/pex/logging/Format.h"
 #include "lsst/pex/logging/threshold/Memory.h"
 
 #include <vector>
 #include <list>
 #include <cstdarg>
+#include <type_traits>
 #include <memory>
+#include <boost/utility/string_view.hpp>
 
 // If the compiler does not support attributes, disable them
 #ifndef __GNUC__
@@ -50,10 +55,18 @@
 // the start of the varargs; +1 for C++ member functions.
 #define ATTRIB_FORMAT(fmt,start) __attribute__ ((format(printf,fmt,start)))
 
+// the semaphore of the reject probe (see probes.h):  nonzero while a 
+// tracer is attached to it
+extern "C" unsigned short lsst_pex_logging_reject_semaphore;
+
 namespace lsst {
 namespace pex {
 namespace logging {
 
+class LogHandle;
+class LogRec;
+class DebugCapture;
+
 /**
  * @brief a place to record messages and descriptions of the state of 
  * processing. 
@@ -150,6 +163,13 @@ namespace logging {
  * 
  * The manipulator Rec::endr triggers the recording of the message to the log. 
  * Note that Rec is a shorthand typedef for the LogRec class.  
+ *
+ * A message with a fixed set of properties can also be sent in a single 
+ * call, which does no work at all if the message will not be recorded:
+ *
+ *     using lsst::pex::logging::prop;
+ *     mylog.logdebug("Completed deconvolution", 
+ *                    prop("iterations", 541), prop("rms", 0.0032));
  */
 class Log {
 public:
@@ -276,12 +296,23 @@ public:
     /**
      * return the importance threshold for this log.  A message sent to this 
      * Log will not be recorded if the message importance is less than the 
-     * threshold. 
+     * threshold.  A ScopedThreshold in effect in the calling thread 
+     * takes precedence over the threshold set for the Log.
      */
     int getThreshold() const { 
-        return ((_threshold > INHERIT_THRESHOLD || _name.length() == 0) 
-                       ? _threshold
-                       : _thresholds->getThresholdFor(_name) );
+        int scoped;
+        if (ScopedThreshold::isActive() && 
+            ScopedThreshold::findThresholdFor(_name, scoped)) 
+        {
+            LogMetrics::count(LogMetrics::LOCAL);
+            return scoped;
+        }
+        if (_threshold > INHERIT_THRESHOLD || _name.length() == 0) {
+            LogMetrics::count(LogMetrics::LOCAL);
+            return _threshold;
+        }
+        LogMetrics::count(LogMetrics::LOOKUPS);
+        return _thresholds->getThresholdFor(_name);
     }
 
     /**
@@ -297,9 +328,14 @@ public:
 
     /**
      * return true if the threshold is low enough to pass messages of a 
-     * given loudness or importance.
+     * given loudness or importance.  If this Log inherits its threshold 
+     * and the importance is below every threshold set in its hierarchy, 
+     * this returns false without resolving the threshold by name.
      */
-    bool sends(int importance) const { return (importance >= getThreshold()); }
+    bool sends(int importance) const { 
+        return (_mayPass(importance) && 
+                importance >= getThreshold()); 
+    }
 
     /**
      * reset the importance threshold of this log to that of its parent 
@@ -374,10 +410,11 @@ public:
     /**
      * add a label to the preamble property of this Log.  The label will
      * be stored in the preamble property under the key name "LABEL".
+     * Like all preamble changes, this replaces this Log's preamble with 
+     * a new snapshot; copies of this Log and records already created 
+     * are unaffected.
      */
-    void addLabel(const std::string& val) {
-        _preamble->add(LSST_LP_LABEL, val);
-    }
+    void addLabel(const std::string& val);
 
     /**
      * add a property to the preamble
@@ -442,6 +479,37 @@ public:
     void log(int importance, const std::string& message, 
              const RecordProperty<T>& prop);
 
+    /**
+     * send a message with any number of named properties to the log:
+     * @code
+     *   log.log(Log::INFO, "measured source", 
+     *           prop("flux", f), prop("x", x), Prop<int>("ccd", id));
+     * @endcode
+     * The threshold is checked before anything else is done; only if the 
+     * message will be recorded are the message and properties copied, 
+     * each directly into the record.  Properties given with prop() (see 
+     * PropRef) cost nothing to create, so a rejected message does no work
+     * on behalf of its arguments at all.
+     * @param importance    how loud the message should be
+     * @param message      a simple bit of text to send in the message
+     * @param props        the properties to include in the message, each 
+     *                       a PropRef or a RecordProperty (e.g. Prop).
+     */
+    template <class M, class... Ps>
+    typename std::enable_if<
+        std::is_convertible<const M&, boost::string_view>::value &&
+        sizeof...(Ps) != 0 && AreRecordProperties<Ps...>::value>::type
+    log(int importance, const M& message, const Ps&... props) {
+        if (! _mayPass(importance)) return;
+        int threshold = _recordThreshold();
+        if (_below(importance, threshold)) return;
+        LogRecord rec(threshold, importance, _preamble, willShowAll());
+        rec.addComment(boost::string_view(message));
+        int added[] = { (rec.addProperty(props), 0)... };
+        (void) added;
+        send(rec);
+    }
+
     /**
      * send a simple message to the log
      * @param importance    how loud the message should be
@@ -449,6 +517,33 @@ public:
      */
     void log(int importance, const std::string& message);
 
+    /**
+     * send a simple message to the log.  No copy of the message is made 
+     * unless it passes the importance threshold, in which case it is 
+     * copied once into the LogRecord.  
+     * @param importance    how loud the message should be
+     * @param message      a simple bit of text to send in the message
+     */
+    void log(int importance, boost::string_view message) {
+        if (! _mayPass(importance)) return;
+        int threshold = _recordThreshold();
+        if (_below(importance, threshold)) return;
+        _log(threshold, importance, message);
+    }
+
+    /**
+     * send a simple message to the log.  This overload lets string literals 
+     * be passed without first constructing a temporary std::string.  
+     * @param importance    how loud the message should be
+     * @param message      a simple bit of text to send in the message
+     */
+    void log(int importance, const char *message) {
+        if (! _mayPass(importance)) return;
+        int threshold = _recordThreshold();
+        if (_below(importance, threshold)) return;
+        _log(threshold, importance, boost::string_view(message));
+    }
+
     /**
      * send a simple, formatted message to the log
      * @param importance    how loud the message should be
@@ -459,10 +554,35 @@ public:
         log(importance, message.str());
     }
 
+    /**
+     * send a message formatted from a "{}"-style format string (see 
+     * FormatString).  The format string, given with LSST_FMT(), is 
+     * checked against the arguments at compile time, and the message is 
+     * only formatted if it will actually get recorded:
+     * @code
+     *   log.log(Log::INFO, LSST_FMT("x={} y={:.3f}"), x, y);
+     * @endcode
+     * @param importance    how loud the message should be
+     * @param fmt          the format string
+     * @param args         the values to fill its fields with
+     */
+    template <typename S, typename... Args>
+    typename std::enable_if<IsFormatString<S>::value>::type
+    log(int importance, S fmt, const Args&... args) {
+        if (! _mayPass(importance)) return;
+        int threshold = _recordThreshold();
+        if (_below(importance, threshold)) return;
+        FormatBuffer message;
+        formatTo(message, fmt, args...);
+        _log(threshold, importance, message.view());
+    }
+
     /**
      * Shortcut versions of each of the log() methods above:
      *
      *   void logdebug(const std::string& message);
+     *   void logdebug(boost::string_view message);
+     *   void logdebug(const char *message);
      *   void logdebug(const boost::format& message);
      *   template<T> void logdebug(const std::string& message, 
      *                             const RecordProperty<T>& prop);
@@ -470,6 +590,9 @@ public:
      *                             const std::string& name, const T& val);
      *   void logdebug(const std::string& message, 
      *                 const lsst::daf::base::PropertySet& properties);
+     *   template<S, Args...> void logdebug(S fmt, const Args&... args);
+     *   template<M, Ps...> void logdebug(const M& message, 
+     *                                    const Ps&... props);
      *
      * And likewise for:
      *   void info(const std::string& message);
@@ -494,8 +617,27 @@ public:
     void fname(const std::string& message) {                        \
         log(lev, message);                                          \
     }                                                               \
+    void fname(boost::string_view message) {                        \
+        log(lev, message);                                          \
+    }                                                               \
+    void fname(const char *message) {                               \
+        log(lev, message);                                          \
+    }                                                               \
     void fname(const boost::format& message) {                      \
         log(lev, message);                                          \
+    }                                                               \
+    template <typename S, typename... Args>                         \
+    typename std::enable_if<IsFormatString<S>::value>::type         \
+    fname(S fmt, const Args&... args) {                             \
+        log(lev, fmt, args...);                                     \
+    }                                                               \
+    template <class M, class... Ps>                                 \
+    typename std::enable_if<                                        \
+        std::is_convertible<const M&, boost::string_view>::value && \
+        sizeof...(Ps) != 0 &&                                       \
+        AreRecordProperties<Ps...>::value>::type                    \
+    fname(const M& message, const Ps&... props) {                   \
+        log(lev, message, props...);                                \
     }
     LEVELF(logdebug, DEBUG)
     LEVELF(info    , INFO )
@@ -525,7 +667,7 @@ public:
 #define LEVELF(fname, lev)                                     \
     void fname(const char* fmt, ...)                           \
         ATTRIB_FORMAT(2, 3) {                                  \
-        if (lev < getThreshold()) return;                      \
+        if (! _records(lev)) return;                           \
         va_list ap;                                            \
         va_start(ap, fmt);                                     \
         _format(lev, fmt, ap);                                 \
@@ -580,13 +722,28 @@ public:
      */
     void addDestination(const std::shared_ptr<LogDestination> &destination) {
         _destinations.push_back(destination);
+        _destinationsChanged();
     }
 
     /** 
-     * return the current set of preamble properties
+     * return the current set of preamble properties.  The reference is 
+     * to the current snapshot (see getSharedPreamble()), which a change 
+     * to the preamble (e.g. by addLabel() or setPreambleProperty()) 
+     * replaces; it is invalidated by such a change unless the snapshot is
+     * also held by a copy of this Log or a record.  Use 
+     * getSharedPreamble() to keep the snapshot.
      */
     const lsst::daf::base::PropertySet& getPreamble() { return *_preamble; }
 
+    /** 
+     * return the current preamble snapshot.  The snapshot is immutable and
+     * is shared with copies of this Log and with the records it creates;
+     * a change to the preamble replaces it rather than modifying it.
+     */
+    const lsst::daf::base::PropertySet::ConstPtr& getSharedPreamble() const { 
+        return _preamble; 
+    }
+
     /**
      * Mark this Log as persistent in the Citizen framework.  This should
      * be called when storing Log objects in the global scope or when they
@@ -594,7 +751,10 @@ public:
      * global instance, the Citizen framework may complain about a leaked
      * PropertySet.
      */
-    void markPersistent() { _preamble->markPersistent(); }
+    void markPersistent() { 
+        std::const_pointer_cast<lsst::daf::base::PropertySet>(_preamble)
+            ->markPersistent(); 
+    }
 
     /**
      * obtain the default root Log instance.
@@ -645,6 +805,11 @@ public:
     void reset() { _thresholds->forgetAllNames(); }
 
 protected:
+    friend class LogHandle;
+    friend class LogRec;
+    friend class ScopedThreshold;
+    friend class DebugCapture;
+
     /**
      * the default Log
      */
@@ -660,6 +825,94 @@ protected:
 
     static const std::string _sep;
 
+    /**
+     * return false if this Log certainly cannot pass a message of the 
+     * given importance.  This is a cheap test that allows such messages 
+     * to be rejected without resolving this Log's threshold by name:  a 
+     * Log holding a threshold of its own compares against it directly, 
+     * and one that inherits its threshold compares against the lowest 
+     * threshold in its hierarchy.  (The watermark only covers thresholds
+     * in the shared tree, which a Log's own threshold may fall below, 
+     * e.g. after the tree was reset or another Log of the same name set a
+     * higher one.)
+     */
+    bool _mayPass(int importance) const {
+        int floor = (_threshold > INHERIT_THRESHOLD) 
+                        ? _threshold : _thresholds->getLowestThreshold();
+        if (importance >= floor || 
+            ScopedThreshold::isActive() || _capture != 0) 
+            return true;
+        LogMetrics::count(LogMetrics::SKIPPED);
+        if (lsst_pex_logging_reject_semaphore != 0) 
+            _probeReject(importance);
+        return false;
+    }
+
+    /**
+     * return true if a message of the given importance falls below the 
+     * given threshold and so will be rejected.
+     */
+    bool _below(int importance, int threshold) const {
+        if (importance >= threshold) return false;
+        if (lsst_pex_logging_reject_semaphore != 0) 
+            _probeReject(importance);
+        return true;
+    }
+
+    /**
+     * fire the reject probe (see probes.h) for a message of the given 
+     * importance.  This is kept out of line so that the probe is compiled
+     * into the library rather than into each caller, and it is only 
+     * called while a tracer is attached to the probe.
+     */
+    void _probeReject(int importance) const;
+
+    /**
+     * return the threshold a message must meet to be built into a 
+     * LogRecord.  This is the Log's threshold, except while a DebugCapture
+     * is in effect in the calling thread, in which case it may be lowered 
+     * so that records below the Log's threshold can be captured.
+     */
+    int _recordThreshold() const {
+        int threshold = getThreshold();
+        return ((_capture == 0) ? threshold : _captureThreshold(threshold));
+    }
+
+    /**
+     * return true if a message of the given importance should be built
+     * into a LogRecord and sent.
+     */
+    bool _records(int importance) const {
+        return (_mayPass(importance) && 
+                ! _below(importance, _recordThreshold()));
+    }
+
+    /**
+     * return the lower of the given threshold and the thresholds of the 
+     * DebugCaptures in effect in the calling thread.
+     */
+    int _captureThreshold(int threshold) const;
+
+    /**
+     * write a record to all of this Log's destinations without checking 
+     * the Log's threshold.
+     */
+    void _write(const LogRecord& record);
+
+    /**
+     * return true if two or more of this Log's destinations use the same
+     * formatter, so that a record should be rendered once for them all.
+     * This is checked when the destinations change (see 
+     * _destinationsChanged()) rather than for each record.
+     */
+    bool _sharesFormatter() const;
+
+    /**
+     * the innermost DebugCapture in effect in the calling thread, or null
+     * if there is none.
+     */
+    static thread_local DebugCapture *_capture;
+
     /**
      * format and send a message using a variable argument list.  This does 
      * not check the Log threshold; it assumes this has already been done.
@@ -672,8 +925,30 @@ protected:
      */
     void _format(int importance, const char* fmt, va_list ap);
 
+    /**
+     * build and send a record carrying a single comment.  This does not 
+     * check the Log threshold; it assumes this has already been done.
+     */
+    void _log(int threshold, int importance, boost::string_view message);
+
+    /**
+     * return a private, modifiable copy of the preamble.  Install it with 
+     * _setPreamble() once the changes are complete.  
+     */
+    lsst::daf::base::PropertySet::Ptr _copyPreamble() const {
+        return _preamble->deepCopy();
+    }
+
+    /**
+     * install a new preamble snapshot.  The given PropertySet must not be 
+     * modified afterward.
+     */
+    void _setPreamble(const lsst::daf::base::PropertySet::Ptr& preamble) {
+        _preamble = preamble;
+    }
+
 private:
-    void completePreamble();
+    void completePreamble(const lsst::daf::base::PropertySet::Ptr& preamble);
 
     int _threshold;
     std::shared_ptr<bool> _defShowAll;
@@ -691,31 +966,49 @@ protected:
      */
     std::list<std::shared_ptr<LogDestination> > _destinations;
 
+    /**
+     * note a change to the list of destinations.  A subclass that 
+     * modifies _destinations must call this afterward.
+     */
+    void _destinationsChanged() { _sharedFormatter = _sharesFormatter(); }
+
+private:
     /**
      * the list preamble data properties that are included with every 
-     * log record.
+     * log record.  This snapshot is shared and never modified in place;
+     * use _copyPreamble() and _setPreamble() to change it.
+     */
+    lsst::daf::base::PropertySet::ConstPtr _preamble;
+
+    /**
+     * true if two or more of the destinations use the same formatter
      */
-    lsst::daf::base::PropertySet::Ptr _preamble;
+    bool _sharedFormatter;
 };
 
 template <class T>
 void Log::addPreambleProperty(const std::string& name, const T& val) {
-    _preamble->add<T>(name, val);
+    lsst::daf::base::PropertySet::Ptr preamble = _copyPreamble();
+    preamble->add<T>(name, val);
+    _setPreamble(preamble);
 }
 
 template <class T>
 void Log::setPreambleProperty(const std::string& name, const T& val) {
-    _preamble->set<T>(name, val);
+    lsst::daf::base::PropertySet::Ptr preamble = _copyPreamble();
+    preamble->set<T>(name, val);
+    _setPreamble(preamble);
 }
         
 template <class T>
 void Log::log(int importance, const std::string& message, 
               const std::string& name, const T& val) {
 
-    int threshold = getThreshold();
-    if (importance < threshold)
+    if (! _mayPass(importance)) return;
+    int threshold = _recordThreshold();
+    if (_below(importance, threshold))
         return;
-    LogRecord rec(threshold, importance, *_preamble, willShowAll());
+    LogRecord rec(threshold, importance, _preamble, willShowAll());
     rec.addComment(message);
     rec.addProperty(name, val);
     send(rec);
@@ -745,7 +1038,8 @@ public:
      *                     threshold, the message will be recorded.
      */
     LogRec(Log& log, int importance) 
-        : LogRecord(log.getThreshold(), importance, log.getPreamble()), 
+        : LogRecord(log._recordThreshold(), importance, 
+                    log.getSharedPreamble()), 
           _sent(false), _log(&log)
     { }
 
@@ -790,6 +1084,22 @@ public:
         return *this;
     }  */
 
+    /**
+     * record a string comment into this message
+     */
+    LogRec& operator<<(boost::string_view comment) {
+        addComment(comment);
+        return *this;
+    }
+
+    /**
+     * record a string comment into this message
+     */
+    LogRec& operator<<(const char *comment) {
+        addComment(comment);
+        return *this;
+    }
+
     /**
      * record a string comment into this message
      */
@@ -807,6 +1117,15 @@ public:
         return *this;
     }
 
+    /**
+     * record a data property into this message
+     */
+    template <class T>
+    LogRec& operator<<(const PropRef<T>& prop) {
+        addProperty(prop);
+        return *this;
+    }
+
     /**
      * record a data property into this message
      */
@@ -70,7 +70,11 @@ public:
 };
 
 /**
- * an implementation of the LogClient interface suitable for inheriting from
+ * an implementation of the LogClient interface suitable for inheriting from.
+ *
+ * Each client holds a Log of its own.  A class with very many instances 
+ * that only sends messages can hold a LogHandle instead (see LogHandle),
+ * which shares one Log between all instances using the same name.
  */
 class LogClientHelper : public LogClient {
 public:
@@ -83,7 +87,7 @@ public:
     /**
      * Create a client to use a child of the default Log
      */
-    LogClientHelper(const string& childName) 
+    LogClientHelper(const std::string& childName) 
         : _log(Log::getDefaultLog(), childName) 
     { }
 
@@ -95,7 +99,7 @@ public:
     /**
      * Create a client to use a child of the given log
      */
-    LogClientHelper(const Log& log, const string& childName) 
+    LogClientHelper(const Log& log, const std::string& childName) 
         : _log(log, childName) 
     { }
 
@@ -105,3 +109,5 @@ protected:
 
 
 }}} // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGCLIENT_H
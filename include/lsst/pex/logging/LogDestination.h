@@ -32,10 +32,13 @@
 
 #include "lsst/pex/logging/LogFormatter.h"
 #include "lsst/pex/logging/threshold/enum.h"
+#include "lsst/pex/logging/LogMetrics.h"
+#include "lsst/pex/logging/RecordFilter.h"
 
 #include <string>
 #include <ostream>
 #include <memory>
+#include <cstddef>
 
 namespace lsst {
 namespace pex {
@@ -44,6 +47,55 @@ namespace logging {
 // forward declaration of LogRecord
 class LogRecord;
 
+/**
+ * @brief a record's text as rendered by each of the formatters it is 
+ * written with
+ *
+ * When several of a Log's destinations share a formatter (the same 
+ * LogFormatter object), Log::send() passes each of them the same 
+ * RecordRendering, so that the record is rendered once per distinct 
+ * formatter and the same immutable text is handed to each destination's
+ * stream (or writer thread).  A RecordRendering lives only as long as the 
+ * call to send() and is used by the sending thread only.
+ */
+class RecordRendering {
+public:
+    typedef std::shared_ptr<const std::string> Text;
+
+    /**
+     * prepare to render a record.  The record must outlive this object.
+     */
+    explicit RecordRendering(const LogRecord& rec) : _rec(rec), _count(0) { }
+
+    /**
+     * return the record's text as rendered by a formatter, rendering it 
+     * if that has not been done already.  Null is returned if too many
+     * different formatters have been used with this record, in which case
+     * the caller should format the record itself.
+     */
+    const Text& render(LogFormatter& formatter);
+
+    /**
+     * return the record's text as rendered by a formatter if that has 
+     * been done already, or null otherwise.
+     */
+    const Text& find(const LogFormatter& formatter) const;
+
+    /**
+     * return the record being rendered
+     */
+    const LogRecord& getRecord() const { return _rec; }
+
+private:
+    enum { MAX_FORMATTERS = 8 };
+
+    const LogRecord& _rec;
+    int _count;
+    const LogFormatter *_formatters[MAX_FORMATTERS];
+    Text _texts[MAX_FORMATTERS];
+    static const Text _none;
+};
+
 /**
  * @brief an encapsulation of a logging stream that will filter messages
  * based on their volume (importance) level.  
@@ -60,10 +112,77 @@ class LogRecord;
  * is higher than that associated with its Log, then the destination threshold
  * will override the Log's in preventing message from being recorded.  This 
  * allows some destinations to be more verbose than others.  
+ *
+ * Normally, a record is formatted and written to the stream by the thread
+ * that logs it, so a destination whose stream blocks (e.g. a terminal 
+ * piped to a slow consumer) holds up the Log and its other destinations.
+ * A destination can instead be given its own writer thread via 
+ * startWriter():  write() then only queues a copy of the record, and the 
+ * writer thread formats and writes queued records in order.  Each 
+ * destination's queue has its own capacity and overflow policy, which 
+ * says what happens when records arrive faster than the stream accepts 
+ * them.  Records dropped by the policy are counted by level, and the 
+ * writer thread periodically writes a summary record (from the Log named 
+ * "logging") reporting them.  Records still queued when the process exits
+ * normally are written out, along with a final summary; however, the 
+ * process waits no more than a few seconds in all for streams that have 
+ * stopped accepting output, and records still queued after that are lost.
+ *
+ * Beyond its threshold, a destination can be given a filter (see 
+ * setFilter()) that passes only records whose contents satisfy an 
+ * expression, e.g. "LEVEL>=WARN or LOG startswith 'pipe.io'".  
+ *
+ * Each destination keeps counters of the records it writes (see 
+ * getMetrics() and LogMetrics).
+ *
+ * Subclasses that need to act on each record as it reaches the stream 
+ * (e.g. to make it durable) can override _writeRecord().
  */
 class LogDestination {
 public:
 
+    /**
+     * the action write() takes when the writer queue is full
+     */
+    enum Overflow {
+        /**
+         * wait for the writer thread to make room in the queue.  If the 
+         * block timeout (see setBlockTimeout()) expires first, the record
+         * being written is discarded.
+         */
+        BLOCK,
+
+        /**
+         * discard the record being written
+         */
+        DROP_NEWEST,
+
+        /**
+         * discard the oldest queued record to make room
+         */
+        DROP_OLDEST,
+
+        /**
+         * shed records below the shed threshold (see setShedThreshold()):
+         * the record being written is discarded if it is below the 
+         * threshold; otherwise, the oldest queued record below the 
+         * threshold is discarded to make room.  If every queued record 
+         * meets the threshold, the writer waits as with BLOCK.
+         */
+        DROP_BELOW,
+
+        /**
+         * never wait:  shed records below the shed threshold as with 
+         * DROP_BELOW, but if every queued record meets the threshold, 
+         * discard the oldest of the least important queued records, or 
+         * the record being written if it is less important than all of 
+         * them.  Thus a FATAL record is only shed when every queued 
+         * record is FATAL.  Under a flood, the records that are not 
+         * written are reduced to the counts in the summary records.
+         */
+        SHED
+    };
+
     /**
      * @brief create a destination with a threshold.  
      * @param strm       the output stream to send messages to.  If the pointer
@@ -79,7 +198,8 @@ public:
                    int threshold=threshold::PASS_ALL);
 
     /**
-     * create a copy
+     * create a copy.  The copy writes directly to the stream; it does not
+     * share the writer thread (if any) of the original.
      */
     LogDestination(const LogDestination& that);
 
@@ -89,7 +209,9 @@ public:
     virtual ~LogDestination();
 
     /**
-     * copy a destination into this one
+     * copy a destination into this one.  Any writer thread this 
+     * destination has is stopped first; the writer thread of the other 
+     * destination is not copied.
      */
     LogDestination& operator=(const LogDestination& that);
 
@@ -105,22 +227,212 @@ public:
      */
     void setThreshold(int threshold) { _threshold = threshold; }
 
+    /**
+     * pass only the records that satisfy a filter expression (see 
+     * RecordFilter), in addition to the threshold.  The filter may be 
+     * replaced while other threads are writing to this destination; each
+     * record is tested against either the old filter or the new one.
+     * @param expr    the filter expression
+     * @throws lsst::pex::exceptions::InvalidParameterError  if the 
+     *               expression cannot be parsed.
+     */
+    void setFilter(const std::string& expr) {
+        setFilter(std::make_shared<const RecordFilter>(expr));
+    }
+
+    /**
+     * pass only the records that satisfy a filter, in addition to the 
+     * threshold.  A filter can be shared by several destinations.
+     * @param filter   the filter; if null, all records that pass the 
+     *                   threshold are written.
+     */
+    void setFilter(const std::shared_ptr<const RecordFilter>& filter) {
+        std::atomic_store(&_filter, filter);
+    }
+
+    /**
+     * remove the filter, if any, so that all records that pass the 
+     * threshold are written
+     */
+    void clearFilter() { 
+        std::atomic_store(&_filter, std::shared_ptr<const RecordFilter>());
+    }
+
+    /**
+     * return the filter applied to records, or null if there is none
+     */
+    std::shared_ptr<const RecordFilter> getFilter() const { 
+        return std::atomic_load(&_filter); 
+    }
+
     /**
      * record a given log record to this destinations output stream. The 
      * record will be sent to the stream attached to this class if (a)
      * there is actually an attached stream, (b) there is an attached
-     * formatter, and (c) the importance level associated with the
+     * formatter, (c) the importance level associated with the
      * record is equal to or greater than the threshold associated
-     * with this destination. 
+     * with this destination, and (d) the record satisfies the filter, 
+     * if there is one. 
      * @return  true if the record was actually passed to the
      *          associated stream. 
      */
     bool write(const LogRecord& rec);
 
+    /**
+     * record a given log record to this destination's output stream, as 
+     * write(const LogRecord&) does, but using the rendering of the record 
+     * by this destination's formatter from a RecordRendering shared with
+     * other destinations.  If the record has not yet been rendered by 
+     * that formatter, it is rendered into the RecordRendering for the 
+     * benefit of the destinations that follow, unless this destination
+     * has a writer thread, in which case the record is queued as usual
+     * for the writer to format.
+     * @return  true if the record was actually passed to the
+     *          associated stream. 
+     */
+    bool write(const LogRecord& rec, RecordRendering& rendering);
+
+    /**
+     * return the formatter this destination uses
+     */
+    const std::shared_ptr<LogFormatter>& getFormatter() const { 
+        return _frmtr; 
+    }
+
+    /**
+     * start a thread dedicated to writing this destination's records.  
+     * After this call, write() queues records instead of writing them 
+     * directly.  If a writer is already running, it is stopped (after 
+     * writing out its queue) and replaced.  This may be called while 
+     * other threads are writing to this destination.
+     * @param capacity   the maximum number of records that may wait in 
+     *                      the queue
+     * @param overflow   what to do with a record written when the queue 
+     *                      is full
+     * @param cpu        if non-negative, the CPU to pin the writer thread 
+     *                      to (where supported by the platform)
+     */
+    void startWriter(std::size_t capacity=1024, Overflow overflow=BLOCK, 
+                     int cpu=-1);
+
+    /**
+     * write out any queued records and stop the writer thread.  Records 
+     * written after this call are written directly.  This does nothing if 
+     * no writer thread is running.  This may be called while other 
+     * threads are writing to this destination; it waits for those 
+     * queueing records to finish doing so.
+     */
+    void stopWriter();
+
+    /**
+     * return true if this destination has a writer thread running
+     */
+    bool hasWriter() const;
+
+    /**
+     * wait until all records queued so far have been written to the 
+     * stream.  This returns immediately if no writer thread is running.
+     */
+    void flushWriter();
+
+    /**
+     * set the longest time write() will wait for room in a full queue 
+     * under the BLOCK and DROP_BELOW policies before discarding the 
+     * record.  
+     * @param millis   the timeout in milliseconds; a negative value 
+     *                   (the default) means wait indefinitely.
+     */
+    void setBlockTimeout(int millis);
+
+    /**
+     * return the longest time in milliseconds write() will wait for room 
+     * in a full queue, or a negative number if it waits indefinitely.
+     */
+    int getBlockTimeout() const { return _blockTimeout; }
+
+    /**
+     * set the importance below which records are shed first under the 
+     * DROP_BELOW policy.  The default is Log::WARN.
+     */
+    void setShedThreshold(int importance);
+
+    /**
+     * return the importance below which records are shed first under the
+     * DROP_BELOW policy.  
+     */
+    int getShedThreshold() const { return _shedThreshold; }
+
+    /**
+     * set the time between summary records reporting dropped records.  A 
+     * summary is only written if records were dropped since the last one;
+     * one is also written when the writer thread stops.  
+     * @param seconds   the interval in seconds; zero or less means 
+     *                    summarize only when the writer stops.
+     */
+    void setDropSummaryInterval(int seconds);
+
+    /**
+     * return the time in seconds between summary records reporting 
+     * dropped records.
+     */
+    int getDropSummaryInterval() const { return _summaryInterval; }
+
+    /**
+     * return the total number of records dropped by the overflow policy
+     * since the writer thread was started.
+     */
+    std::size_t getDroppedCount() const;
+
+    /**
+     * return a snapshot of the counters describing this destination's 
+     * activity.  
+     */
+    DestinationMetrics getMetrics() const { return _metrics->snapshot(); }
+
+    /**
+     * return a copy of the histogram of the time taken by write().  The 
+     * histogram is empty unless latency recording is on (see 
+     * LogMetrics::setLatencyRecording()).
+     */
+    LatencyHistogram getWriteLatency() const { 
+        return _metrics->writeLatency(); 
+    }
+
+    /**
+     * set the label identifying this destination in the metrics.  
+     * File destinations are labeled with their paths.
+     */
+    void setLabel(const std::string& label) { _metrics->setLabel(label); }
+
 protected:
+    /**
+     * format a record and write it to the stream.  This is called by the 
+     * thread that writes the stream:  the thread calling write() or, if 
+     * one is running, the writer thread.  The default implementation 
+     * passes the record to the formatter (or, if text is given, writes 
+     * the text) and updates the metrics.
+     * @param rec    the record to write
+     * @param text   the record as already rendered by this destination's 
+     *                 formatter, or null if it must be formatted
+     */
+    virtual void _writeRecord(const LogRecord& rec, const std::string *text);
+
     int _threshold;   // the stream's threshold
     std::ostream *_strm;   // the output stream
     std::shared_ptr<LogFormatter> _frmtr;    // the formatter to use
+    std::shared_ptr<const RecordFilter> _filter;  // the content filter
+
+private:
+    class Writer;
+
+    bool _write(const LogRecord& rec, RecordRendering *rendering);
+
+    std::shared_ptr<Writer> _writer;  // the writer thread, if any; 
+                                      //   read and set atomically
+    int _blockTimeout;      // max wait (ms) for room in a full queue
+    int _shedThreshold;     // importance shed first under DROP_BELOW
+    int _summaryInterval;   // seconds between drop summaries
+    std::shared_ptr<LogMetrics::Destination> _metrics;  // activity counters
 };
 
 }}}     // end lsst::pex::logging
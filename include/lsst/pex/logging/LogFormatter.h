@@ -33,8 +33,13 @@
 #define LSST_PEX_LOGFORMATTER_H
 
 #include <string>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 #include "lsst/daf/base/PropertySet.h"
 #include "boost/any.hpp"
@@ -61,6 +66,10 @@ class LogRecord;
  *    COMMENT    string    a simple text message
  *    TIMESTAMP  DateTime  the timestamp when the message was recorded
  *    DATE       string    the value of TIMESTAMP in ISO format
+ *    MONOTONIC  long long the monotonic clock time (in nanoseconds) when 
+ *                           the message was recorded, for measuring 
+ *                           durations (optional; see 
+ *                           LogRecord::stampMonotonic())
  *    HOST       string    the hostname of the machine
  *    IP         string    the IP address of the host
  *    PID        int       the process id of the application 
@@ -92,13 +101,98 @@ public:
 
 };
 
+/**
+ * @brief the rendered properties of the preamble snapshots a formatter 
+ * has seen.
+ *
+ * The preamble a Log attaches to its records seldom changes, yet a 
+ * formatter that shows every property would render each preamble property
+ * again for every record.  A formatter can instead keep a PreambleCache 
+ * and render the properties of each snapshot (see 
+ * LogRecord::getSharedPreamble()) only the first time a record carries it.
+ * A snapshot is never modified; a change to a Log's preamble installs a 
+ * new one.  The cache holds on to the snapshots it has rendered, so a 
+ * snapshot's identity serves as the version of the preamble it contains.
+ * The renderings of the last MAX_SNAPSHOTS snapshots are kept.
+ */
+class PreambleCache {
+public:
+
+    /**
+     * the maximum number of snapshots whose renderings are kept
+     */
+    static const int MAX_SNAPSHOTS = 8;
+
+    /**
+     * a function that renders a property to a stream
+     */
+    typedef std::function<void (std::ostream *strm, 
+                                lsst::daf::base::PropertySet const& props,
+                                std::string const& name)> Render;
+
+    /**
+     * the rendered properties of a single snapshot
+     */
+    class Texts {
+    public:
+        Texts(lsst::daf::base::PropertySet::ConstPtr const& snapshot,
+              Render const& render);
+
+        /**
+         * return the rendered text of the named property, or null if the 
+         * snapshot does not have it
+         */
+        std::string const *find(std::string const& name) const {
+            for (auto const& text : _texts) 
+                if (text.first == name) return &text.second;
+            return 0;
+        }
+
+        /**
+         * return the snapshot that was rendered
+         */
+        lsst::daf::base::PropertySet::ConstPtr const& getSnapshot() const {
+            return _snapshot;
+        }
+
+    private:
+        lsst::daf::base::PropertySet::ConstPtr _snapshot;
+        std::vector<std::pair<std::string, std::string> > _texts;
+    };
+
+    PreambleCache() : _texts(), _next(0) {}
+
+    /**
+     * create an empty cache; renderings are not copied
+     */
+    PreambleCache(PreambleCache const& that) : _texts(), _next(0) {}
+
+    PreambleCache& operator=(PreambleCache const& that) { return *this; }
+
+    /**
+     * return the rendered properties of a snapshot, rendering them with 
+     * the given function if this has not already been done.  
+     */
+    std::shared_ptr<Texts const> 
+    get(lsst::daf::base::PropertySet::ConstPtr const& snapshot, 
+        Render const& render);
+
+private:
+    std::mutex _mtx;
+    std::vector<std::shared_ptr<Texts const> > _texts;
+    int _next;
+};
+
 /**
  * @brief a formatter that renders records in a brief format for screen 
  * display.
  *
  * This formatter has a normal mode and a verbose mode.  In normal mode,
  * only the log name (LOG) and text messages (COMMENT) are printed.  In 
- * verbose mode, all other properties are printed as well.
+ * verbose mode, all other properties are printed as well.  The lines 
+ * after the first of a multi-line comment or string value are indented 
+ * so that they stay visibly within their record, and control characters
+ * other than tabs are written as "\\xHH" escapes (see writeIndented()).
  */
 class BriefFormatter : public LogFormatter {
 public:
@@ -148,6 +242,13 @@ public:
      */
     virtual void write(std::ostream *strm, LogRecord const& rec);
 
+protected:
+
+    /**
+     * the rendered properties of the preambles seen in verbose mode
+     */
+    PreambleCache _preambleCache;
+
 private:
 
     bool _doAll;
@@ -193,7 +294,10 @@ public:
 /**
  * \brief a formatter that renders records in a netlogger-like format.  
  * 
- * This is the format intended for use with the Event system.  
+ * This is the format intended for use with the Event system.  Each value
+ * is written on a line of its own; line breaks and other control 
+ * characters in string values are escaped (see writeEscaped()) so that 
+ * they cannot break up a record.
  */
 class NetLoggerFormatter : public LogFormatter {
 public: 
@@ -233,9 +337,13 @@ public:
 private:
     typedef std::map<std::string, char> TypeSymbolMap;
     void loadTypeLookup();
+    bool writeProperty(std::ostream *strm, 
+                       lsst::daf::base::PropertySet const& props,
+                       std::string const& name);
 
     TypeSymbolMap _tplookup;
     std::string _midfix;
+    PreambleCache _preambleCache;
 };
 
 /**
@@ -0,0 +1,212 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LogHandle.h
+ * @brief definition of the LogHandle class
+ */
+#ifndef LSST_PEX_LOGHANDLE_H
+#define LSST_PEX_LOGHANDLE_H
+
+#include "lsst/pex/logging/Log.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <boost/utility/string_view.hpp>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief a lightweight reference to a Log shared by every handle with the
+ * same name.
+ *
+ * Constructing a child Log copies the parent's name, destination list and
+ * preamble and touches the threshold tree.  That is too much to do for
+ * every instance of a class that creates millions of objects, each with
+ * its own Log (e.g. via LogClientHelper).  A LogHandle instead refers to
+ * an interned Log:  the first handle created for a given name (relative
+ * to a given parent) builds the Log; later handles for the same name
+ * simply share it.  Once a name has been seen, creating a handle costs a
+ * table lookup and a reference count increment; no memory is allocated.
+ *
+ * A handle behaves like a Log constructed the same way, provided the
+ * parent's configuration (destinations, preamble and threshold memory)
+ * has not changed since the name was interned; if it has, a fresh Log is
+ * interned.  Because the Log is shared, state that a Log keeps locally
+ * (its threshold setting and show-all preference) is shared by all the
+ * handles with that name, as is anything changed through getLog() (e.g.
+ * labels or destinations).  Such changes are not synchronized with other
+ * threads logging through the same Log, so a handle is best used where 
+ * the Log is configured before it is shared and then only sent messages;
+ * an object that needs to configure its own Log should hold a Log.
+ *
+ * LogHandle provides the Log messaging API by forwarding to the shared
+ * Log, and it converts implicitly to a Log reference for code that needs
+ * one.
+ *
+ * The interned Logs are held weakly and go away with their last handle.
+ * The table of names is swept of such names as it grows, so it stays 
+ * within a small multiple of the number of names with live handles.
+ */
+class LogHandle {
+public:
+
+    /**
+     * create a handle for the default Log
+     */
+    LogHandle();
+
+    /**
+     * create a handle for a copy of a given Log.  If log is an unmodified
+     * copy of the Log used to create an existing handle, the two will
+     * share the same Log.
+     */
+    LogHandle(const Log& log);
+
+    /**
+     * create a handle for a child of the default Log.
+     * @param childName     the name of the child log, relative to the
+     *                          default Log.
+     */
+    explicit LogHandle(boost::string_view childName);
+
+    /**
+     * create a handle for a child of a given Log.  The handle will behave
+     * like Log(parent, childName).
+     * @param parent        the Log that will serve as its parent.
+     * @param childName     the name of the child log, relative to the given
+     *                          parent.
+     */
+    LogHandle(const Log& parent, boost::string_view childName);
+
+    /**
+     * return the shared Log this handle refers to
+     */
+    Log& getLog() const { return *_log; }
+
+    //@{
+    /**
+     * return the shared Log this handle refers to
+     */
+    operator Log&() const { return *_log; }
+    Log *operator->() const { return _log.get(); }
+    //@}
+
+    /**
+     * return the name associated with the Log
+     */
+    const std::string& getName() const { return _log->getName(); }
+
+    /**
+     * return the importance threshold for the Log.
+     */
+    int getThreshold() const { return _log->getThreshold(); }
+
+    /**
+     * set the importance threshold for the Log.  This affects all handles
+     * with the same name.
+     */
+    void setThreshold(int threshold) { _log->setThreshold(threshold); }
+
+    /**
+     * return true if the threshold is low enough to pass messages of a
+     * given loudness or importance.
+     */
+    bool sends(int importance) const { return _log->sends(importance); }
+
+    /**
+     * reset the importance threshold of the Log to that of its parent
+     */
+    void resetThreshold() { _log->resetThreshold(); }
+
+    /**
+     * set the importance threshold for a child Log.
+     */
+    void setThresholdFor(const std::string& name, int threshold) {
+        _log->setThresholdFor(name, threshold);
+    }
+
+    /**
+     * get the importance threshold for a child Log.
+     */
+    int getThresholdFor(const std::string& name) const {
+        return _log->getThresholdFor(name);
+    }
+
+    /**
+     * return true if the Log will prefer showing all properties when
+     * rendering log records.
+     */
+    bool willShowAll() const { return _log->willShowAll(); }
+
+    /**
+     * return the current preamble snapshot of the Log
+     */
+    const lsst::daf::base::PropertySet::ConstPtr& getSharedPreamble() const {
+        return _log->getSharedPreamble();
+    }
+
+    /**
+     * send a fully formed LogRecord to the log destinations
+     */
+    void send(const LogRecord& record) { _log->send(record); }
+
+    /**
+     * Forwarding versions of the Log messaging functions.  Each accepts
+     * the same arguments as the Log function of the same name:
+     *
+     *   log(), logdebug(), info(), warn(), fatal(),
+     *   format(), debugf(), infof(), warnf(), fatalf()
+     */
+#define LEVELF(fname)                                               \
+    template <typename... Args>                                     \
+    void fname(Args&&... args) {                                    \
+        _log->fname(std::forward<Args>(args)...);                   \
+    }
+    LEVELF(log)
+    LEVELF(logdebug)
+    LEVELF(info)
+    LEVELF(warn)
+    LEVELF(fatal)
+    LEVELF(format)
+    LEVELF(debugf)
+    LEVELF(infof)
+    LEVELF(warnf)
+    LEVELF(fatalf)
+#undef LEVELF
+
+private:
+    static std::shared_ptr<Log> _internCopy(const Log& log);
+    static std::shared_ptr<Log> _internChild(const Log& parent, 
+                                             boost::string_view childName);
+
+    std::shared_ptr<Log> _log;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGHANDLE_H
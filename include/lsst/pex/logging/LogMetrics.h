@@ -0,0 +1,324 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LogMetrics.h
+ * @brief definition of the LogMetrics class
+ */
+#ifndef LSST_PEX_LOGGING_LOGMETRICS_H
+#define LSST_PEX_LOGGING_LOGMETRICS_H
+
+#include "lsst/pex/logging/LatencyHistogram.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief a snapshot of the activity of a LogDestination
+ *
+ * The counts are totals over the life of the destination; rates can be 
+ * computed by differencing two snapshots.  Bytes and times are only 
+ * accumulated while timing is enabled (see LogMetrics::setTiming()).
+ */
+struct DestinationMetrics {
+    /**
+     * a number identifying the destination, unique within the process
+     */
+    unsigned int id;
+
+    /**
+     * a description of the destination (e.g. the path of a log file)
+     */
+    std::string label;
+
+    /** the number of records written to the stream */
+    std::uint64_t records;
+
+    /** the number of bytes written to the stream */
+    std::uint64_t bytes;
+
+    /** the time spent formatting records, in nanoseconds */
+    std::uint64_t formatNanos;
+
+    /** the time spent writing formatted records to the stream, in ns */
+    std::uint64_t writeNanos;
+
+    /** the number of records waiting for the writer thread */
+    std::uint64_t queued;
+
+    /** the most records that have waited for the writer thread at once */
+    std::uint64_t maxQueued;
+
+    /** the number of records discarded because the queue was full */
+    std::uint64_t dropped;
+};
+
+/**
+ * @brief counters that describe the activity of the logging system itself
+ *
+ * LogMetrics answers the question of whether logging is a bottleneck.  It
+ * keeps two sorts of counters:
+ * <ul>
+ *   <li> per-thread event counters (see Counter) updated on the path every
+ *        message takes, including those that are rejected.  Each thread
+ *        increments its own counters with plain loads and stores, so 
+ *        counting costs about a nanosecond and involves no locks or 
+ *        shared cache lines.  get() sums the counters of all threads, 
+ *        including those that have exited.
+ *   <li> per-destination counters (see DestinationMetrics), updated as 
+ *        each record is written to a destination's stream.  Record counts 
+ *        and queue depths are always kept.  Timing a record's formatting 
+ *        and writing requires reading the clock, which costs far more 
+ *        than counting, so it is done only while setTiming(true) is in 
+ *        effect.  While timing, a record is formatted into a buffer and 
+ *        the buffer written to the stream, so that the two steps can be 
+ *        timed separately and the bytes counted.
+ * </ul>
+ *
+ * Optionally (see setLatencyRecording()), LogMetrics also keeps 
+ * histograms of latency (see LatencyHistogram):  one of the time Logs 
+ * spend sending records to their destinations, and one per destination 
+ * of the time its write() takes.  A stall in sending can then be traced 
+ * to the destination that caused it.
+ *
+ * The counters can be read at any time via the static functions of this
+ * class (from C++ or Python).  startReporting() starts a thread that 
+ * periodically logs the rates since its previous report as INFO records 
+ * to the Log named "logging.stats" (a child of the default Log).
+ */
+class LogMetrics {
+public:
+
+    /**
+     * the events counted per thread
+     */
+    enum Counter {
+        /** records sent by a Log to its destinations */
+        SENT,
+
+        /** messages rejected by the threshold watermark without a lookup */
+        SKIPPED,
+
+        /** thresholds resolved without consulting the threshold memory 
+            (because the Log or a ScopedThreshold set one) */
+        LOCAL,
+
+        /** thresholds resolved by looking up the Log's name in the 
+            threshold memory */
+        LOOKUPS,
+
+        NCOUNTERS
+    };
+
+    /**
+     * count an event in the calling thread
+     */
+    static void count(Counter which) {
+        Block *b = _block;
+        if (b == 0) b = _newBlock();
+        std::atomic<std::uint64_t>& n = b->n[which];
+        if (b->shared) 
+            n.fetch_add(1, std::memory_order_relaxed);
+        else
+            n.store(n.load(std::memory_order_relaxed) + 1, 
+                    std::memory_order_relaxed);
+    }
+
+    /**
+     * return the number of events of a given kind counted so far, summed 
+     * over all threads
+     */
+    static std::uint64_t get(Counter which);
+
+    /**
+     * return the fraction of threshold checks that were settled without 
+     * looking up the threshold memory (i.e. SKIPPED + LOCAL over SKIPPED +
+     * LOCAL + LOOKUPS), or 1 if there have been none.
+     */
+    static double getThresholdHitRate();
+
+    /**
+     * return snapshots of the counters of all existing destinations, in 
+     * order of creation
+     */
+    static std::vector<DestinationMetrics> getDestinationMetrics();
+
+    /**
+     * turn the timing of formatting and writing on or off.  It is off 
+     * by default.
+     */
+    static void setTiming(bool on) { 
+        _timing.store(on, std::memory_order_relaxed); 
+    }
+
+    /**
+     * return true if formatting and writing are being timed
+     */
+    static bool isTiming() { 
+        return _timing.load(std::memory_order_relaxed); 
+    }
+
+    /**
+     * turn the recording of latency histograms on or off.  It is off by
+     * default.  The histograms are kept once recording has been turned 
+     * on.
+     */
+    static void setLatencyRecording(bool on) {
+        _latency.store(on, std::memory_order_relaxed);
+    }
+
+    /**
+     * return true if latency histograms are being recorded
+     */
+    static bool isRecordingLatency() {
+        return _latency.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * return a copy of the histogram of the time taken by Logs to send 
+     * records to all their destinations
+     */
+    static LatencyHistogram getSendLatency();
+
+    /**
+     * return a copy of the histogram of the time taken by a destination's
+     * write().  An empty histogram is returned if there is no destination
+     * with the given id.
+     * @param id    the destination's id (see DestinationMetrics)
+     */
+    static LatencyHistogram getWriteLatency(unsigned int id);
+
+    /**
+     * record the time taken to send a record that began at a given time
+     */
+    static void recordSendLatency(std::chrono::steady_clock::time_point start);
+
+    /**
+     * start periodically logging the metrics to the "logging.stats" Log.
+     * If reports are already being logged, the interval is changed.
+     * @param seconds   the time between reports; it must be positive.
+     */
+    static void startReporting(int seconds=60);
+
+    /**
+     * stop logging reports of the metrics.  This should be called before
+     * the default Log is closed.
+     */
+    static void stopReporting();
+
+    /**
+     * log a report of the metrics to the "logging.stats" Log now.  The 
+     * rates are computed over the time since the previous report (or the 
+     * first use of the logging system).
+     */
+    static void report();
+
+    //@cond
+    /*
+     * the counters of one destination.  A LogDestination holds these, 
+     * and the registry keeps track of them for getDestinationMetrics().
+     */
+    class Destination {
+    public:
+        std::atomic<std::uint64_t> records, bytes, formatNanos, writeNanos,
+                                   queued, maxQueued, dropped;
+
+        /*
+         * update the queue depth (with the queue's lock held)
+         */
+        void setQueued(std::size_t depth) {
+            queued.store(depth, std::memory_order_relaxed);
+            if (depth > maxQueued.load(std::memory_order_relaxed))
+                maxQueued.store(depth, std::memory_order_relaxed);
+        }
+
+        /*
+         * set the label (under the registry's lock)
+         */
+        void setLabel(const std::string& label);
+
+        /*
+         * return a snapshot of the counters
+         */
+        DestinationMetrics snapshot() const;
+
+        /*
+         * record the time taken by a write that began at a given time
+         */
+        void recordWrite(std::chrono::steady_clock::time_point start);
+
+        /*
+         * return a copy of the write latency histogram 
+         */
+        LatencyHistogram writeLatency() const;
+
+        ~Destination();
+
+        const unsigned int id;
+
+    private:
+        friend class LogMetrics;
+        Destination(unsigned int id);
+        std::atomic<LatencyHistogram*> _writeLatency;
+        DestinationMetrics _snapshot() const;
+        std::string _label;
+    };
+
+    /*
+     * create and register the counters for a new destination
+     */
+    static std::shared_ptr<Destination> _newDestination();
+    //@endcond
+
+private:
+    // a thread's counters.  A block is only written by the thread that 
+    // owns it, except a shared one, which threads count into after their
+    // own block has been released at exit.
+    struct Block {
+        explicit Block(bool isShared=false);
+        std::atomic<std::uint64_t> n[NCOUNTERS];
+        const bool shared;
+    };
+    struct Registry;
+
+    static Registry& _registry();
+
+    static Block *_newBlock();
+
+    static thread_local Block *_block;
+    static std::atomic<bool> _timing;
+    static std::atomic<bool> _latency;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_LOGMETRICS_H
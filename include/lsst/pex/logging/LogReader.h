@@ -0,0 +1,385 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+/**
+ * @file LogReader.h
+ * @brief definition of the LogReader class
+ */
+#ifndef LSST_PEX_LOGGING_LOGREADER_H
+#define LSST_PEX_LOGGING_LOGREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief a reader of the log files written by NetLoggerFormatter and 
+ * PrependedFormatter
+ *
+ * A LogReader maps a log file into memory and parses the records in it 
+ * where they lie, without copying the text.  The records can be visited 
+ * one at a time:
+ * @code
+ *   LogReader reader("pipeline.log");
+ *   for (const LogReader::Record& rec : reader) {
+ *       const LogReader::Field *level = rec.find("LEVEL");
+ *       if (level && level->asInteger() >= Log::WARN) 
+ *           std::cout << rec.find("COMMENT")->asString() << std::endl;
+ *   }
+ * @endcode
+ * or gathered into a typed column per property with readColumns(), which
+ * parses separate parts of the file in parallel.
+ *
+ * In the NetLogger format, each property is on a line of its own, 
+ * preceded by a type code (see NetLoggerFormatter), and a blank line ends
+ * a record.  The type codes are used to rebuild integers, floating-point
+ * numbers and booleans directly from the mapped text.  String values are
+ * unescaped (see writeEscaped()).
+ *
+ * In the Prepended format, a line that does not start with a space 
+ * holds the DATE, LABEL, LOG and COMMENT of a record; the LEVEL is 
+ * recovered from the level tag (so INFO, WARN, FATAL and DEBUG records 
+ * read as 0, 10, 20 and -10).  The indented continuation lines of a 
+ * comment (see writeIndented()) are joined back into it, and consecutive
+ * lines that differ only in their comments are read as the comments of 
+ * one record.  In files written in verbose mode, the "  name: value" 
+ * lines that follow are read as string properties of the record (but 
+ * LEVEL, TIMESTAMP and MONOTONIC, which are read as integers); a DATE or
+ * LEVEL given there replaces the one read from the first line.  If a 
+ * label itself contains ": ", it must be enclosed in braces (as the 
+ * dictionary-like labels used with this format are) to be read correctly.
+ */
+class LogReader {
+public:
+
+    /**
+     * the formats a LogReader can read
+     */
+    enum Format {
+        /**
+         * the format written by NetLoggerFormatter
+         */
+        NETLOGGER,
+
+        /**
+         * the format written by PrependedFormatter
+         */
+        PREPENDED
+    };
+
+    /**
+     * @brief a property value as it appears in the file
+     */
+    class Field {
+    public:
+        Field(boost::string_view name, char type, boost::string_view text,
+              bool escaped)
+            : _name(name), _text(text), _type(type), _escaped(escaped) 
+        { }
+
+        /**
+         * return the property name
+         */
+        boost::string_view getName() const { return _name; }
+
+        /**
+         * return the NetLogger type code of the value:  'i', 'l' or 'L' 
+         * for integers, 'f' or 'd' for floating-point numbers, 'b' for 
+         * booleans, 'c' for characters, 's' or 't' for strings and '?' 
+         * for values of other types.  Values read from the Prepended 
+         * format are strings, except the LEVEL, which is an integer.
+         */
+        char getType() const { return _type; }
+
+        /**
+         * return the value's text as it appears in the file
+         */
+        boost::string_view getText() const { return _text; }
+
+        /**
+         * return the value as an integer.  Booleans are returned as 1 
+         * or 0.
+         * @throws lsst::pex::exceptions::TypeError  if the value is not 
+         *               an integer or a boolean
+         */
+        std::int64_t asInteger() const;
+
+        /**
+         * return the value as a floating-point number
+         * @throws lsst::pex::exceptions::TypeError  if the value is not 
+         *               a number
+         */
+        double asFloat() const;
+
+        /**
+         * return the value as a boolean
+         * @throws lsst::pex::exceptions::TypeError  if the value is not 
+         *               a boolean or an integer
+         */
+        bool asBool() const { return asInteger() != 0; }
+
+        /**
+         * return the value as a string, undoing the escaping or 
+         * indentation the formatter applied to it
+         */
+        std::string asString() const;
+
+    private:
+        friend class LogReader;
+        boost::string_view _name, _text;
+        char _type;
+        bool _escaped;   // true if _text is escaped (rather than indented)
+    };
+
+    /**
+     * @brief a record read from the file.  Its fields refer to the mapped
+     * file, so a record is only valid while its LogReader exists.
+     */
+    class Record {
+    public:
+        typedef std::vector<Field>::const_iterator const_iterator;
+
+        /**
+         * return the fields of the record in the order they appear
+         */
+        const std::vector<Field>& getFields() const { return _fields; }
+
+        const_iterator begin() const { return _fields.begin(); }
+        const_iterator end() const { return _fields.end(); }
+
+        /**
+         * return the number of fields in the record
+         */
+        std::size_t size() const { return _fields.size(); }
+
+        /**
+         * return the last field with the given name (as the last value 
+         * of a property is the one that counts), or null if there is none
+         */
+        const Field *find(boost::string_view name) const;
+
+        /**
+         * return the offset in the file at which the record starts
+         */
+        std::size_t getOffset() const { return _offset; }
+
+    private:
+        friend class LogReader;
+        std::vector<Field> _fields;
+        std::size_t _offset;
+    };
+
+    /**
+     * @brief an input iterator over the records of a file
+     */
+    class iterator : public std::iterator<std::input_iterator_tag, Record> {
+    public:
+        iterator() : _reader(0), _next(0), _end(0), _rec() { }
+
+        const Record& operator*() const { return _rec; }
+        const Record *operator->() const { return &_rec; }
+        iterator& operator++();
+        bool operator==(const iterator& that) const { 
+            return _reader == that._reader; 
+        }
+        bool operator!=(const iterator& that) const { 
+            return _reader != that._reader; 
+        }
+
+    private:
+        friend class LogReader;
+        iterator(const LogReader *reader, const char *begin, 
+                 const char *end);
+
+        const LogReader *_reader;   // null at the end
+        const char *_next, *_end;
+        Record _rec;
+    };
+
+    /**
+     * @brief the values of one property across all the records of a 
+     * file, stored by type
+     *
+     * A column's type is set by the first value read; it becomes FLOAT 
+     * if floating-point numbers follow integers, and STRING if other 
+     * kinds of values are mixed.  A record without the property leaves 
+     * a gap in the column, marked as not present.  If a record has 
+     * several values for the property, the last one is kept, except that
+     * several strings (e.g. comments) are joined with newlines.
+     */
+    class Column {
+    public:
+        enum Type { INTEGER, FLOAT, BOOL, STRING };
+
+        Column() 
+            : _type(INTEGER), _typed(false), _integers(), _floats(), 
+              _strings(), _present() 
+        { }
+
+        /**
+         * return the type of the values
+         */
+        Type getType() const { return _type; }
+
+        /**
+         * return the number of records covered (including gaps)
+         */
+        std::size_t size() const { return _present.size(); }
+
+        /**
+         * return the values of an INTEGER or BOOL column
+         */
+        const std::vector<std::int64_t>& getIntegers() const { 
+            return _integers; 
+        }
+
+        /**
+         * return the values of a FLOAT column.  Gaps are NaN.
+         */
+        const std::vector<double>& getFloats() const { return _floats; }
+
+        /**
+         * return the values of a STRING column.  Gaps are empty.
+         */
+        const std::vector<std::string>& getStrings() const { 
+            return _strings; 
+        }
+
+        /**
+         * return, for each record, 1 if it had a value for the property 
+         * or 0 if it did not
+         */
+        const std::vector<std::uint8_t>& getPresent() const { 
+            return _present; 
+        }
+
+        /**
+         * set the value for a given record from a field
+         */
+        void set(std::size_t row, const Field& field);
+
+        /**
+         * extend the column with gaps to cover a number of records
+         */
+        void pad(std::size_t rows);
+
+        /**
+         * append the values of another column 
+         */
+        void append(const Column& that);
+
+    private:
+        void _promote(Type type);
+
+        Type _type;
+        bool _typed;   // false until the first value sets the type
+        std::vector<std::int64_t> _integers;
+        std::vector<double> _floats;
+        std::vector<std::string> _strings;
+        std::vector<std::uint8_t> _present;
+    };
+
+    /**
+     * the columns of a file, by property name
+     */
+    typedef std::map<std::string, Column> Columns;
+
+    /**
+     * map a log file into memory for reading
+     * @param path        the path to the file
+     * @param format      the format the file was written in
+     * @param valueDelim  the delimiter between names and values in the 
+     *                      NetLogger format (see 
+     *                      NetLoggerFormatter::getValueDelimiter())
+     * @throws lsst::pex::exceptions::RuntimeError  if the file cannot be
+     *               opened or mapped
+     */
+    explicit LogReader(const std::string& path, Format format=NETLOGGER, 
+                       const std::string& valueDelim=": ");
+
+    /**
+     * unmap the file
+     */
+    ~LogReader();
+
+    LogReader(const LogReader&) = delete;
+    LogReader& operator=(const LogReader&) = delete;
+
+    /**
+     * return the format being read
+     */
+    Format getFormat() const { return _format; }
+
+    /**
+     * return the size of the file in bytes
+     */
+    std::size_t size() const { return _size; }
+
+    /**
+     * return an iterator at the first record in the file
+     */
+    iterator begin() const { return iterator(this, _data, _data + _size); }
+
+    /**
+     * return the iterator that follows the last record
+     */
+    iterator end() const { return iterator(); }
+
+    /**
+     * read all the records into columns.  The file is divided at record 
+     * boundaries into parts that are parsed in parallel.
+     * @param nthreads   the number of threads to use; zero or less means
+     *                     one per available CPU (but no more than one per 
+     *                     megabyte of file).
+     */
+    Columns readColumns(int nthreads=0) const;
+
+private:
+    const char *_parse(const char *p, const char *end, Record& rec) const;
+    const char *_parseNetLogger(const char *p, const char *end, 
+                                Record& rec) const;
+    const char *_parsePrepended(const char *p, const char *end, 
+                                Record& rec) const;
+    const char *_nextRecord(const char *p, const char *end) const;
+    std::size_t _readColumns(const char *begin, const char *end, 
+                             Columns& columns) const;
+
+    Format _format;
+    std::string _delim;
+    const char *_data;
+    std::size_t _size;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_LOGREADER_H
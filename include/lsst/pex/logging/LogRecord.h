@@ -32,14 +32,19 @@
 
 #include "lsst/daf/base/PropertySet.h"
 
+#include <cstddef>
 #include <memory>
 #include <boost/format.hpp>
+#include <boost/utility/string_view.hpp>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <sys/time.h>
 
 #define LSST_LP_COMMENT     "COMMENT"
 #define LSST_LP_TIMESTAMP   "TIMESTAMP"
 #define LSST_LP_DATE        "DATE"
+#define LSST_LP_MONOTONIC   "MONOTONIC"
 #define LSST_LP_LOG         "LOG"
 #define LSST_LP_LABEL       "LABEL"
 #define LSST_LP_LEVEL       "LEVEL"
@@ -91,11 +96,87 @@ public:
         : RecordProperty<T>(pname, value) { }
 };
 
+/**
+ * @brief a named reference to a data item, for attaching to a log message
+ *
+ * Unlike Prop, which copies its name into a std::string, a PropRef holds 
+ * only references to its name and value, so creating one costs nothing;
+ * the name is converted to a string only if the message it is attached to
+ * is recorded.  Like Prop, it should be used only in the scope of its 
+ * arguments.  A PropRef is normally created with prop():
+ * @code
+ *   log.info("measured source", prop("flux", f), prop("ccd", id));
+ * @endcode
+ */
+template <class T>
+class PropRef {
+public:
+    typedef T ValueType;
+
+    PropRef(boost::string_view pname, const T& pvalue) 
+        : name(pname), value(pvalue) { }
+
+    const boost::string_view name;
+    const T& value;
+};
+
+/**
+ * create a PropRef, a named reference to a data item
+ */
+template <class T>
+PropRef<T> prop(boost::string_view name, const T& value) {
+    return PropRef<T>(name, value);
+}
+
+/**
+ * true if P is a type of named data item that can be attached to a log 
+ * message:  a RecordProperty (or Prop) or a PropRef.
+ */
+template <class P, class Enable=void>
+struct IsRecordProperty : std::false_type { };
+
+//@cond
+template <class P>
+struct IsRecordProperty<P, typename std::enable_if<
+        std::is_base_of<RecordProperty<typename P::ValueType>, P>::value ||
+        std::is_same<PropRef<typename P::ValueType>, P>::value>::type> 
+    : std::true_type 
+{ };
+//@endcond
+
+/**
+ * true if all of the types given are named data items that can be 
+ * attached to a log message (see IsRecordProperty).
+ */
+template <class... Ps>
+struct AreRecordProperties : std::true_type { };
+
+//@cond
+template <class P, class... Ps>
+struct AreRecordProperties<P, Ps...> 
+    : std::integral_constant<bool, IsRecordProperty<P>::value && 
+                                   AreRecordProperties<Ps...>::value> 
+{ };
+//@endcond
+
 /**
  * @brief a container for constructing a single Log record
  *
  * The purpose of this class is to collect data for inclusion in a message
  * to a Log.  
+ *
+ * A record created with a shared preamble (see Log::getSharedPreamble()) 
+ * refers to the preamble rather than copying it.  Its contents are as 
+ * though the preamble had been copied:  a value added under a name the 
+ * preamble also has is added after the preamble's values (which are 
+ * copied into the record's own properties at that point), and a value 
+ * of a different type raises a TypeError.
+ *
+ * As with other containers, a record must not be modified while another 
+ * thread reads it, but any number of threads may read the same record 
+ * through the const interface at once.  Properties that are created only
+ * when first asked for (TIMESTAMP, DATE and the merged data()) are 
+ * created under a lock.
  */
 class LogRecord {
 public:
@@ -132,17 +213,59 @@ public:
     LogRecord(int threshold, int importance, 
               const lsst::daf::base::PropertySet& preamble, bool showAll=false);
 
+    /**
+     * Create a log record that shares an immutable preamble.  Unlike the 
+     * constructor that takes a PropertySet reference, the preamble is not
+     * copied; the record simply holds a reference to it.  The preamble
+     * must not be modified after it is handed to a record.
+     * @param threshold  the importance threshold that determines if a message
+     *                     is printed.
+     * @param importance  the loudness of the record.  If this value is 
+     *                     greater than or equal to the given importance 
+     *                     threshold, the message will be recorded.
+     * @param preamble   the shared preamble snapshot (as returned by 
+     *                     Log::getSharedPreamble()).
+     * @param showAll    if true, prefer showing all properties when 
+     *                     rendering this record.  The default is false.
+     *                     (See willShowAll().)
+     */
+    LogRecord(int threshold, int importance, 
+              const lsst::daf::base::PropertySet::ConstPtr& preamble, 
+              bool showAll=false);
+
     /**
      * create a copy of a record
      */
     LogRecord(const LogRecord& that) 
-        : _send(that._send), _showAll(that._showAll), _vol(that._vol), _data()
+        : _send(that._send), _showAll(that._showAll), _vol(that._vol), 
+          _nsecs(that._nsecs), _monoNsecs(that._monoNsecs), 
+          _monoStamp(that._monoStamp), _lazyDate(that._lazyDate), 
+          _dates(that._sharedDates()), _preamble(that._preamble), 
+          _data(), _merged()
     { 
         _data = that._data->deepCopy();
     }   
 
     /**
-     * delete this log record
+     * create a record by taking over the properties of another, which 
+     * is left empty.  The other record may then only be assigned to or 
+     * deleted.
+     */
+    LogRecord(LogRecord&& that) 
+        : _send(that._send), _showAll(that._showAll), _vol(that._vol), 
+          _nsecs(that._nsecs), _monoNsecs(that._monoNsecs), 
+          _monoStamp(that._monoStamp), _lazyDate(that._lazyDate), 
+          _dates(std::move(that._dates)), 
+          _preamble(std::move(that._preamble)), 
+          _data(std::move(that._data)), _merged(std::move(that._merged))
+    { 
+        that._send = false;
+        that._lazyDate = false;
+    }
+
+    /**
+     * delete this log record.  Its property storage is kept by the calling
+     * thread for reuse by the next record it creates (see getPoolSize()).
      */
     virtual ~LogRecord();
 
@@ -153,7 +276,17 @@ public:
         _send = that._send; 
         _showAll = that._showAll; 
         _vol = that._vol; 
-        _data = that._data;
+        _nsecs = that._nsecs;
+        _monoNsecs = that._monoNsecs;
+        _monoStamp = that._monoStamp;
+        _lazyDate = that._lazyDate;
+        _dates = that._sharedDates();
+        _preamble = that._preamble;
+        _releaseData(_merged);
+        if (_data != that._data) {
+            _releaseData(_data);
+            _data = that._data;
+        }
         return *this;
     }
 
@@ -164,7 +297,33 @@ public:
      * the record is constructed (usually by a Log object).  
      */
     void addComment(const std::string& comment) {
-        if (_send) _data->add(LSST_LP_COMMENT, comment);
+        if (! _send) return;
+        _touch();
+        if (_preamble) _unshare(LSST_LP_COMMENT);
+        _data->add(LSST_LP_COMMENT, comment);
+    }
+
+    /**
+     * add a string comment to this record.  Unlike addComment(const 
+     * std::string&), no string is constructed when this record will not 
+     * be recorded.
+     */
+    void addComment(boost::string_view comment) {
+        if (! _send) return;
+        _touch();
+        if (_preamble) _unshare(LSST_LP_COMMENT);
+        _data->add(LSST_LP_COMMENT, comment.to_string());
+    }
+
+    /**
+     * add a string comment to this record.  This overload allows a string 
+     * literal to be passed without constructing a temporary std::string.
+     */
+    void addComment(const char *comment) {
+        if (! _send) return;
+        _touch();
+        if (_preamble) _unshare(LSST_LP_COMMENT);
+        _data->add(LSST_LP_COMMENT, std::string(comment));
     }
 
     /**
@@ -181,12 +340,31 @@ public:
     template <class T>
     void addProperty(const RecordProperty<T>& property);
 
+    /**
+     * attach a named item of data to this record.
+     */
+    template <class T>
+    void addProperty(const PropRef<T>& property) {
+        addProperty(property.name, property.value);
+    }
+
     /**
      * attach a named item of data to this record.
      */
     template <class T>
     void addProperty(const std::string& name, const T& val);
 
+    //@{
+    /**
+     * attach a named item of data to this record.  The name is only 
+     * converted to a std::string if this record will be recorded.
+     */
+    template <class T>
+    void addProperty(boost::string_view name, const T& val);
+    template <class T>
+    void addProperty(const char *name, const T& val);
+    //@}
+
     /**
      * add all of the properties found in the given PropertySet.  
      * This will make sure not to overwrite critical properties, 
@@ -217,23 +395,70 @@ public:
 
     /**
      * return the data properties that make up this log message.  
-     * This is a synonym for getProperties().
+     * This is a synonym for getProperties().  If this record shares a 
+     * preamble or has yet to create its TIMESTAMP and DATE, the first call
+     * builds a merged copy of all of them, leaving the record's own 
+     * properties as they are; formatters should prefer paramNames() and 
+     * propertiesFor(), which avoid the copy.  The reference remains valid
+     * until the record is modified.
      */
-    const lsst::daf::base::PropertySet& data() const { return *_data; }
+    const lsst::daf::base::PropertySet& data() const { 
+        if (! _preamble && ! _lazyDate) return *_data;
+        return _mergedView();
+    }
 
     /**
      * return the data properties that make up this log message.  
-     * This is a synonym for getProperties().
+     * This is a synonym for getProperties().  If this record shares a 
+     * preamble, a copy of it is merged into the record's own properties.
+     */
+    lsst::daf::base::PropertySet& data() { 
+        _touch();
+        if (_preamble) _mergePreamble();
+        if (_lazyDate) _mergeDate();
+        return *_data; 
+    }
+
+    /**
+     * return the names of all the data properties in this record, 
+     * including those provided by a shared preamble.  
+     */
+    std::vector<std::string> paramNames() const;
+
+    /**
+     * return the PropertySet that holds the values for the given property
+     * name:  the record's own properties if the name is set there, 
+     * otherwise the shared preamble if it has it.  If neither has the 
+     * name, the record's own properties are returned.  Unlike data(), 
+     * this never copies the preamble.  The TIMESTAMP and DATE properties
+     * are created the first time they are asked for.
+     */
+    const lsst::daf::base::PropertySet& propertiesFor(const std::string& name) const {
+        if (_lazyDate && (name == LSST_LP_DATE || name == LSST_LP_TIMESTAMP ||
+                          (name == LSST_LP_MONOTONIC && _monoStamp)))
+            return _dateProperties();
+        if (_preamble && ! _data->exists(name) && _preamble->exists(name)) 
+            return *_preamble;
+        return *_data;
+    }
+
+    /**
+     * return the shared preamble snapshot this record refers to, or a 
+     * null pointer if it has none or if it has been merged into the 
+     * record's own properties (by the non-const data()).  A property in the snapshot 
+     * only belongs to the record if propertiesFor() returns the snapshot
+     * for it.
      */
-    lsst::daf::base::PropertySet& data() { return *_data; }
+    const lsst::daf::base::PropertySet::ConstPtr& getSharedPreamble() const {
+        return _preamble;
+    }
 
     /**
      * return the number available property parameter names (i.e. ones 
      * that return non-PropertySet values). 
      */
     size_t countParamNames() {
-        std::vector<std::string> names = data().paramNames(false);
-        return names.size();
+        return paramNames().size();
     }
 
     /**
@@ -279,9 +504,10 @@ public:
      * set the TIMESTAMP property to the current time.  The value is stored as 
      * a lsst::daf::base::DateTime instance.  
      * 
-     * This is called automatically in the constructor, but it can be reset 
-     * at any time.  If there is also a DATE property, it will be updated 
-     * as well (see setDate()). 
+     * The time a record is created is captured automatically in the 
+     * constructor, but it can be reset at any time.  If the DATE property 
+     * has not yet been created, it will reflect the new time as well (see 
+     * setDate()). 
      */  
     void setTimestamp();
 
@@ -290,12 +516,12 @@ public:
      * The value is a string representation of the TIMESTAMP property, 
      * formatted for read-able display.
      *
-     * Unlike setTimestamp(), this function is not called automatically within 
-     * the LogRecord constructor; thus, a user of this class must call it 
-     * explicitly to have this property.  
-     *
-     * This function is intended for use by a Log class that sets the value
-     * just before sending this record to the LogDestinations.
+     * A record that will be recorded captures the time it was created as a
+     * plain count of nanoseconds; the TIMESTAMP and DATE properties are 
+     * only created from it when they are first asked for (e.g. by a 
+     * formatter that displays the date), so records rendered by formatters
+     * that ignore the time never pay for them.  This function creates them
+     * immediately; if they exist already, a DATE value is added.
      */
     virtual void setDate();
 
@@ -305,33 +531,221 @@ public:
      */
     static long long utcnow();
 
+    /**
+     * return the time of the system's monotonic clock (CLOCK_MONOTONIC) in
+     * nanosecs.  Unlike utcnow(), this clock is not stepped or slewed when
+     * the system time is adjusted (e.g. by NTP or for a leap second), so 
+     * the difference between two readings is a true duration.  The value 
+     * itself has no meaning outside the running system.
+     */
+    static long long monotonicnow();
+
+    /**
+     * return the monotonic clock time (see monotonicnow()) read together 
+     * with the record's TIMESTAMP, or zero if the record will not be 
+     * recorded.  The time between two records should be computed from 
+     * this value rather than from their timestamps.
+     */
+    long long getMonotonic() const { return _monoNsecs; }
+
+    /**
+     * have this record carry its monotonic clock time as the MONOTONIC 
+     * property (a long long count of nanoseconds), which appears just 
+     * after TIMESTAMP and DATE.
+     */
+    void stampMonotonic();
+
+    /**
+     * set whether every record created from now on carries the MONOTONIC
+     * property (see stampMonotonic()).  This is off by default.
+     */
+    static void setMonotonicStamps(bool yesno);
+
+    /**
+     * return true if every record created carries the MONOTONIC property
+     */
+    static bool willStampMonotonic();
+
+    /**
+     * return the number of emptied property sets the calling thread is 
+     * holding for reuse.  A record does not build its properties in a 
+     * freshly allocated PropertySet; it takes one released by a record 
+     * previously deleted in the same thread, so that a thread that sends
+     * records steadily recycles the same few.  At most MAX_POOLED are 
+     * held per thread.  Storage goes to the pool of the thread that 
+     * deletes the record, so the copies a destination's writer thread 
+     * (see LogDestination::startWriter()) makes of queued records are 
+     * recycled by the writer thread, not by the threads that logged them;
+     * as the writer creates few records of its own, these are mostly 
+     * freed once its pool is full.
+     */
+    static std::size_t getPoolSize();
+
+    /**
+     * the maximum number of emptied property sets a thread holds for reuse
+     */
+    static const std::size_t MAX_POOLED;
+
 protected: 
-    LogRecord() : _send(false), _vol(10), _data(new lsst::daf::base::PropertySet()) { }
+    LogRecord() : _send(false), _vol(10), _nsecs(0), _monoNsecs(0), 
+                  _monoStamp(false), _lazyDate(false), _dates(), 
+                  _preamble(), _data(_acquireData()) { }
+
+    /**
+     * return an empty PropertySet, reusing one released in the calling 
+     * thread if one is available.
+     */
+    static lsst::daf::base::PropertySet::Ptr _acquireData();
+
+    /**
+     * let go of a PropertySet obtained from _acquireData(), resetting the
+     * given pointer.  If nothing else refers to it, it is emptied and kept
+     * for reuse by the calling thread.
+     */
+    static void _releaseData(lsst::daf::base::PropertySet::Ptr& data);
+
+    /**
+     * fold a copy of the shared preamble into this record's own properties
+     * so that data() can return a single PropertySet.
+     */
+    void _mergePreamble();
+
+    /**
+     * read the system and monotonic clocks, one right after the other, 
+     * into _nsecs and _monoNsecs
+     */
+    void _readClocks();
 
     /**
-     * initialize this record with the DATE and LEVEL properties
+     * fold the TIMESTAMP and DATE (and MONOTONIC) properties into this 
+     * record's own properties, in the place they would have had had they 
+     * been set when the record was created (just after LEVEL).
+     */
+    void _mergeDate();
+
+    /**
+     * return a PropertySet holding the TIMESTAMP and DATE properties, 
+     * creating it from the captured time if necessary.  This is only 
+     * used until the properties are merged into the record's own.
+     */
+    const lsst::daf::base::PropertySet& _dateProperties() const;
+
+    /**
+     * return the PropertySet holding the TIMESTAMP and DATE properties if
+     * they have been created (see _dateProperties()), or null
+     */
+    lsst::daf::base::PropertySet::Ptr _sharedDates() const;
+
+    /**
+     * return a merged copy of the preamble, the record's own properties 
+     * and the TIMESTAMP and DATE, creating it on the first call.  This is
+     * how the const data() gets a single PropertySet without changing 
+     * the record's properties under other threads reading them.
+     */
+    const lsst::daf::base::PropertySet& _mergedView() const;
+
+    /**
+     * return a copy of a record's own properties with the TIMESTAMP and 
+     * DATE properties (and MONOTONIC) placed just after LEVEL
+     */
+    static lsst::daf::base::PropertySet::Ptr _withDates(
+        const lsst::daf::base::PropertySet::ConstPtr& own, 
+        const lsst::daf::base::PropertySet::ConstPtr& dates);
+
+    /**
+     * return a copy of a preamble with a record's own properties merged 
+     * in, each hiding any preamble property of the same name
+     */
+    static lsst::daf::base::PropertySet::Ptr _withPreamble(
+        const lsst::daf::base::PropertySet::ConstPtr& preamble,
+        const lsst::daf::base::PropertySet::ConstPtr& own);
+
+    /**
+     * take the copy made by _mergedView() as the record's own properties
+     */
+    void _adoptMerged();
+
+    /**
+     * prepare to modify the record's own properties, taking the copy made
+     * by _mergedView() if there is one so that it does not go stale.
+     */
+    void _touch() { if (_merged) _adoptMerged(); }
+
+    /**
+     * prepare to add a value under a given name:  if only the shared 
+     * preamble has the name, copy its values into the record's own 
+     * properties, so that the value is added after them (and checked 
+     * against their type) as it would be had the preamble been copied.
+     */
+    void _unshare(const std::string& name) {
+        if (_preamble && ! _data->exists(name) && _preamble->exists(name))
+            _data->copy(name, _preamble, name);
+    }
+
+    /**
+     * initialize this record with the LEVEL property and capture the 
+     * current time, from which the TIMESTAMP and DATE properties are 
+     * created when needed.
      */
     void _init() {
         if (_send) {
             _data->set("LEVEL", _vol);
-            setDate();
+            _readClocks();
+            _monoStamp = willStampMonotonic();
+            _lazyDate = true;
         }
     }
 
     bool _send;    // true if this record should be sent to the log
     bool _showAll; // true if there is preference to have all data displayed
     int _vol;      // the importance volume of this message
+
+    // the time the record was created, in nanoseconds since the epoch 
+    // (UTC), and whether the TIMESTAMP and DATE properties made from it 
+    // have yet to be merged into _data.  Until they are, they live in 
+    // _dates once they are asked for.  _monoNsecs is the monotonic clock
+    // time read with it, carried as MONOTONIC if _monoStamp is true.
+    long long _nsecs;
+    long long _monoNsecs;
+    bool _monoStamp;
+    bool _lazyDate;
+    mutable lsst::daf::base::PropertySet::Ptr _dates;
+
+    // the shared, immutable preamble; null once merged into _data
+    lsst::daf::base::PropertySet::ConstPtr _preamble;
     lsst::daf::base::PropertySet::Ptr _data;
+
+    // the merged copy returned by the const data(), if it was called
+    // while there was something to merge
+    mutable lsst::daf::base::PropertySet::Ptr _merged;
 };
 
 template <class T>
 void LogRecord::addProperty(const RecordProperty<T>& property) {
-    if (_send) property.addTo(_data);
+    if (! _send) return;
+    _touch();
+    _unshare(property.name);
+    _data->add(property.name, property.value);
 }
 
 template <class T>
 void LogRecord::addProperty(const std::string& name, const T& val) {
-    if (_send) data().add(name, val);
+    if (! _send) return;
+    _touch();
+    _unshare(name);
+    _data->add(name, val);
+}
+
+template <class T>
+void LogRecord::addProperty(boost::string_view name, const T& val) {
+    if (! _send) return;
+    addProperty(name.to_string(), val);
+}
+
+template <class T>
+void LogRecord::addProperty(const char *name, const T& val) {
+    if (! _send) return;
+    addProperty(std::string(name), val);
 }
 
 
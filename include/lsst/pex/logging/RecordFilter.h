@@ -0,0 +1,127 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file RecordFilter.h
+ * @brief definition of the RecordFilter class
+ */
+#ifndef LSST_PEX_LOGGING_RECORDFILTER_H
+#define LSST_PEX_LOGGING_RECORDFILTER_H
+
+#include <string>
+#include <vector>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+class LogRecord;
+
+/**
+ * @brief a test of a log record's contents, given as an expression
+ *
+ * A RecordFilter lets a LogDestination (see LogDestination::setFilter()) 
+ * pass only the records whose contents satisfy an expression such as
+ * @code
+ *   LEVEL >= WARN or (LOG startswith 'pipe.io' and PROPERTY visit == 1234)
+ * @endcode
+ * The expression is parsed once, when the filter is created, into a 
+ * compact list of instructions that is then evaluated against each record.
+ *
+ * An expression is made of comparisons combined with "and" ("&&"), 
+ * "or" ("||"), "not" ("!") and parentheses.  A comparison has the form
+ * <em>field op value</em>, where field is one of
+ * <dl>
+ *   <dt> LEVEL     <dd> the record's importance, compared with a number
+ *                       or one of the level names DEBUG, INFO, WARN 
+ *                       (or WARNING) and FATAL;
+ *   <dt> LOG       <dd> the name of the Log the record was sent to;
+ *   <dt> COMMENT   <dd> the record's comments (the comparison is true if 
+ *                       it is true for any one of them);
+ *   <dt> PROPERTY <em>name</em>  
+ *                  <dd> the named property of the record (or of its 
+ *                       preamble).  "PROPERTY" may be left off unless the
+ *                       name is one of the other field names.
+ * </dl>
+ * op is one of ==, !=, <, <=, >, >=, startswith, endswith and contains 
+ * (the last three apply to strings only); and value is a number or a 
+ * quoted string.  A property can also be tested with 
+ * "PROPERTY <em>name</em> exists".  Numeric properties are compared with 
+ * numbers and string properties with strings; a comparison with a missing
+ * property or one of the other type is false.
+ *
+ * A RecordFilter is immutable and may be shared by several destinations
+ * and threads.
+ */
+class RecordFilter {
+public:
+
+    /**
+     * create a filter from an expression.
+     * @param expr    the expression to evaluate against each record
+     * @throws lsst::pex::exceptions::InvalidParameterError  if the 
+     *               expression cannot be parsed.
+     */
+    explicit RecordFilter(const std::string& expr);
+
+    /**
+     * return true if a record satisfies this filter's expression
+     */
+    bool matches(const LogRecord& rec) const;
+
+    /**
+     * return the expression this filter was created from
+     */
+    const std::string& getExpression() const { return _expr; }
+
+private:
+    class Parser;
+
+    // one step of the compiled expression.  Comparisons set the result of
+    // the expression so far; AND and OR skip to target when the result 
+    // already decides them.
+    struct Instr {
+        enum Code { LEVEL, LOG, COMMENT, NUMBER, STRING, EXISTS, 
+                    AND, OR, NOT };
+        enum Op { EQ, NE, LT, LE, GT, GE, STARTS, ENDS, CONTAINS };
+
+        Code code;
+        Op op;
+        int name;        // index into _names, for property instructions
+        int target;      // the instruction to skip to, for AND and OR
+        double number;   // the value to compare with numbers
+        std::string str; // the value to compare with strings
+    };
+
+    bool _compare(const Instr& in, double val) const;
+    bool _compare(const Instr& in, const std::string& val) const;
+
+    std::string _expr;
+    std::vector<Instr> _code;
+    std::vector<std::string> _names;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_RECORDFILTER_H
@@ -0,0 +1,123 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file ScopedThreshold.h
+ * @brief definition of the ScopedThreshold class
+ */
+#ifndef LSST_PEX_LOGGING_SCOPEDTHRESHOLD_H
+#define LSST_PEX_LOGGING_SCOPEDTHRESHOLD_H
+
+#include <string>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * @brief a thread-local override of the importance threshold of a Log 
+ * (and its descendants) that lasts for the lifetime of the object.
+ *
+ * Setting a threshold with Log::setThreshold() or Log::setThresholdFor() 
+ * changes the threshold memory shared by all threads.  A ScopedThreshold 
+ * instead changes the threshold seen only by the thread that created it, 
+ * and only until it is destroyed:
+ * @code
+ *   {
+ *       ScopedThreshold verbose("pipe.astrom", Log::DEBUG);
+ *       runTask();        // this thread logs pipe.astrom DEBUG messages
+ *   }                     // the shared thresholds apply again
+ * @endcode
+ * 
+ * The override applies to the Log with the given name and to all of its 
+ * descendants; an empty name applies it to all Logs.  It takes precedence 
+ * over any threshold set in the shared memory, whether higher or lower.  
+ * When scopes are nested, the innermost scope that matches a Log's name 
+ * wins.  Note that the thresholds attached to the Log's destinations still
+ * apply.
+ *
+ * Overrides are kept in a per-thread stack.  Threads with no 
+ * ScopedThreshold in effect pay only for checking that the stack is 
+ * empty.  A ScopedThreshold must be destroyed by the thread that 
+ * created it, in the reverse order of construction (which is guaranteed 
+ * when it is used as a local variable).
+ */
+class ScopedThreshold {
+public:
+
+    /**
+     * override the threshold for a Log and its descendants in the 
+     * current thread
+     * @param name       the full name of the Log; an empty string 
+     *                      refers to the root Log.
+     * @param threshold  the threshold to use for this thread
+     */
+    ScopedThreshold(const std::string& name, int threshold);
+
+    /**
+     * restore the thresholds that were in effect when this object was 
+     * created.
+     */
+    ~ScopedThreshold();
+
+    /**
+     * return the name of the Log whose threshold is overridden
+     */
+    const std::string& getName() const { return _name; }
+
+    /**
+     * return the threshold set by this scope
+     */
+    int getThreshold() const { return _threshold; }
+
+    /**
+     * return true if any ScopedThreshold is in effect in the current 
+     * thread.
+     */
+    static bool isActive() { return _top != 0; }
+
+    /**
+     * look up the overriding threshold for a Log in the current thread.
+     * @param name       the full name of the Log
+     * @param threshold  set to the overriding threshold if one applies
+     * @return bool  true if an override applies to the Log
+     */
+    static bool findThresholdFor(const std::string& name, int& threshold);
+
+private:
+    ScopedThreshold(const ScopedThreshold&);
+    ScopedThreshold& operator=(const ScopedThreshold&);
+
+    bool _matches(const std::string& name) const;
+
+    std::string _name;
+    int _threshold;
+    const ScopedThreshold *_prev;
+
+    static thread_local const ScopedThreshold *_top;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_SCOPEDTHRESHOLD_H
@@ -97,6 +97,36 @@ public:
      */
     void setScreenThreshold(int thresh) { _screen->setThreshold(thresh); }
 
+    /**
+     * return the destination for the screen.  This can be used, for 
+     * example, to give the screen its own writer thread (see 
+     * LogDestination::startWriter()), so that a blocked terminal does not
+     * hold up other destinations.
+     */
+    LogDestination& getScreenDestination() { return *_screen; }
+
+    /**
+     * set whether the screen is written by a thread of its own, so that 
+     * a terminal or pipe that is slow to accept output (e.g. a batch 
+     * system's log capture, or a terminal over ssh) does not hold up the
+     * threads that log.  Up to capacity records may wait to be written;
+     * beyond that, records are shed under the LogDestination::SHED 
+     * policy, those below Log::WARN (or the screen destination's shed 
+     * threshold, if it has been changed) first, and the records shed are
+     * reported by level in summary records.  This may be called while 
+     * other threads are logging.
+     * @param nonBlocking   true to write the screen from its own thread; 
+     *                        false to write it directly again, after 
+     *                        writing out the queued records
+     * @param capacity      the maximum number of records that may wait
+     */
+    void setScreenNonBlocking(bool nonBlocking, std::size_t capacity=4096);
+
+    /**
+     * return true if the screen is written by a thread of its own
+     */
+    bool isScreenNonBlocking() { return _screen->hasWriter(); }
+
     /**
      * set whether all data properties will be printed to the screen or
      * just the Log name ("LOG") and the text comment ("COMMENT").
@@ -0,0 +1,72 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+/**
+ * @file TextScan.h
+ * @brief functions that find and treat the line breaks and control 
+ * characters in the text of log records
+ */
+#ifndef LSST_PEX_LOGGING_TEXTSCAN_H
+#define LSST_PEX_LOGGING_TEXTSCAN_H
+
+#include <ostream>
+#include <boost/utility/string_view.hpp>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+/**
+ * return a pointer to the first character in [begin, end) that would 
+ * disturb the line-by-line layout of a rendered record:  a control 
+ * character (a byte below 0x20 other than a tab, or DEL) or, if delim is 
+ * not NUL, the delimiter.  If there is none, end is returned.  
+ *
+ * The text is examined 16 bytes at a time where SSE2 is available (and 
+ * 8 at a time otherwise), so that long comments with no such characters,
+ * the usual case, are passed over at close to memory speed.
+ */
+const char *findSpecial(const char *begin, const char *end, char delim='\0');
+
+/**
+ * write text to a stream, starting each line after the first with the 
+ * given indentation so that a multi-line comment or value (e.g. a stack 
+ * trace or a table) stays within its record's block of lines.  A carriage
+ * return before a newline is dropped; other control characters are 
+ * written as "\\xHH" escapes.  The text does not end with a newline.
+ */
+void writeIndented(std::ostream *strm, boost::string_view text, 
+                   boost::string_view indent);
+
+/**
+ * write text to a stream as a single line:  newlines, carriage returns
+ * and backslashes are written as "\\n", "\\r" and "\\\\", and other 
+ * control characters (but tabs) as "\\xHH" escapes.
+ */
+void writeEscaped(std::ostream *strm, boost::string_view text);
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_TEXTSCAN_H
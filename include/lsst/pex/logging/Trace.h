@@ -148,6 +148,26 @@ public:
         }
     }
 
+    /**
+     * Print a message formatted from a "{}"-style format string, given 
+     * with LSST_FMT(), if verbosity is high enough for name.  The format 
+     * is checked against the arguments at compile time and is not 
+     * evaluated if the trace is not active.
+     */
+    template <typename S, typename... Args, 
+              typename = typename std::enable_if<IsFormatString<S>::value>::type>
+    Trace(const std::string& name,      //!< Name of component
+          const int verbosity,          //!< Desired verbosity
+          S fmt,                        //!< Message to write as a format
+          const Args&... args           //!< the values to fill fmt with
+          )
+    {
+        if (-1*verbosity >= Log::getDefaultLog().getThresholdFor(name)) {
+            Debug out(name);
+            out.debug(verbosity, fmt, args...);
+        }
+    }
+
 #else
 /*
     Trace(const std::string& name, const int verbosity) {}
@@ -156,6 +176,13 @@ public:
           const std::string& msg, ...) {}
     Trace(const std::string& name, const int verbosity,
           const boost::format& msg) {}
+    template <typename S, typename... Args, 
+              typename = typename std::enable_if<IsFormatString<S>::value>::type>
+    Trace(const std::string& name, const int verbosity, S fmt,
+          const Args&... args) 
+    {
+        checkFormat<S, Args...>();
+    }
 
 #endif
 
@@ -224,6 +251,17 @@ void TTrace(const std::string name,      //!< Name of component
     }
 }
 
+template<int VERBOSITY, typename S, typename... Args>
+typename std::enable_if<IsFormatString<S>::value>::type
+TTrace(const std::string& name,      //!< Name of component
+       S fmt,                        //!< Message to write, from LSST_FMT()
+       const Args&... args           //!< the values to fill fmt with
+      ) {
+    if (LSST_MAX_TRACE < 0 || VERBOSITY <= LSST_MAX_TRACE) {
+        Trace(name, VERBOSITY, fmt, args...);
+    }
+}
+
 
 } // namespace logging
 } // namespace pex
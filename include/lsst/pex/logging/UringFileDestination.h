@@ -0,0 +1,166 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file UringFileDestination.h
+ * @brief definition of the UringFileDestination class
+ */
+#ifndef LSST_PEX_LOGGING_URINGFILEDESTINATION_H
+#define LSST_PEX_LOGGING_URINGFILEDESTINATION_H
+
+#include "lsst/pex/logging/LogDestination.h"
+
+#include <boost/filesystem/path.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+class UringFileBuf;
+
+/**
+ * @brief a LogDestination represented by a file that is written via 
+ * io_uring.
+ *
+ * Records are rendered into a small set of fixed buffers that are 
+ * registered with the kernel.  A filled buffer is submitted as a single
+ * write at an explicit file offset, and its completion is reaped later 
+ * (the next time a record is written), so the logging thread does not 
+ * wait for the write to finish.  At the end of each record, the current
+ * buffer is submitted if no write is in flight; otherwise, records 
+ * accumulate and go out as one larger write once the previous one 
+ * completes.  Thus, when the disk keeps up, each record is written 
+ * promptly, and when it falls behind, writes are batched.  The logging 
+ * thread only waits when it has filled a buffer and none is free.
+ *
+ * If io_uring is not available (e.g. on older kernels or where it is 
+ * disabled), the file is written synchronously with pwritev() at the end
+ * of each record instead.  usesUring() tells which is in use.
+ *
+ * Because writes go to explicit offsets (starting at the file's size 
+ * when it is opened) rather than through O_APPEND, the file must have a 
+ * single writer:  while this destination has it open, nothing else, 
+ * including another UringFileDestination or a FileDestination, may write
+ * to it, or their records will overwrite each other.  Use 
+ * FileDestination for a file that is shared.
+ *
+ * Unlike FileDestination, records may still be in flight after write() 
+ * returns; call flush() to wait for them.  Destroying the destination 
+ * also waits for them.  Like any LogDestination, this is not safe to 
+ * write to from several threads at once; use a writer thread (see 
+ * LogDestination::startWriter()) to serialize access.
+ */
+class UringFileDestination : public LogDestination {
+public:
+
+    //@{
+    /**
+     * create a file destination.  If the file does not exist, it will 
+     * be created; otherwise, messages will be appended.
+     * @param filepath    the path to the log file to write messages to.
+     * @param formatter   the LogFormatter to use to format the messages 
+     * @param threshold   the minimum volume level required to pass a message
+     *                       to the stream.  
+     * @param truncate    if True, overwrite the previous contents; otherwise,
+     *                       new messages will be appended to the file.
+     * @param bufferSize  the size in bytes of each of the registered 
+     *                       buffers
+     * @param nbuffers    the number of registered buffers
+     */
+    UringFileDestination(const std::string& filepath,
+                         const std::shared_ptr<LogFormatter>& formatter, 
+                         int threshold=threshold::PASS_ALL,
+                         bool truncate=false, 
+                         std::size_t bufferSize=65536, int nbuffers=4);
+    UringFileDestination(const boost::filesystem::path& filepath,
+                         const std::shared_ptr<LogFormatter>& formatter, 
+                         int threshold=threshold::PASS_ALL,
+                         bool truncate=false, 
+                         std::size_t bufferSize=65536, int nbuffers=4);
+    //@}
+
+    //@{
+    /**
+     * create a file destination that formats messages with the 
+     * PrependedFormatter.  If the file does not exist, it will be 
+     * created; otherwise, messages will be appended.  
+     * @param filepath    the path to the log file to write messages to.
+     * @param verbose     if True, make sure all properties are printed 
+     *                       out to the destination
+     * @param threshold   the minimum volume level required to pass a message
+     *                       to the stream.  
+     * @param truncate    if True, overwrite the previous contents; otherwise,
+     *                       new messages will be appended to the file.
+     */
+    UringFileDestination(const std::string& filepath, bool verbose=false, 
+                         int threshold=threshold::PASS_ALL, 
+                         bool truncate=false);
+    UringFileDestination(const boost::filesystem::path& filepath, 
+                         bool verbose=false, 
+                         int threshold=threshold::PASS_ALL, 
+                         bool truncate=false);
+    //@}
+
+    /**
+     * write out any buffered records, wait for them to complete, and 
+     * close the file.
+     */
+    virtual ~UringFileDestination();
+
+    /**
+     * return the path to the log file
+     */
+    const boost::filesystem::path& getPath() const { return _path; }
+
+    /**
+     * return true if the file is being written via io_uring, or false if 
+     * the pwritev() fallback is in use.
+     */
+    bool usesUring() const;
+
+    /**
+     * submit any buffered records and wait until all writes are complete.
+     * If a writer thread is running, its queue is flushed first.
+     * @throws lsst::pex::exceptions::RuntimeError  if a write to the file 
+     *              has failed.  The records it held are lost, and the 
+     *              destination's stream is marked bad, so later records 
+     *              are dropped.
+     */
+    void flush();
+
+protected:
+    boost::filesystem::path _path;
+
+private:
+    void _open(bool truncate, std::size_t bufferSize, int nbuffers);
+
+    std::unique_ptr<UringFileBuf> _buf;
+};
+
+}}}     // end lsst::pex::logging
+
+#endif  // end LSST_PEX_LOGGING_URINGFILEDESTINATION_H
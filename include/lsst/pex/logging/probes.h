@@ -0,0 +1,115 @@
+// -*- lsst-c++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file probes.h
+ * @brief static tracepoints (USDT probes) in the logging code
+ *
+ * Where the platform provides <sys/sdt.h> (from SystemTap), the macros 
+ * defined here place USDT probes under the provider "lsst_pex_logging".
+ * A probe is a single NOP in the code plus a note in the ELF file that 
+ * describes where its arguments can be found, so it costs next to nothing
+ * until a tracer such as bpftrace or perf attaches to it, without 
+ * recompiling.  sdt.h is header-only; no library is needed at run time.
+ * Elsewhere, or if LSST_LOGGING_NO_PROBES is defined, the macros expand 
+ * to nothing.
+ *
+ * The probes are all placed in out-of-line code in the library, so they 
+ * are found in libpex_logging.so and whether they exist depends only on 
+ * how the library was built, not on the programs that use it.  This 
+ * header is therefore only included by the library's own source files.
+ *
+ * Each probe has a USDT semaphore, lsst_pex_logging_<name>_semaphore,
+ * which the tracer raises while it is attached.  The semaphores are 
+ * defined (with LSST_LOGGING_SEMAPHORE) in Log.cc, even where there are 
+ * no probes, so that inline code can test one before calling into the
+ * library to fire its probe:  Log's threshold checks do so for reject, 
+ * so that a rejected message costs only an untaken branch when no 
+ * tracer is attached.
+ *
+ * The probes are:
+ * <dl>
+ *   <dt> send(const char *log, int importance)
+ *   <dd> a Log is sending a record to its destinations
+ *   <dt> reject(const char *log, int importance)
+ *   <dd> a Log rejected a message because of its threshold
+ *   <dt> write__start(unsigned int destination, int importance)
+ *   <dt> write__done(unsigned int destination, int importance)
+ *   <dd> a LogDestination started or finished writing (or queueing) a 
+ *        record.  The destination is identified by its metrics id (see 
+ *        DestinationMetrics).
+ *   <dt> block__start(const char *log, const char *function)
+ *   <dt> block__done(const char *log, const char *function)
+ *   <dd> a BlockTimingLog marked the start or end of a block of code
+ * </dl>
+ *
+ * Measuring a duration in the process would cost a clock read even when
+ * no tracer is attached, so durations are left to the tracer, which can 
+ * pair the start and done probes.  For example, 
+ * @code
+ *   bpftrace -e '
+ *     usdt:./libpex_logging.so:lsst_pex_logging:write__start 
+ *         { @t[tid] = nsecs; }
+ *     usdt:./libpex_logging.so:lsst_pex_logging:write__done /@t[tid]/ 
+ *         { @ns[arg0] = hist(nsecs - @t[tid]); delete(@t[tid]); }'
+ * @endcode
+ * gives a latency histogram for each destination.
+ */
+#ifndef LSST_PEX_LOGGING_PROBES_H
+#define LSST_PEX_LOGGING_PROBES_H
+
+#if ! defined(LSST_LOGGING_NO_PROBES) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    define LSST_LOGGING_HAVE_PROBES 1
+#  endif
+#endif
+
+#ifdef LSST_LOGGING_HAVE_PROBES
+
+// every probe has a semaphore (see LSST_LOGGING_SEMAPHORE below)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define LSST_LOGGING_PROBE2(name, a1, a2)                           \
+    DTRACE_PROBE2(lsst_pex_logging, name, a1, a2)
+
+#define LSST_LOGGING_SEMAPHORE(name)                                \
+    extern "C" {                                                    \
+        __attribute__((section(".probes")))                         \
+        unsigned short lsst_pex_logging_##name##_semaphore = 0;     \
+    }
+
+#else
+
+#define LSST_LOGGING_PROBE2(name, a1, a2)                           \
+    do { (void) sizeof(a1); (void) sizeof(a2); } while (0)
+
+#define LSST_LOGGING_SEMAPHORE(name)                                \
+    extern "C" {                                                    \
+        unsigned short lsst_pex_logging_##name##_semaphore = 0;     \
+    }
+
+#endif
+
+#endif  // end LSST_PEX_LOGGING_PROBES_H
@@ -34,6 +34,7 @@
 #include <map>
 #include <ostream>
 #include <memory>
+#include <atomic>
 #include <boost/tokenizer.hpp>
 
 #include "lsst/pex/logging/threshold/enum.h"
@@ -93,10 +94,12 @@ public:
 
     /**
      * set the threshold associated with a descendent with a given name
+     * @return int   the threshold previously set for the descendent 
+     *                 (INHERIT if it was not set)
      */
-    void setThresholdFor(tokenizer::iterator toptoken, 
-                         const tokenizer::iterator& end,
-                         int threshold);
+    int setThresholdFor(tokenizer::iterator toptoken, 
+                        const tokenizer::iterator& end,
+                        int threshold);
 
     /**
      * reset the threshold associated with a descendent with a given name
@@ -113,6 +116,21 @@ public:
     void printDescThresholds(std::ostream& out, 
                              const std::string& prefix) const;
 
+    /**
+     * return the lowest threshold set anywhere in this hierarchy.  The 
+     * threshold at the top of the hierarchy is always included (even if 
+     * it is INHERIT); descendants set to INHERIT are skipped.
+     */
+    int getLowestThreshold() const {
+        return getLowestDescThreshold(_thresh);
+    }
+
+    /**
+     * return the lower of a given threshold and the lowest threshold set 
+     * for any descendant.
+     */
+    int getLowestDescThreshold(int lowest) const;
+
     /**
      * delete the descendents 
      */
@@ -173,6 +191,28 @@ public:
 
     Memory(const std::string& delims=".");
 
+    /**
+     * return the lowest threshold set for any name in the hierarchy.  No 
+     * Log sharing this Memory that inherits its threshold from it can pass
+     * a message whose importance is less than this value, so such a 
+     * message can be rejected without resolving the name of the Log 
+     * sending it.  (A Log holding a threshold of its own may pass messages
+     * below it; see Log::sends().)  This may be called without locking 
+     * while another thread updates the thresholds.
+     */
+    int getLowestThreshold() const { 
+        return _lowest.load(std::memory_order_relaxed); 
+    }
+
+    /**
+     * return false if no Log that inherits its threshold from this Memory
+     * could pass a message of the given importance.  This costs a single 
+     * (relaxed) atomic load.
+     */
+    bool mayPass(int importance) const {
+        return (importance >= getLowestThreshold());
+    }
+
     /**
      * return the threshold value associated with a given name
      */
@@ -191,7 +231,9 @@ public:
         }
         else {
             tokenizer fields(name, _sep);
-            _tree.setThresholdFor(fields.begin(), fields.end(), threshold);
+            _updateLowest(
+                _tree.setThresholdFor(fields.begin(), fields.end(), threshold),
+                threshold);
         }
     }
 
@@ -205,12 +247,18 @@ public:
      * return the default threshold value associated with the root
      * of the hierarchy.
      */
-    void setRootThreshold(int threshold) { _tree.setThreshold(threshold); }
+    void setRootThreshold(int threshold) { 
+        _tree.setThreshold(threshold); 
+        _lowest.store(_tree.getLowestThreshold(), std::memory_order_relaxed);
+    }
 
     /**
      * reset the memory
      */
-    void forgetAllNames() { _tree.deleteDescendants(); }
+    void forgetAllNames() { 
+        _tree.deleteDescendants(); 
+        _lowest.store(_tree.getThreshold(), std::memory_order_relaxed);
+    }
 
     /**
      * print the thresholds stored in this Memory that are not set to INHERIT.
@@ -219,8 +267,11 @@ public:
 
 
 private:
+    void _updateLowest(int oldThreshold, int newThreshold);
+
     Family _tree;
     boost::char_separator<char> _sep;
+    std::atomic<int> _lowest;
 };
 
 }}}} // end lsst::pex::logging::threshold
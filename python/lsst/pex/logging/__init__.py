@@ -31,4 +31,6 @@ from .log import *
 from .debug import *
 from .blockTimingLog import *
 from .screenLog import *
+from .logMetrics import *
+from .logReader import *
 
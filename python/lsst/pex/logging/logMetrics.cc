@@ -0,0 +1,89 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include "lsst/pex/logging/LogMetrics.h"
+
+#include <sstream>
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+PYBIND11_MODULE(logMetrics, mod) {
+    py::class_<DestinationMetrics> clsDest(mod, "DestinationMetrics");
+
+    clsDest.def_readonly("id", &DestinationMetrics::id);
+    clsDest.def_readonly("label", &DestinationMetrics::label);
+    clsDest.def_readonly("records", &DestinationMetrics::records);
+    clsDest.def_readonly("bytes", &DestinationMetrics::bytes);
+    clsDest.def_readonly("formatNanos", &DestinationMetrics::formatNanos);
+    clsDest.def_readonly("writeNanos", &DestinationMetrics::writeNanos);
+    clsDest.def_readonly("queued", &DestinationMetrics::queued);
+    clsDest.def_readonly("maxQueued", &DestinationMetrics::maxQueued);
+    clsDest.def_readonly("dropped", &DestinationMetrics::dropped);
+
+    py::class_<LatencyHistogram> clsHist(mod, "LatencyHistogram");
+
+    clsHist.def(py::init<int>(), "shards"_a = 1);
+    clsHist.def("record", &LatencyHistogram::record);
+    clsHist.def("merge", &LatencyHistogram::merge);
+    clsHist.def("getCount", &LatencyHistogram::getCount);
+    clsHist.def("getMax", &LatencyHistogram::getMax);
+    clsHist.def("getPercentile", &LatencyHistogram::getPercentile);
+    clsHist.def("__str__", [](const LatencyHistogram &h) {
+        std::ostringstream os;
+        h.write(os);
+        return os.str();
+    });
+
+    py::class_<LogMetrics> cls(mod, "LogMetrics");
+
+    py::enum_<LogMetrics::Counter>(cls, "Counter")
+            .value("SENT", LogMetrics::SENT)
+            .value("SKIPPED", LogMetrics::SKIPPED)
+            .value("LOCAL", LogMetrics::LOCAL)
+            .value("LOOKUPS", LogMetrics::LOOKUPS)
+            .export_values();
+
+    cls.def_static("get", &LogMetrics::get);
+    cls.def_static("getThresholdHitRate", &LogMetrics::getThresholdHitRate);
+    cls.def_static("getDestinationMetrics", &LogMetrics::getDestinationMetrics);
+    cls.def_static("setTiming", &LogMetrics::setTiming);
+    cls.def_static("isTiming", &LogMetrics::isTiming);
+    cls.def_static("setLatencyRecording", &LogMetrics::setLatencyRecording);
+    cls.def_static("isRecordingLatency", &LogMetrics::isRecordingLatency);
+    cls.def_static("getSendLatency", &LogMetrics::getSendLatency);
+    cls.def_static("getWriteLatency", &LogMetrics::getWriteLatency);
+    cls.def_static("startReporting", &LogMetrics::startReporting, "seconds"_a = 60);
+    cls.def_static("stopReporting", &LogMetrics::stopReporting);
+    cls.def_static("report", &LogMetrics::report);
+}
+
+}  // namespace logging
+}  // namespace pex
+}  // namespace lsst
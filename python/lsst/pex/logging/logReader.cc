@@ -0,0 +1,173 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016  AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#include "pybind11/pybind11.h"
+#include "pybind11/numpy.h"
+
+#include "lsst/pex/logging/LogReader.h"
+#include "lsst/pex/exceptions.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+namespace {
+
+/*
+ * return the value of a field as a Python object of its type
+ */
+py::object fieldValue(LogReader::Field const& field) {
+    char type = field.getType();
+    try {
+        if (type == 'i' || type == 'l' || type == 'L') return py::int_(field.asInteger());
+        if (type == 'f' || type == 'd') return py::float_(field.asFloat());
+        if (type == 'b') return py::bool_(field.asBool());
+    } catch (pex::exceptions::TypeError const&) {
+        // fall back on the text
+    }
+    return py::str(field.asString());
+}
+
+/*
+ * return a record as a dict.  A property with several values (e.g. COMMENT) maps to a list.
+ */
+py::dict recordDict(LogReader::Record const& rec) {
+    py::dict out;
+    for (auto const& field : rec) {
+        py::str name(field.getName().data(), field.getName().size());
+        py::object value = fieldValue(field);
+        if (!out.contains(name)) {
+            out[name] = value;
+            continue;
+        }
+        py::object previous = out[name];
+        if (py::isinstance<py::list>(previous)) {
+            previous.cast<py::list>().append(value);
+        } else {
+            py::list values;
+            values.append(previous);
+            values.append(value);
+            out[name] = values;
+        }
+    }
+    return out;
+}
+
+/*
+ * return a column as a NumPy array:  int64, float64, bool, or object (str) for strings.  If some
+ * records lack the property, a masked array is returned with those records masked.
+ */
+py::object columnArray(LogReader::Column const& col) {
+    py::module numpy = py::module::import("numpy");
+    std::size_t n = col.size();
+    py::object values;
+    switch (col.getType()) {
+        case LogReader::Column::INTEGER:
+            values = py::array_t<std::int64_t>(n, col.getIntegers().data());
+            break;
+        case LogReader::Column::FLOAT:
+            values = py::array_t<double>(n, col.getFloats().data());
+            break;
+        case LogReader::Column::BOOL: {
+            py::array_t<bool> flags(n);
+            std::copy(col.getIntegers().begin(), col.getIntegers().end(), flags.mutable_data());
+            values = flags;
+            break;
+        }
+        default: {
+            py::list strings(n);
+            for (std::size_t i = 0; i < n; ++i) strings[i] = py::str(col.getStrings()[i]);
+            values = numpy.attr("array")(strings, "dtype"_a = "object");
+        }
+    }
+
+    std::vector<std::uint8_t> const& present = col.getPresent();
+    if (std::find(present.begin(), present.end(), 0) == present.end()) return values;
+    py::array_t<bool> mask(n);
+    std::transform(present.begin(), present.end(), mask.mutable_data(),
+                   [](std::uint8_t p) { return p == 0; });
+    return numpy.attr("ma").attr("masked_array")(values, "mask"_a = mask);
+}
+
+/*
+ * a Python iterator over the records of a LogReader
+ */
+struct RecordIterator {
+    RecordIterator(LogReader const& reader) : it(reader.begin()), end(reader.end()) {}
+
+    py::dict next() {
+        if (it == end) throw py::stop_iteration();
+        py::dict out = recordDict(*it);
+        ++it;
+        return out;
+    }
+
+    LogReader::iterator it, end;
+};
+
+}  // namespace
+
+PYBIND11_MODULE(logReader, mod) {
+    py::module::import("lsst.pex.exceptions");
+
+    py::class_<LogReader> cls(mod, "LogReader");
+
+    py::enum_<LogReader::Format>(cls, "Format")
+            .value("NETLOGGER", LogReader::NETLOGGER)
+            .value("PREPENDED", LogReader::PREPENDED)
+            .export_values();
+
+    py::class_<RecordIterator>(cls, "RecordIterator")
+            .def("__iter__", [](RecordIterator& self) -> RecordIterator& { return self; })
+            .def("__next__", &RecordIterator::next);
+
+    cls.def(py::init<std::string const&, LogReader::Format, std::string const&>(), "path"_a,
+            "format"_a = LogReader::NETLOGGER, "valueDelim"_a = ": ");
+    cls.def("getFormat", &LogReader::getFormat);
+    cls.def("size", &LogReader::size);
+    cls.def("__iter__", [](LogReader const& self) { return RecordIterator(self); }, py::keep_alive<0, 1>());
+    cls.def("readColumns",
+            [](LogReader const& self, int nthreads) {
+                LogReader::Columns columns;
+                {
+                    py::gil_scoped_release release;
+                    columns = self.readColumns(nthreads);
+                }
+                py::dict out;
+                for (auto const& col : columns) out[py::str(col.first)] = columnArray(col.second);
+                return out;
+            },
+            "nthreads"_a = 0);
+}
+
+}  // namespace logging
+}  // namespace pex
+}  // namespace lsst
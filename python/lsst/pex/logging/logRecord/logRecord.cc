@@ -56,6 +56,11 @@ PYBIND11_MODULE(logRecord, mod) {
             (void (LogRecord::*)(const std::string&, const std::string&)) & LogRecord::addProperty);
     cls.def("addProperties",
             (void (LogRecord::*)(const lsst::daf::base::PropertySet::Ptr&)) & LogRecord::addProperties);
+    cls.def("getMonotonic", &LogRecord::getMonotonic);
+    cls.def("stampMonotonic", &LogRecord::stampMonotonic);
+    cls.def_static("monotonicnow", &LogRecord::monotonicnow);
+    cls.def_static("setMonotonicStamps", &LogRecord::setMonotonicStamps, "yesno"_a);
+    cls.def_static("willStampMonotonic", &LogRecord::willStampMonotonic);
     cls.def("getProperties", (lsst::daf::base::PropertySet & (LogRecord::*)()) & LogRecord::getProperties,
             py::return_value_policy::reference_internal);
 }
@@ -43,6 +43,9 @@ PYBIND11_MODULE(screenLog, mod) {
     cls.def("setScreenThreshold", &ScreenLog::setScreenThreshold);
     cls.def("setScreenVerbose", &ScreenLog::setScreenVerbose);
     cls.def("isScreenVerbose", &ScreenLog::isScreenVerbose);
+    cls.def("setScreenNonBlocking", &ScreenLog::setScreenNonBlocking, "nonBlocking"_a,
+            "capacity"_a = 4096);
+    cls.def("isScreenNonBlocking", &ScreenLog::isScreenNonBlocking);
     cls.def_static("createDefaultLog", (void (*)(bool, int)) & ScreenLog::createDefaultLog,
                    "verbose"_a = false, "threshold"_a = Log::INFO);
     cls.def_static("createDefaultLog",
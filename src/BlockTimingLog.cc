@@ -26,6 +26,7 @@
  */
 
 #include "lsst/pex/logging/BlockTimingLog.h"
+#include "lsst/pex/logging/probes.h"
 #include <fstream>
 
 namespace lsst {
@@ -37,13 +38,73 @@ const int BlockTimingLog::INSTRUM = logging::Log::INFO - 3;
 const std::string BlockTimingLog::STATUS("STATUS");
 const std::string BlockTimingLog::START("start");
 const std::string BlockTimingLog::END("end");
+const std::size_t BlockTimingLog::MAX_POOLED = 8;
+
+namespace {
+
+    /*
+     * the released BlockTimingLog allocations a thread holds for reuse, 
+     * chained through the memory they occupied.  
+     */
+    struct BlockPool {
+        struct Free { Free *next; };
+        Free *head;
+        std::size_t count;
+
+        BlockPool() : head(0), count(0) { }
+        ~BlockPool() {
+            closed = true;
+            while (head) {
+                Free *f = head;
+                head = f->next;
+                ::operator delete(f);
+            }
+        }
+
+        // set once the calling thread's pool has been destroyed
+        static thread_local bool closed;
+    };
+    thread_local bool BlockPool::closed = false;
+
+    BlockPool *blockPool() {
+        if (BlockPool::closed) return 0;
+        static thread_local BlockPool pool;
+        return &pool;
+    }
+}
+
+void *BlockTimingLog::operator new(std::size_t size) {
+    BlockPool *pool = blockPool();
+    if (size != sizeof(BlockTimingLog) || ! pool || ! pool->head) 
+        return ::operator new(size);
+
+    BlockPool::Free *f = pool->head;
+    pool->head = f->next;
+    --pool->count;
+    return f;
+}
+
+void BlockTimingLog::operator delete(void *ptr, std::size_t size) {
+    if (! ptr) return;
+    BlockPool *pool = blockPool();
+    if (size != sizeof(BlockTimingLog) || ! pool || 
+        pool->count >= MAX_POOLED) 
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    BlockPool::Free *f = static_cast<BlockPool::Free*>(ptr);
+    f->next = pool->head;
+    pool->head = f;
+    ++pool->count;
+}
 
 BlockTimingLog::BlockTimingLog(const Log& parent, const std::string& name, 
                                int tracelev, int usageFlags, 
                                const std::string& funcName) 
     : Log(parent, name), _tracelev(tracelev), _pusageFlags(0), 
       _usageFlags(usageFlags), _funcName(funcName), _usage()
-      
 {
     if (_funcName.length() == 0) _funcName = name;
     const BlockTimingLog *p = dynamic_cast<const BlockTimingLog*>(&parent);
@@ -62,25 +123,55 @@ BlockTimingLog::BlockTimingLog(const Log& parent, const std::string& name,
 
 BlockTimingLog::~BlockTimingLog() { }
 
-void BlockTimingLog::addUsageProps(LogRecord& rec) {
-    if (! _usage.get()) _usage.reset(new struct rusage());
+void BlockTimingLog::start() {
+    LSST_LOGGING_PROBE2(block__start, getName().c_str(), 
+                        _funcName.c_str());
+    if (_records(_tracelev)) {
+        std::string msg("Starting ");
+        msg += _funcName;
+
+        LogRecord rec(_recordThreshold(), _tracelev, getSharedPreamble(), 
+                      willShowAll());
+        rec.addComment(msg);
+        rec.addProperty(STATUS, START);
+        if (_usageFlags) addUsageProps(rec);
+        send(rec);
+    }
+}
+
+void BlockTimingLog::done() {
+    LSST_LOGGING_PROBE2(block__done, getName().c_str(), 
+                        _funcName.c_str());
+    if (_records(_tracelev)) {
+        std::string msg("Ending ");
+        msg += _funcName;
+
+        LogRecord rec(_recordThreshold(), _tracelev, getSharedPreamble(), 
+                      willShowAll());
+        rec.addComment(msg);
+        rec.addProperty(STATUS, END);
+        if (_usageFlags) addUsageProps(rec);
+        send(rec);
+    }
+}
 
-    if (getrusage(RUSAGE_SELF, _usage.get()) == 0) {
+void BlockTimingLog::addUsageProps(LogRecord& rec) {
+    if (getrusage(RUSAGE_SELF, &_usage) == 0) {
         double d =  0;
         if (_usageFlags & UTIME)  {
-            d = _usage->ru_utime.tv_sec + _usage->ru_utime.tv_usec/1.0e6;
+            d = _usage.ru_utime.tv_sec + _usage.ru_utime.tv_usec/1.0e6;
             rec.addProperty("usertime", d);
         }
         if (_usageFlags & STIME)  {
-            d = _usage->ru_utime.tv_sec + _usage->ru_utime.tv_usec/1.0e6;
+            d = _usage.ru_utime.tv_sec + _usage.ru_utime.tv_usec/1.0e6;
             rec.addProperty("systemtime", d);
         }
-        if (_usageFlags & MEMSZ)  rec.addProperty("maxrss", _usage->ru_maxrss);
-        if (_usageFlags & MINFLT) rec.addProperty("minflt", _usage->ru_minflt);
-        if (_usageFlags & MAJFLT) rec.addProperty("majflt", _usage->ru_majflt);
-        if (_usageFlags & NSWAP)  rec.addProperty("nswap", _usage->ru_nswap);
-        if (_usageFlags & BLKIN)  rec.addProperty("blocksin", _usage->ru_inblock);
-        if (_usageFlags & BLKOUT) rec.addProperty("blocksout", _usage->ru_oublock);
+        if (_usageFlags & MEMSZ)  rec.addProperty("maxrss", _usage.ru_maxrss);
+        if (_usageFlags & MINFLT) rec.addProperty("minflt", _usage.ru_minflt);
+        if (_usageFlags & MAJFLT) rec.addProperty("majflt", _usage.ru_majflt);
+        if (_usageFlags & NSWAP)  rec.addProperty("nswap", _usage.ru_nswap);
+        if (_usageFlags & BLKIN)  rec.addProperty("blocksin", _usage.ru_inblock);
+        if (_usageFlags & BLKOUT) rec.addProperty("blocksout", _usage.ru_oublock);
     }
 }
 
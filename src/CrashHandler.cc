@@ -0,0 +1,332 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file CrashHandler.cc
+ */
+#include "lsst/pex/logging/CrashHandler.h"
+#include "lsst/pex/logging/LogFormatter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <signal.h>
+#include <unistd.h>
+#include <execinfo.h>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+namespace {
+
+/*
+ * a stream buffer that keeps the most recent bytes written to it in a 
+ * fixed-size ring.  Writers are serialized with a mutex; the ring can be
+ * read from a signal handler without locking (at the risk of a partly 
+ * written last record).
+ */
+class RingBuf : public std::streambuf {
+public:
+    explicit RingBuf(std::size_t size) 
+        : _buf(new char[size > 0 ? size : 1]), _size(size > 0 ? size : 1), 
+          _written(0)
+    { }
+
+    /*
+     * write the buffered bytes, oldest first.  Async-signal-safe.
+     */
+    void dump(int fd) const {
+        std::size_t written = _written.load(std::memory_order_acquire);
+        if (written <= _size) {
+            writeAll(fd, _buf, written);
+        }
+        else {
+            std::size_t start = written % _size;
+            writeAll(fd, _buf + start, _size - start);
+            writeAll(fd, _buf, start);
+        }
+    }
+
+    static void writeAll(int fd, const char *data, std::size_t len) {
+        while (len > 0) {
+            ssize_t n = ::write(fd, data, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            data += n;
+            len -= n;
+        }
+    }
+
+protected:
+    virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _put(s, n);
+        return n;
+    }
+
+    virtual int_type overflow(int_type c) {
+        if (traits_type::eq_int_type(c, traits_type::eof())) 
+            return traits_type::not_eof(c);
+        char ch = traits_type::to_char_type(c);
+        std::lock_guard<std::mutex> lock(_mtx);
+        _put(&ch, 1);
+        return c;
+    }
+
+private:
+    void _put(const char *s, std::size_t n) {
+        if (n > _size) {             // only the tail will fit
+            s += n - _size;
+            n = _size;
+        }
+        std::size_t written = _written.load(std::memory_order_relaxed);
+        std::size_t start = written % _size;
+        std::size_t first = std::min(n, _size - start);
+        std::memcpy(_buf + start, s, first);
+        std::memcpy(_buf, s + first, n - first);
+        _written.store(written + n, std::memory_order_release);
+    }
+
+    char *_buf;
+    std::size_t _size;
+    std::atomic<std::size_t> _written;
+    std::mutex _mtx;
+};
+
+const int signals[] = { SIGSEGV, SIGBUS, SIGABRT };
+const int nsignals = sizeof(signals) / sizeof(int);
+
+/*
+ * the handler's state.  This is allocated once and never freed so that 
+ * it remains usable during static destruction.
+ */
+struct State {
+    RingBuf *ring;
+    std::ostream *strm;
+    std::shared_ptr<LogDestination> recorder;
+    volatile sig_atomic_t ndescs;
+    int descs[CrashHandler::MAX_DESCRIPTORS];
+    bool installed;
+    struct sigaction previous[sizeof(signals) / sizeof(int)];
+};
+
+State *state = 0;
+std::mutex stateMutex;
+
+/*
+ * a thread's alternate signal stack, removed and freed when the thread 
+ * exits
+ */
+struct AltStack {
+    AltStack() : mem(0) { }
+    ~AltStack() {
+        if (mem == 0) return;
+        stack_t ss;
+        std::memset(&ss, 0, sizeof(ss));
+        ss.ss_flags = SS_DISABLE;
+        sigaltstack(&ss, 0);
+        delete [] mem;
+    }
+    char *mem;
+};
+
+thread_local AltStack altStack;
+
+const char *signalName(int sig) {
+    switch (sig) {
+    case SIGSEGV: return "SIGSEGV";
+    case SIGBUS:  return "SIGBUS";
+    case SIGABRT: return "SIGABRT";
+    default:      return "signal";
+    }
+}
+
+/*
+ * format a non-negative integer into buf (which must hold 21 chars) and 
+ * return the start of the digits.  Async-signal-safe.
+ */
+char *formatInt(long value, char *buf) {
+    char *p = buf + 20;
+    *p = '\0';
+    do {
+        *--p = '0' + static_cast<char>(value % 10);
+        value /= 10;
+    } while (value > 0 && p > buf);
+    return p;
+}
+
+void writeStr(int fd, const char *s) {
+    RingBuf::writeAll(fd, s, std::strlen(s));
+}
+
+extern "C" void handleCrash(int sig, siginfo_t *info, void *context) {
+    int saved = errno;
+    char num[21];
+    void *frames[64];
+    int nframes = backtrace(frames, 64);
+
+    for(int i=0; state != 0 && i < state->ndescs; ++i) {
+        int fd = state->descs[i];
+        state->ring->dump(fd);
+        writeStr(fd, "logging FATAL: caught ");
+        writeStr(fd, signalName(sig));
+        writeStr(fd, " (signal ");
+        writeStr(fd, formatInt(sig, num));
+        writeStr(fd, ") in process ");
+        writeStr(fd, formatInt(getpid(), num));
+        writeStr(fd, "; backtrace follows\n");
+        backtrace_symbols_fd(frames, nframes, fd);
+    }
+
+    /*
+     * hand the signal on to the action that was in effect before 
+     * install():  a handler function is called directly, so that it sees
+     * the original siginfo; otherwise the signal is raised again under 
+     * the restored action (the default one, unless it was ignored).
+     */
+    errno = saved;
+    int i = 0;
+    while (i < nsignals && signals[i] != sig) ++i;
+    if (state == 0 || i == nsignals) {
+        raise(sig);
+        return;
+    }
+    const struct sigaction& prev = state->previous[i];
+    sigaction(sig, &prev, 0);
+    if (prev.sa_flags & SA_SIGINFO) 
+        prev.sa_sigaction(sig, info, context);
+    else if (prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) 
+        prev.sa_handler(sig);
+    else 
+        raise(sig);
+}
+
+/*
+ * the size of an alternate signal stack:  SIGSTKSZ is too small for the 
+ * handler's backtrace() and any chained handler on some platforms.
+ */
+std::size_t altStackSize() {
+    return std::max<std::size_t>(SIGSTKSZ, 64*1024);
+}
+
+}  // end anonymous namespace
+
+/*
+ * install the handler for SIGSEGV, SIGBUS and SIGABRT.  
+ */
+void CrashHandler::install(int fd, std::size_t recorderSize) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (state == 0) {
+        state = new State();
+        state->ring = new RingBuf(recorderSize);
+        state->strm = new std::ostream(state->ring);
+        state->recorder.reset(new LogDestination(state->strm, 
+                          std::shared_ptr<LogFormatter>(new PrependedFormatter())));
+        state->ndescs = 0;
+        state->installed = false;
+
+        // backtrace() may allocate on first use; do that now rather than 
+        // in the handler.
+        void *frames[2];
+        backtrace(frames, 2);
+    }
+
+    if (state->ndescs < MAX_DESCRIPTORS) 
+        state->descs[state->ndescs++] = fd;
+
+    protectThread();
+
+    if (! state->installed) {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = handleCrash;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_SIGINFO | SA_RESETHAND | SA_ONSTACK;
+        for(int i=0; i < nsignals; ++i) 
+            sigaction(signals[i], &sa, &state->previous[i]);
+        state->installed = true;
+    }
+}
+
+/*
+ * give the calling thread an alternate signal stack, so that a stack 
+ * overflow in it can still be reported.
+ */
+void CrashHandler::protectThread() {
+    if (altStack.mem != 0) return;
+    stack_t ss;
+    std::memset(&ss, 0, sizeof(ss));
+    ss.ss_size = altStackSize();
+    ss.ss_sp = new char[ss.ss_size];
+    if (sigaltstack(&ss, 0) == 0) 
+        altStack.mem = static_cast<char*>(ss.ss_sp);
+    else
+        delete [] static_cast<char*>(ss.ss_sp);
+}
+
+/*
+ * add a file descriptor to write the crash report to.
+ */
+void CrashHandler::addDescriptor(int fd) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (state != 0 && state->ndescs < MAX_DESCRIPTORS) 
+        state->descs[state->ndescs++] = fd;
+}
+
+/*
+ * restore the signal actions that were in effect before install()
+ */
+void CrashHandler::uninstall() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (state == 0 || ! state->installed) return;
+    for(int i=0; i < nsignals; ++i) 
+        sigaction(signals[i], &state->previous[i], 0);
+    state->ndescs = 0;
+    state->installed = false;
+}
+
+bool CrashHandler::isInstalled() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return (state != 0 && state->installed);
+}
+
+std::shared_ptr<LogDestination> CrashHandler::getFlightRecorder() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return (state == 0) ? std::shared_ptr<LogDestination>() 
+                        : state->recorder;
+}
+
+/*
+ * write the current contents of the flight recorder to a file descriptor.
+ */
+void CrashHandler::dumpFlightRecorder(int fd) {
+    if (state != 0) state->ring->dump(fd);
+}
+
+//@endcond
+}}} // end lsst::pex::logging
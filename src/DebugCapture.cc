@@ -0,0 +1,198 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file DebugCapture.cc
+ */
+#include "lsst/pex/logging/DebugCapture.h"
+
+#include <exception>
+#include <sstream>
+
+//@cond
+#ifndef __cpp_lib_uncaught_exceptions
+/*
+ * strict C++14 headers hide std::uncaught_exceptions(), though the 
+ * runtime exports it:  libstdc++ (since GCC 6) exports the std function 
+ * itself, and libc++abi exports the ABI function it is built on (which 
+ * not every <cxxabi.h> declares).
+ */
+#ifdef __GLIBCXX__
+namespace std { int uncaught_exceptions() throw(); }
+#define LSST_UNCAUGHT_EXCEPTIONS() std::uncaught_exceptions()
+#else
+extern "C" unsigned int __cxa_uncaught_exceptions() throw();
+#define LSST_UNCAUGHT_EXCEPTIONS() static_cast<int>(__cxa_uncaught_exceptions())
+#endif
+#endif
+//@endcond
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+
+namespace {
+
+    /*
+     * return the number of exceptions thrown but not yet caught in the 
+     * calling thread.  Where std::uncaught_exceptions() is not provided 
+     * (strict C++14), the count comes from the function the C++ runtime
+     * exports for it.
+     */
+    int uncaughtExceptions() {
+#ifdef __cpp_lib_uncaught_exceptions
+        return std::uncaught_exceptions();
+#else
+        return LSST_UNCAUGHT_EXCEPTIONS();
+#endif
+    }
+
+}
+
+/*
+ * start capturing debugging messages for the current thread.
+ */
+DebugCapture::DebugCapture(const Log& log, int threshold, int flushThreshold,
+                           std::size_t maxRecords) 
+    : _log(log), _block(0), _threshold(threshold), 
+      _flushThreshold(flushThreshold), _max(maxRecords), _dropped(0), 
+      _triggered(false), _records(), _prev(0), _uncaught(0)
+{ 
+    _init();
+}
+
+/*
+ * start capturing debugging messages for the current thread over 
+ * the execution of a block of code instrumented with a BlockTimingLog.
+ */
+DebugCapture::DebugCapture(BlockTimingLog& block, int threshold, 
+                           int flushThreshold, std::size_t maxRecords) 
+    : _log(block), _block(&block), _threshold(threshold), 
+      _flushThreshold(flushThreshold), _max(maxRecords), _dropped(0), 
+      _triggered(false), _records(), _prev(0), _uncaught(0)
+{ 
+    _init();
+    _block->start();
+}
+
+void DebugCapture::_init() {
+    _uncaught = uncaughtExceptions();
+    _prev = Log::_capture;
+    Log::_capture = this;
+}
+
+/*
+ * end the capture.  
+ */
+DebugCapture::~DebugCapture() {
+    if (_block != 0) {
+        try {
+            _block->done();
+        } catch (...) { }
+    }
+    if (uncaughtExceptions() > _uncaught && ! _triggered) {
+        try {
+            _writeOut();
+        } catch (...) { }
+    }
+    Log::_capture = _prev;
+}
+
+/*
+ * write out the buffered records now and keep writing captured 
+ * records as they arrive.
+ */
+void DebugCapture::flush() {
+    _triggered = true;
+    _writeOut();
+}
+
+void DebugCapture::_writeOut() {
+    if (_dropped > 0) {
+        LogRecord note(_threshold, _threshold, _log.getSharedPreamble(), 
+                       _log.willShowAll());
+        std::ostringstream msg;
+        msg << _dropped << " earlier captured records were dropped";
+        note.addComment(msg.str());
+        _log._write(note);
+        _dropped = 0;
+    }
+    while (! _records.empty()) {
+        _log._write(_records.front());
+        _records.pop_front();
+    }
+}
+
+/*
+ * keep a record that did not pass its Log's threshold
+ */
+void DebugCapture::_keep(const LogRecord& record) {
+    if (! record.willRecord()) return;
+
+    DebugCapture *capture = Log::_capture;
+    while (capture != 0 && record.getImportance() < capture->_threshold) 
+        capture = capture->_prev;
+    if (capture == 0) return;
+
+    if (capture->_triggered) {
+        capture->_log._write(record);
+        return;
+    }
+    if (capture->_max == 0) {
+        ++capture->_dropped;
+        return;
+    }
+    if (capture->_records.size() >= capture->_max) {
+        capture->_records.pop_front();
+        ++capture->_dropped;
+    }
+    capture->_records.push_back(record);
+}
+
+/*
+ * flush all captures in effect if importance triggers any of them
+ */
+void DebugCapture::_check(int importance) {
+    for(DebugCapture *capture = Log::_capture; 
+        capture != 0; capture = capture->_prev) 
+    {
+        if (importance >= capture->_flushThreshold) {
+            _flushAll(Log::_capture);
+            return;
+        }
+    }
+}
+
+/*
+ * flush a capture and the ones it is nested in, outermost first so that
+ * the records come out in the order they were logged.
+ */
+void DebugCapture::_flushAll(DebugCapture *capture) {
+    if (capture == 0) return;
+    _flushAll(capture->_prev);
+    if (! capture->_triggered) capture->flush();
+}
+
+//@endcond
+}}} // end lsst::pex::logging
@@ -81,9 +81,11 @@ void DualLog::_init(const string& filename, int filethresh) {
     _file = new LogDestination(fstrm, fmtr, filethresh);
     shared_ptr<LogDestination> dest(_file);
     _destinations.push_back( dest );
+    _destinationsChanged();
 }
 
 DualLog::~DualLog() { 
+    _file->stopWriter();
     fstrm->close();
     delete fstrm;
 }
@@ -25,11 +25,203 @@
  * @author Ray Plante
  */
 #include "lsst/pex/logging/FileDestination.h"
+#include "lsst/pex/logging/LogRecord.h"
+#include "lsst/pex/exceptions.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace lsst {
 namespace pex {
 namespace logging {
 
+//@cond
+namespace pexExcept = lsst::pex::exceptions;
+
+/*
+ * the state needed to make records durable.  Records are committed by
+ * ticket:  each durable record, once flushed to the file, takes the next
+ * ticket number, and a sync commits every ticket taken before it started.
+ * The first thread that needs a sync when none is underway performs it 
+ * (after waiting out the delay) on behalf of everyone waiting; the others
+ * wait for it to finish and, if their tickets came too late, for the next.
+ * A sync that fails commits nothing:  its range of tickets is kept with 
+ * the error until the thread waiting on each of them has been told.
+ */
+class FileDestination::Commit {
+public:
+    Commit(const boost::filesystem::path& path, int importance, int delay);
+    ~Commit();
+
+    /*
+     * take a ticket for a record that has just been flushed
+     */
+    std::uint64_t take();
+
+    /*
+     * wait until the file has been synced with a given ticket's record.
+     * Throw a RuntimeError if the sync covering it failed.
+     */
+    void wait(std::uint64_t ticket);
+
+    /*
+     * return the number of syncs done
+     */
+    std::size_t syncs();
+
+    std::mutex writing;       // serializes writing to the stream
+    const int importance;     // the minimum importance of durable records
+
+private:
+    // the tickets (from, through] covered by a failed sync
+    struct Failure {
+        std::uint64_t from, through;
+        std::uint64_t untold;     // the waiters not yet told of it
+        int error;                // the errno from fsync()
+    };
+
+    std::string _path;
+    int _fd;                  // the descriptor to sync
+    std::chrono::microseconds _delay;
+    std::mutex _mtx;
+    std::condition_variable _synced;
+    std::uint64_t _taken;     // the last ticket taken
+    std::uint64_t _committed; // the last ticket committed
+    std::uint64_t _attempted; // the last ticket covered by a finished sync
+    std::deque<Failure> _failures;
+    bool _syncing;            // true while a sync is underway
+    std::size_t _syncs;       // the number of syncs done
+};
+
+FileDestination::Commit::Commit(const boost::filesystem::path& path, 
+                                int importance, int delay)
+    : importance(importance), _path(path.string()), _fd(-1), 
+      _delay(delay > 0 ? delay : 0), _taken(0), _committed(0), 
+      _attempted(0), _failures(), _syncing(false), _syncs(0)
+{
+    _fd = ::open(path.string().c_str(), O_WRONLY | O_CLOEXEC);
+    if (_fd < 0) 
+        throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                          "unable to open log file for syncing: " + 
+                          path.string());
+}
+
+FileDestination::Commit::~Commit() {
+    ::close(_fd);
+}
+
+std::uint64_t FileDestination::Commit::take() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return ++_taken;
+}
+
+void FileDestination::Commit::wait(std::uint64_t ticket) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (_attempted < ticket) {
+        if (_syncing) {
+            _synced.wait(lock);
+            continue;
+        }
+
+        // lead the next sync
+        _syncing = true;
+        if (_delay.count() > 0) {
+            lock.unlock();
+            std::this_thread::sleep_for(_delay);
+            lock.lock();
+        }
+        std::uint64_t upto = _taken;
+        lock.unlock();
+        int err = 0;
+        while (::fsync(_fd) != 0) {
+            if (errno != EINTR) { err = errno; break; }
+        }
+        lock.lock();
+
+        if (err == 0) {
+            _committed = upto;
+        }
+        else {
+            Failure failed = { _attempted, upto, upto - _attempted, err };
+            _failures.push_back(failed);
+        }
+        _attempted = upto;
+        ++_syncs;
+        _syncing = false;
+        _synced.notify_all();
+    }
+    if (_failures.empty()) return;
+
+    // tell the waiter if the ticket was covered by a failed sync
+    std::deque<Failure>::iterator it = _failures.begin();
+    while (it != _failures.end() && 
+           (ticket <= it->from || ticket > it->through)) 
+        ++it;
+    if (it == _failures.end()) return;
+    int err = it->error;
+    if (--it->untold == 0) _failures.erase(it);
+    throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                      "failed to sync log file " + _path + ": " + 
+                      std::strerror(err));
+}
+
+std::size_t FileDestination::Commit::syncs() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _syncs;
+}
+//@endcond
+
+/**
+ * create a file destination.  If the file does not exist, it will 
+ * be created; otherwise, messages will be appended.
+ * @param filepath    the path to the log file to write messages to.
+ * @param formatter   the LogFormatter to use to format the messages 
+ * @param threshold   the minimum volume level required to pass a message
+ *                       to the stream.  If not provided, it would be set
+ *                       to 0.  
+ * @param truncate    if True, overwrite the previous contents; otherwise,
+ *                       new messages will be appended to the file.
+ */
+FileDestination::FileDestination(const std::string& filepath,
+                                 const std::shared_ptr<LogFormatter>& formatter,
+                                 int threshold, bool truncate)
+    : LogDestination(new std::ofstream(filepath.c_str(),
+                                       truncate ? std::ios::out : std::ios::app), 
+                     formatter, threshold),
+      _path(filepath) 
+{ 
+    setLabel(_path.string());
+}
+FileDestination::FileDestination(const char *filepath,
+                                 const std::shared_ptr<LogFormatter>& formatter,
+                                 int threshold, bool truncate)
+    : LogDestination(new std::ofstream(filepath,
+                                       truncate ? std::ios::out : std::ios::app), 
+                     formatter, threshold),
+      _path(filepath) 
+{ 
+    setLabel(_path.string());
+}
+FileDestination::FileDestination(const boost::filesystem::path& filepath,
+                                 const std::shared_ptr<LogFormatter>& formatter,
+                                 int threshold, bool truncate)
+    : LogDestination(new std::ofstream(filepath.string().c_str(),
+                                       truncate ? std::ios::out : std::ios::app), 
+                     formatter, threshold),
+      _path(filepath) 
+{ 
+    setLabel(_path.string());
+}
+
 /**
  * create a file destination.  If the file does not exist, it will 
  * be created; otherwise, messages will be appended.  The PrependedFormatter
@@ -48,7 +240,9 @@ FileDestination::FileDestination(const boost::filesystem::path& filepath,
                      std::shared_ptr<LogFormatter>(new PrependedFormatter(verbose)),
                      threshold),
       _path(filepath) 
-{ }
+{ 
+    setLabel(_path.string());
+}
 FileDestination::FileDestination(const std::string& filepath, bool verbose, 
                                  int threshold, bool truncate)
     : LogDestination(new std::ofstream(filepath.c_str(), 
@@ -56,7 +250,9 @@ FileDestination::FileDestination(const std::string& filepath, bool verbose,
                      std::shared_ptr<LogFormatter>(new PrependedFormatter(verbose)),
                      threshold),
       _path(filepath) 
-{ }
+{ 
+    setLabel(_path.string());
+}
 FileDestination::FileDestination(const char *filepath, bool verbose, 
                                  int threshold, bool truncate)
     : LogDestination(new std::ofstream(filepath, 
@@ -64,12 +260,15 @@ FileDestination::FileDestination(const char *filepath, bool verbose,
                      std::shared_ptr<LogFormatter>(new PrependedFormatter(verbose)),
                      threshold),
       _path(filepath) 
-{ }
+{ 
+    setLabel(_path.string());
+}
 
 /*
  * delete this destination
  */
 FileDestination::~FileDestination() { 
+    stopWriter();
     std::ofstream *ofstrm = dynamic_cast<std::ofstream*>(_strm);
     if (ofstrm != NULL && ofstrm->is_open()) {
         try {
@@ -81,6 +280,57 @@ FileDestination::~FileDestination() {
     delete _strm;
 }
 
+/*
+ * make records at or above a given importance durable
+ */
+void FileDestination::setDurability(int importance, int maxDelay) {
+    _commit.reset(new Commit(_path, importance, maxDelay));
+}
+
+/*
+ * stop making records durable
+ */
+void FileDestination::clearDurability() {
+    _commit.reset();
+}
+
+/*
+ * return the minimum importance of durable records
+ */
+int FileDestination::getDurableThreshold() const {
+    return (_commit.get() == 0) ? 0 : _commit->importance;
+}
+
+/*
+ * return the number of times the file has been synced
+ */
+std::size_t FileDestination::getSyncCount() const {
+    return (_commit.get() == 0) ? 0 : _commit->syncs();
+}
+
+/*
+ * format a record and write it to the file, syncing the file if the 
+ * record is to be made durable.
+ */
+void FileDestination::_writeRecord(const LogRecord& rec, 
+                                   const std::string *text) 
+{
+    if (_commit.get() == 0) {
+        LogDestination::_writeRecord(rec, text);
+        return;
+    }
+
+    std::uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(_commit->writing);
+        LogDestination::_writeRecord(rec, text);
+        if (rec.getImportance() < _commit->importance) return;
+        _strm->flush();
+        ticket = _commit->take();
+    }
+    _commit->wait(ticket);
+}
+
 
 
 
@@ -0,0 +1,325 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file Format.cc
+ * @brief implementation of the "{}"-style message formatting functions
+ */
+#include "lsst/pex/logging/Format.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <streambuf>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+using lsst::daf::base::DateTime;
+
+void FormatBuffer::_grow(std::size_t n) {
+    std::size_t cap = 2*_capacity;
+    if (cap < _size + n) cap = _size + n;
+    char *data = new char[cap];
+    std::memcpy(data, _data, _size);
+    if (_data != _inline) delete [] _data;
+    _data = data;
+    _capacity = cap;
+}
+
+void FormatBuffer::align(std::size_t start, const FormatSpec& spec, 
+                         char align) 
+{
+    std::size_t len = _size - start;
+    if (spec.width <= 0 || len >= static_cast<std::size_t>(spec.width)) 
+        return;
+    if (spec.align != 0) align = spec.align;
+
+    std::size_t pad = spec.width - len;
+    std::size_t before = (align == '>') ? pad : (align == '^') ? pad/2 : 0;
+    reserve(pad);
+    char *field = _data + start;
+    std::memmove(field + before, field, len);
+    for(std::size_t i=0; i < before; ++i) field[i] = spec.fill;
+    for(std::size_t i=before+len; i < pad+len; ++i) field[i] = spec.fill;
+    _size += pad;
+}
+
+namespace formatting {
+
+    /*
+     * write a number's sign and prefix, zero padding and digits, then 
+     * align it.  Zero padding goes between the prefix and the digits.
+     */
+    void writeNumber(FormatBuffer& out, const char *prefix, 
+                     const char *digits, std::size_t ndigits, 
+                     const FormatSpec& spec) 
+    {
+        std::size_t start = out.size();
+        std::size_t plen = std::strlen(prefix);
+        out.append(prefix, plen);
+        if (spec.zero && spec.align == 0 && 
+            plen + ndigits < static_cast<std::size_t>(spec.width))
+            out.append(spec.width - plen - ndigits, '0');
+        out.append(digits, ndigits);
+        out.align(start, spec, '>');
+    }
+
+    void writeInteger(FormatBuffer& out, bool negative, 
+                      unsigned long long magnitude, const FormatSpec& spec) 
+    {
+        if (spec.type == 'c') {
+            char c = static_cast<char>(magnitude);
+            std::size_t start = out.size();
+            out.push_back(c);
+            out.align(start, spec, '<');
+            return;
+        }
+
+        unsigned base = 10;
+        const char *xdigits = "0123456789abcdef";
+        char prefix[4] = { '\0', '\0', '\0', '\0' };
+        int np = 0;
+        if (negative) prefix[np++] = '-';
+        else if (spec.sign == '+' || spec.sign == ' ') prefix[np++] = spec.sign;
+        switch (spec.type) {
+        case 'x': base = 16;  break;
+        case 'X': base = 16;  xdigits = "0123456789ABCDEF";  break;
+        case 'o': base = 8;   break;
+        case 'b': base = 2;   break;
+        }
+        if (spec.alt && base != 10) {
+            prefix[np++] = '0';
+            prefix[np++] = (base == 16) ? spec.type : (base == 8) ? 'o' : 'b';
+        }
+
+        char digits[64];
+        char *p = digits + sizeof(digits);
+        do {
+            *--p = xdigits[magnitude % base];
+            magnitude /= base;
+        } while (magnitude != 0);
+        writeNumber(out, prefix, p, digits + sizeof(digits) - p, spec);
+    }
+
+    void writeFloat(FormatBuffer& out, double value, const FormatSpec& spec) {
+        char conv = spec.type;
+        int precision = spec.precision;
+        bool percent = (conv == '%');
+        if (percent) {
+            value *= 100.0;
+            conv = 'f';
+        }
+        if (conv == 0) conv = 'g';
+        if (percent && precision < 0) precision = 6;
+
+        // build the printf conversion, minus width, which is handled here
+        char pfmt[16];
+        char *f = pfmt;
+        *f++ = '%';
+        if (spec.sign == '+' || spec.sign == ' ') *f++ = spec.sign;
+        if (spec.alt) *f++ = '#';
+        *f++ = '.';
+        *f++ = '*';
+        *f++ = conv;
+        *f = '\0';
+
+        // with no type or precision, write the shortest form that reads 
+        // back as the same value
+        char buf[64];
+        int n;
+        if (spec.type == 0 && precision < 0) {
+            n = std::snprintf(buf, sizeof(buf), pfmt, 15, value);
+            if (std::strtod(buf, 0) != value) 
+                n = std::snprintf(buf, sizeof(buf), pfmt, 17, value);
+        }
+        else {
+            if (precision < 0) precision = 6;
+            n = std::snprintf(buf, sizeof(buf), pfmt, precision, value);
+        }
+
+        const char *digits = buf;
+        std::size_t ndigits = 0;
+        if (n < static_cast<int>(sizeof(buf))) {
+            ndigits = n;
+        }
+        else {
+            // very large values with a fixed-point conversion
+            std::size_t start = out.size();
+            char *to = out.reserve(n+1);
+            std::snprintf(to, n+1, pfmt, precision, value);
+            out.commit(n);
+            if (percent) out.push_back('%');
+            out.align(start, spec, '>');
+            return;
+        }
+
+        // separate the sign so that zero padding follows it
+        char prefix[2] = { '\0', '\0' };
+        if (ndigits > 0 && (*digits == '-' || *digits == '+' || *digits == ' ')) {
+            prefix[0] = *digits++;
+            --ndigits;
+        }
+        if (percent) buf[n] = '%', ++ndigits;
+        writeNumber(out, prefix, digits, ndigits, spec);
+    }
+
+    void writeString(FormatBuffer& out, boost::string_view value, 
+                     const FormatSpec& spec) 
+    {
+        if (spec.precision >= 0 && 
+            value.size() > static_cast<std::size_t>(spec.precision))
+            value = value.substr(0, spec.precision);
+        std::size_t start = out.size();
+        out.append(value.data(), value.size());
+        out.align(start, spec, '<');
+    }
+
+    void writePointer(FormatBuffer& out, const void *value, 
+                      const FormatSpec& spec) 
+    {
+        FormatSpec hex(spec);
+        hex.type = 'x';
+        hex.alt = true;
+        writeInteger(out, false, reinterpret_cast<std::size_t>(value), hex);
+    }
+
+    void ArgRef::_chars(FormatBuffer& out, const void *value, 
+                        const FormatSpec& spec) 
+    {
+        FormatValue<const char*>::format(out, static_cast<const char*>(value), 
+                                         spec);
+    }
+
+    void vformat(FormatBuffer& out, boost::string_view fmt, 
+                 const ArgRef *args, std::size_t nargs) 
+    {
+        const char *p = fmt.data(), *end = p + fmt.size();
+        std::size_t arg = 0;
+        while (p < end) {
+            // copy the literal text up to the next brace in one go
+            const char *lit = p;
+            while (p < end && *p != '{' && *p != '}') ++p;
+            if (p > lit) out.append(lit, p - lit);
+            if (p == end) break;
+
+            if (p + 1 < end && p[1] == *p) {
+                // an escaped brace
+                out.push_back(*p);
+                p += 2;
+                continue;
+            }
+
+            // a field; the format has been checked, so it is well formed
+            FormatSpec spec;
+            ++p;
+            if (p < end && *p == ':') p = parseSpec(p+1, end, spec);
+            if (p == nullptr) break;
+            ++p;
+            if (arg < nargs) args[arg++].write(out, spec);
+        }
+    }
+
+    class BufferStream::Buf : public std::streambuf {
+    public:
+        explicit Buf(FormatBuffer& out) : _out(out) { }
+    protected:
+        virtual int_type overflow(int_type c) {
+            if (! traits_type::eq_int_type(c, traits_type::eof())) 
+                _out.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+        virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+            _out.append(s, n);
+            return n;
+        }
+    private:
+        FormatBuffer& _out;
+    };
+
+    BufferStream::BufferStream(FormatBuffer& out) 
+        : std::ostream(0), _buf(new Buf(out))
+    {
+        rdbuf(_buf);
+    }
+
+    BufferStream::~BufferStream() { delete _buf; }
+}
+
+void FormatValue<bool>::format(FormatBuffer& out, const bool& value, 
+                               const FormatSpec& spec) 
+{
+    if (spec.type == 0 || spec.type == 's') 
+        formatting::writeString(out, value ? "true" : "false", spec);
+    else
+        formatting::writeInteger(out, false, value ? 1 : 0, spec);
+}
+
+void FormatValue<char>::format(FormatBuffer& out, const char& value, 
+                               const FormatSpec& spec) 
+{
+    if (spec.type == 0 || spec.type == 'c') {
+        std::size_t start = out.size();
+        out.push_back(value);
+        out.align(start, spec, '<');
+    }
+    else {
+        formatting::writeInteger(out, value < 0, 
+                                 value < 0 ? -static_cast<int>(value) : value,
+                                 spec);
+    }
+}
+
+void FormatValue<const char*>::format(FormatBuffer& out, const char *value, 
+                                      const FormatSpec& spec) 
+{
+    formatting::writeString(out, value ? value : "(null)", spec);
+}
+
+/*
+ * write the time in the style of LogRecord's DATE property, but in full:
+ * YYYY-MM-DDThh:mm:ss.ffffffZ
+ */
+void FormatValue<DateTime>::format(FormatBuffer& out, const DateTime& value,
+                                   const FormatSpec& spec) 
+{
+    if (spec.type == 'n') {
+        long long ns = value.nsecs(DateTime::UTC);
+        formatting::writeInteger(out, ns < 0, 
+                                 ns < 0 ? 0ULL - ns : ns, spec);
+        return;
+    }
+
+    struct timeval tv = value.timeval(DateTime::UTC);
+    struct tm t;
+    gmtime_r(&tv.tv_sec, &t);
+    char buf[40];
+    std::size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &t);
+    n += std::snprintf(buf+n, sizeof(buf)-n, ".%06ldZ", 
+                       static_cast<long>(tv.tv_usec));
+    formatting::writeString(out, boost::string_view(buf, n), spec);
+}
+//@endcond
+
+}}}     // end lsst::pex::logging
@@ -0,0 +1,217 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LatencyHistogram.cc
+ */
+#include "lsst/pex/logging/LatencyHistogram.h"
+
+#include <iomanip>
+#include <utility>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+using std::uint64_t;
+
+/*
+ * the counters recorded to by one group of threads
+ */
+struct LatencyHistogram::Shard {
+    Shard() : count(0), max(0) {
+        for(int i=0; i < NBUCKETS; ++i) counts[i].store(0);
+    }
+
+    void add(const Shard& that) {
+        for(int i=0; i < NBUCKETS; ++i) {
+            uint64_t n = that.counts[i].load(std::memory_order_relaxed);
+            if (n > 0) counts[i].fetch_add(n, std::memory_order_relaxed);
+        }
+        count.fetch_add(that.count.load(std::memory_order_relaxed), 
+                        std::memory_order_relaxed);
+        raise(that.max.load(std::memory_order_relaxed));
+    }
+
+    void raise(uint64_t value) {
+        uint64_t seen = max.load(std::memory_order_relaxed);
+        while (value > seen && 
+               ! max.compare_exchange_weak(seen, value, 
+                                           std::memory_order_relaxed)) 
+        { }
+    }
+
+    std::atomic<uint64_t> counts[NBUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> max;
+};
+
+namespace {
+    /*
+     * return the number identifying the calling thread's shards
+     */
+    unsigned int threadShard() {
+        static std::atomic<unsigned int> next(0);
+        static thread_local unsigned int shard = next.fetch_add(1);
+        return shard;
+    }
+}
+
+/*
+ * create an empty histogram
+ */
+LatencyHistogram::LatencyHistogram(int shards) 
+    : _nshards(shards > 0 ? shards : 1), _shards(new Shard[_nshards])
+{ }
+
+/*
+ * create an unsharded copy of a histogram
+ */
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& that) 
+    : _nshards(1), _shards(new Shard[1])
+{
+    merge(that);
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& that) {
+    LatencyHistogram copy(that);
+    std::swap(_nshards, copy._nshards);
+    std::swap(_shards, copy._shards);
+    return *this;
+}
+
+LatencyHistogram::~LatencyHistogram() {
+    delete [] _shards;
+}
+
+/*
+ * return the index of the bucket that counts a given latency
+ */
+int LatencyHistogram::bucketFor(uint64_t nanos) {
+    if (nanos < uint64_t(SUB_BUCKETS)) return static_cast<int>(nanos);
+    if (nanos >= (uint64_t(1) << MAX_BITS)) return NBUCKETS - 1;
+    int shift = (63 - __builtin_clzll(nanos)) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + 
+           static_cast<int>((nanos >> shift) - SUB_BUCKETS);
+}
+
+/*
+ * return the largest latency counted by a given bucket
+ */
+uint64_t LatencyHistogram::bucketLimit(int bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+/*
+ * count a latency
+ */
+void LatencyHistogram::record(uint64_t nanos) {
+    Shard& shard = _shards[threadShard() % _nshards];
+    shard.counts[bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.raise(nanos);
+}
+
+/*
+ * add the counts of another histogram to this one
+ */
+void LatencyHistogram::merge(const LatencyHistogram& that) {
+    for(int i=0; i < that._nshards; ++i) _shards[0].add(that._shards[i]);
+}
+
+/*
+ * return the number of latencies recorded
+ */
+uint64_t LatencyHistogram::getCount() const {
+    uint64_t count = 0;
+    for(int i=0; i < _nshards; ++i) 
+        count += _shards[i].count.load(std::memory_order_relaxed);
+    return count;
+}
+
+/*
+ * return the longest latency recorded
+ */
+uint64_t LatencyHistogram::getMax() const {
+    uint64_t max = 0;
+    for(int i=0; i < _nshards; ++i) {
+        uint64_t m = _shards[i].max.load(std::memory_order_relaxed);
+        if (m > max) max = m;
+    }
+    return max;
+}
+
+/*
+ * return the latency below which a given percentage of latencies fall
+ */
+uint64_t LatencyHistogram::getPercentile(double percent) const {
+    if (_nshards > 1) return LatencyHistogram(*this).getPercentile(percent);
+
+    const Shard& shard = _shards[0];
+    uint64_t total = 0;
+    for(int i=0; i < NBUCKETS; ++i) 
+        total += shard.counts[i].load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+
+    if (percent < 0) percent = 0;
+    if (percent > 100) percent = 100;
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t max = shard.max.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for(int i=0; i < NBUCKETS; ++i) {
+        seen += shard.counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t limit = bucketLimit(i);
+            return (limit < max) ? limit : max;
+        }
+    }
+    return max;
+}
+
+/*
+ * print a summary of the distribution
+ */
+void LatencyHistogram::write(std::ostream& strm) const {
+    static const double percents[] = { 50.0, 90.0, 99.0, 99.9 };
+    static const char *names[] = { "p50", "p90", "p99", "p99.9" };
+
+    LatencyHistogram merged(*this);
+    std::ios::fmtflags flags = strm.flags();
+    std::streamsize precision = strm.precision();
+    strm << "count " << merged.getCount() 
+         << std::fixed << std::setprecision(3);
+    for(int i=0; i < 4; ++i) 
+        strm << ", " << names[i] << " " 
+             << merged.getPercentile(percents[i]) / 1000.0;
+    strm << ", max " << merged.getMax() / 1000.0 << " usec";
+    strm.flags(flags);
+    strm.precision(precision);
+}
+
+//@endcond
+}}} // end lsst::pex::logging
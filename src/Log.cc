@@ -30,8 +30,21 @@
 
 #include "lsst/pex/logging/Log.h"
 #include "lsst/pex/logging/ScreenLog.h"
+#include "lsst/pex/logging/DebugCapture.h"
+#include "lsst/pex/logging/probes.h"
 
 #include <memory>
+#include <chrono>
+
+/*
+ * the semaphores of the probes (see probes.h)
+ */
+LSST_LOGGING_SEMAPHORE(send)
+LSST_LOGGING_SEMAPHORE(reject)
+LSST_LOGGING_SEMAPHORE(write__start)
+LSST_LOGGING_SEMAPHORE(write__done)
+LSST_LOGGING_SEMAPHORE(block__start)
+LSST_LOGGING_SEMAPHORE(block__done)
 
 namespace lsst {
 namespace pex {
@@ -85,6 +98,11 @@ const int Log::FATAL = 20;
  */
 const int Log::INHERIT_THRESHOLD = threshold::INHERIT;
 
+/*
+ * the innermost DebugCapture in effect in the calling thread
+ */
+thread_local DebugCapture *Log::_capture = 0;
+
 /*
  * create a null log.  This constructor should 
  * not normally be employed to obtain a Log; the static getDefaultLog() 
@@ -97,12 +115,12 @@ const int Log::INHERIT_THRESHOLD = threshold::INHERIT;
 Log::Log(const int threshold, const string& name) 
     : _threshold(threshold), _defShowAll(new bool(false)), _myShowAll(), 
       _name(name), _thresholds(new threshold::Memory(Log::_sep)), 
-      _destinations(), _preamble(new PropertySet())
+      _destinations(), _preamble(), _sharedFormatter(false)
 {
     _thresholds->setRootThreshold(threshold);
     if (name.length() > 0) _thresholds->setThresholdFor(name, threshold);
     _myShowAll = _defShowAll;
-    completePreamble();
+    completePreamble(PropertySet::Ptr(new PropertySet()));
 }
 
 /*
@@ -130,11 +148,12 @@ Log::Log(const list<shared_ptr<LogDestination> > &destinations,
          const string &name, const int threshold, bool defaultShowAll)
     : _threshold(threshold), _defShowAll(new bool(defaultShowAll)), 
       _myShowAll(), _name(name), _thresholds(new threshold::Memory(Log::_sep)),
-      _destinations(destinations), _preamble(preamble.deepCopy())
+      _destinations(destinations), _preamble(), _sharedFormatter(false)
 {  
+    _destinationsChanged();
     _thresholds->setRootThreshold(threshold);
     if (name.length() > 0) _thresholds->setThresholdFor(name, threshold);
-    completePreamble();
+    completePreamble(preamble.deepCopy());
 }
 
 /*
@@ -144,7 +163,7 @@ Log::Log(const Log& that)
     : _threshold(that._threshold), _defShowAll(that._defShowAll), 
       _myShowAll(that._myShowAll), _name(that._name), 
       _thresholds(that._thresholds), _destinations(that._destinations), 
-      _preamble(that._preamble->deepCopy())
+      _preamble(that._preamble), _sharedFormatter(that._sharedFormatter)
 { }
 
 /* 
@@ -162,12 +181,27 @@ Log& Log::operator=(const Log& that) {
     _name = that._name;
     _thresholds = that._thresholds;
     _destinations = that._destinations;
-    _preamble = that._preamble->deepCopy();
+    _preamble = that._preamble;
+    _sharedFormatter = that._sharedFormatter;
     return *this;
 }
 
-void Log::completePreamble() {
-    _preamble->set<string>("LOG", _name);
+/*
+ * set the LOG property on a freshly made preamble and install it as 
+ * this Log's snapshot.
+ */
+void Log::completePreamble(const PropertySet::Ptr& preamble) {
+    preamble->set<string>("LOG", _name);
+    _setPreamble(preamble);
+}
+
+/*
+ * add a label to the preamble property of this Log.  
+ */
+void Log::addLabel(const string& val) {
+    PropertySet::Ptr preamble = _copyPreamble();
+    preamble->add(LSST_LP_LABEL, val);
+    _setPreamble(preamble);
 }
 
 /*
@@ -186,7 +220,7 @@ Log::Log(const Log& parent, const string& childName, int threshold)
     : _threshold(threshold), _defShowAll(parent._defShowAll), 
       _myShowAll(), _name(parent.getName()), _thresholds(parent._thresholds), 
       _destinations(parent._destinations), 
-      _preamble(parent._preamble->deepCopy())  
+      _preamble(parent._preamble), _sharedFormatter(parent._sharedFormatter)
 { 
     if (_name.length() > 0) _name += _sep;
     _name += childName;
@@ -194,7 +228,8 @@ Log::Log(const Log& parent, const string& childName, int threshold)
     if (_threshold > INHERIT_THRESHOLD) 
         _thresholds->setThresholdFor(_name, _threshold);
 
-    completePreamble();
+    // only the LOG property differs from the parent's snapshot
+    if (_name != parent._name) completePreamble(_copyPreamble());
 }
 
 /*
@@ -261,10 +296,11 @@ Log *Log::createChildLog(const string& childName, int threshold) const {
 void Log::log(int importance, const string& message, 
               const PropertySet& properties) 
 {
-    int threshold = getThreshold();
-    if (importance < threshold)
+    if (! _mayPass(importance)) return;
+    int threshold = _recordThreshold();
+    if (_below(importance, threshold))
         return;
-    LogRecord rec(threshold, importance, *_preamble, willShowAll());
+    LogRecord rec(threshold, importance, _preamble, willShowAll());
     rec.addComment(message);
     rec.addProperties(properties);
     send(rec);
@@ -276,10 +312,21 @@ void Log::log(int importance, const string& message,
  * @param message      a simple bit of text to send in the message
  */
 void Log::log(int importance, const string& message) {
-    int threshold = getThreshold();
-    if (importance < threshold)
+    if (! _mayPass(importance)) return;
+    int threshold = _recordThreshold();
+    if (_below(importance, threshold))
         return;
-    LogRecord rec(threshold, importance, *_preamble, willShowAll());
+    LogRecord rec(threshold, importance, _preamble, willShowAll());
+    rec.addComment(message);
+    send(rec);
+}
+
+/*
+ * build and send a record carrying a single comment.  This does not 
+ * check the Log threshold; it assumes this has already been done.
+ */
+void Log::_log(int threshold, int importance, boost::string_view message) {
+    LogRecord rec(threshold, importance, _preamble, willShowAll());
     rec.addComment(message);
     send(rec);
 }
@@ -293,8 +340,9 @@ void Log::log(int importance, const string& message) {
  * @param ...          the inputs to the formatting.
  */
 void Log::format(int importance, const char *fmt, ...) {
-    int threshold = getThreshold();
-    if (importance < threshold) return;
+    if (! _mayPass(importance)) return;
+    int threshold = _recordThreshold();
+    if (_below(importance, threshold)) return;
     va_list ap;
     va_start(ap, fmt);
 	_format(importance, fmt, ap);
@@ -323,7 +371,7 @@ void Log::_send(int threshold, int importance, const char *fmt, va_list ap) {
     char message[len];
     vsnprintf(message, len, fmt, ap);
 
-    LogRecord rec(threshold, importance, *_preamble, willShowAll());
+    LogRecord rec(threshold, importance, _preamble, willShowAll());
     rec.addComment(message);
     send(rec);
 }
@@ -333,12 +381,72 @@ void Log::_send(int threshold, int importance, const char *fmt, va_list ap) {
  * send a fully formed LogRecord to the log destinations
  */
 void Log::send(const LogRecord& record) {
-    if (record.getImportance() < getThreshold()) 
+    if (_below(record.getImportance(), getThreshold())) {
+        if (_capture != 0) DebugCapture::_keep(record);
         return;
+    }
+    if (_capture != 0) DebugCapture::_check(record.getImportance());
+    _write(record);
+}
+
+/*
+ * return the lower of the given threshold and the thresholds of the 
+ * DebugCaptures in effect in the calling thread.
+ */
+int Log::_captureThreshold(int threshold) const {
+    for(DebugCapture *c = _capture; c != 0; c = c->_prev) {
+        if (c->_threshold < threshold) threshold = c->_threshold;
+    }
+    return threshold;
+}
+
+/*
+ * fire the reject probe for a message of the given importance
+ */
+void Log::_probeReject(int importance) const {
+    LSST_LOGGING_PROBE2(reject, _name.c_str(), importance);
+}
+
+/*
+ * write a record to all of this Log's destinations without checking 
+ * the Log's threshold.
+ */
+void Log::_write(const LogRecord& record) {
+    LSST_LOGGING_PROBE2(send, _name.c_str(), record.getImportance());
+    LogMetrics::count(LogMetrics::SENT);
+    bool timed = LogMetrics::isRecordingLatency();
+    std::chrono::steady_clock::time_point start;
+    if (timed) start = std::chrono::steady_clock::now();
+
+    // destinations sharing a formatter share its rendering of the record
     list<shared_ptr<LogDestination> >::iterator i;
-    for(i = _destinations.begin(); i != _destinations.end(); i++) {
-        (*i)->write(record);
+    if (_sharedFormatter) {
+        RecordRendering rendering(record);
+        for(i = _destinations.begin(); i != _destinations.end(); i++) 
+            (*i)->write(record, rendering);
+    }
+    else {
+        for(i = _destinations.begin(); i != _destinations.end(); i++) 
+            (*i)->write(record);
+    }
+
+    if (timed) LogMetrics::recordSendLatency(start);
+}
+
+/*
+ * return true if two or more of this Log's destinations use the same 
+ * formatter
+ */
+bool Log::_sharesFormatter() const {
+    list<shared_ptr<LogDestination> >::const_iterator i, j;
+    for(i = _destinations.begin(); i != _destinations.end(); ++i) {
+        LogFormatter *frmtr = (*i)->getFormatter().get();
+        if (frmtr == 0) continue;
+        for(j = i, ++j; j != _destinations.end(); ++j) {
+            if ((*j)->getFormatter().get() == frmtr) return true;
+        }
     }
+    return false;
 }
 
 /*
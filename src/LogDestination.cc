@@ -26,10 +26,25 @@
  */
 #include "lsst/pex/logging/LogDestination.h"
 #include "lsst/pex/logging/LogRecord.h"
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/probes.h"
 
 #include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <deque>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <boost/any.hpp>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace std;
 
 namespace lsst {
@@ -39,6 +54,386 @@ namespace logging {
 //@cond
 using std::shared_ptr;
 
+const RecordRendering::Text RecordRendering::_none;
+
+/*
+ * return the record's text as rendered by a formatter, rendering it if 
+ * that has not been done already.
+ */
+const RecordRendering::Text& RecordRendering::render(LogFormatter& formatter) 
+{
+    for(int i=0; i < _count; ++i) {
+        if (_formatters[i] == &formatter) return _texts[i];
+    }
+    if (_count == MAX_FORMATTERS) return _none;
+
+    static thread_local std::ostringstream buf;
+    buf.str("");
+    buf.clear();
+    formatter.write(&buf, _rec);
+    _formatters[_count] = &formatter;
+    _texts[_count] = std::make_shared<const std::string>(buf.str());
+    return _texts[_count++];
+}
+
+/*
+ * return the record's text as rendered by a formatter, or null
+ */
+const RecordRendering::Text& 
+RecordRendering::find(const LogFormatter& formatter) const {
+    for(int i=0; i < _count; ++i) {
+        if (_formatters[i] == &formatter) return _texts[i];
+    }
+    return _none;
+}
+
+/*
+ * a queue of records and the thread that writes them to a destination's
+ * stream.  The destination's backpressure settings are read under the 
+ * queue's lock.
+ */
+class LogDestination::Writer {
+public:
+    Writer(LogDestination *dest, std::size_t capacity, Overflow overflow, 
+           int cpu);
+
+    /*
+     * write out the queue and stop the thread
+     */
+    ~Writer();
+
+    /*
+     * queue a record, and its text if it has already been rendered, 
+     * applying the overflow policy if the queue is full.  Return false if
+     * the record was discarded.
+     */
+    bool push(const LogRecord& rec, const RecordRendering::Text& text);
+
+    /*
+     * wait until the queue is empty and the thread is idle, or until the
+     * deadline passes.  If summarize is true, also have the thread write
+     * a summary of the records dropped since the last one.  Return false
+     * if the deadline passed first.
+     */
+    bool flush(bool summarize=false, 
+               std::chrono::steady_clock::time_point deadline = 
+                   std::chrono::steady_clock::time_point::max());
+
+    /*
+     * write out the queues of all running writers, with a summary of 
+     * what each has dropped.  This is registered with atexit() so that 
+     * queued records are not lost when the process exits normally.  So 
+     * that a stream that has stopped accepting output (e.g. a terminal 
+     * that is never read) cannot keep the process from exiting, it gives
+     * up after EXIT_FLUSH seconds in all.
+     */
+    static void flushAll();
+
+    /*
+     * return the number of records dropped since the thread started
+     */
+    std::size_t dropped();
+
+    std::mutex mtx;
+    std::condition_variable ready, room, idle;
+
+private:
+    enum { DEBUGS, INFOS, WARNS, FATALS, NLEVELS };
+    enum { EXIT_FLUSH = 5 };        // seconds flushAll() waits in all
+
+    // a queued record and its rendered text, if any
+    struct Entry {
+        Entry(const LogRecord& r, const RecordRendering::Text& t) 
+            : rec(r), text(t) { }
+        LogRecord rec;
+        RecordRendering::Text text;
+    };
+
+    void _run();
+    void _drop(int importance);
+    bool _shed(int threshold);
+    void _writeSummary(std::unique_lock<std::mutex>& lock);
+
+    static std::set<Writer*>& _live();
+    static std::mutex _liveMtx;
+
+    LogDestination *_dest;
+    std::size_t _capacity;
+    Overflow _overflow;
+    std::deque<Entry> _queue;
+    bool _busy, _done;
+    std::size_t _total;
+    std::size_t _pending[NLEVELS];
+    bool _summaryDue, _summarizeNow;
+    std::chrono::steady_clock::time_point _summaryTime;
+    std::thread _thread;
+};
+
+std::mutex LogDestination::Writer::_liveMtx;
+
+/*
+ * return the running writers, registering flushAll() to be called at exit
+ * the first time this is called.  The set is never deleted, as writers 
+ * belonging to static destinations may be deleted after it would be.
+ */
+std::set<LogDestination::Writer*>& LogDestination::Writer::_live() {
+    static std::set<Writer*> *live = new std::set<Writer*>();
+    static bool registered = (std::atexit(&Writer::flushAll) == 0);
+    (void) registered;
+    return *live;
+}
+
+void LogDestination::Writer::flushAll() {
+    std::chrono::steady_clock::time_point deadline = 
+        std::chrono::steady_clock::now() + std::chrono::seconds(EXIT_FLUSH);
+    std::lock_guard<std::mutex> lock(_liveMtx);
+    for (Writer *writer : _live()) writer->flush(true, deadline);
+}
+
+LogDestination::Writer::Writer(LogDestination *dest, std::size_t capacity, 
+                               Overflow overflow, int cpu) 
+    : _dest(dest), _capacity(capacity > 0 ? capacity : 1), 
+      _overflow(overflow), _queue(), _busy(false), _done(false), _total(0),
+      _summaryDue(false), _summarizeNow(false), _summaryTime()
+{ 
+    for(int i=0; i < NLEVELS; ++i) _pending[i] = 0;
+    _thread = std::thread(&Writer::_run, this);
+    {
+        std::lock_guard<std::mutex> lock(_liveMtx);
+        _live().insert(this);
+    }
+#ifdef __linux__
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        pthread_setaffinity_np(_thread.native_handle(), sizeof(cpus), &cpus);
+    }
+#endif
+}
+
+LogDestination::Writer::~Writer() {
+    {
+        std::lock_guard<std::mutex> lock(_liveMtx);
+        _live().erase(this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        _done = true;
+    }
+    ready.notify_one();
+    _thread.join();
+}
+
+/*
+ * count a dropped record by level, scheduling a summary if this is the 
+ * first drop since the last one.
+ */
+void LogDestination::Writer::_drop(int importance) {
+    if (! _summaryDue) {
+        _summaryDue = true;
+        _summaryTime = std::chrono::steady_clock::now() + 
+                       std::chrono::seconds(_dest->_summaryInterval);
+        ready.notify_one();
+    }
+    if (importance >= Log::FATAL) ++_pending[FATALS];
+    else if (importance >= Log::WARN) ++_pending[WARNS];
+    else if (importance >= Log::INFO) ++_pending[INFOS];
+    else ++_pending[DEBUGS];
+    ++_total;
+    _dest->_metrics->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * discard the oldest queued record below threshold.  Return false if 
+ * there is none.
+ */
+bool LogDestination::Writer::_shed(int threshold) {
+    std::deque<Entry>::iterator it;
+    for(it = _queue.begin(); it != _queue.end(); ++it) {
+        if (it->rec.getImportance() < threshold) {
+            _drop(it->rec.getImportance());
+            _queue.erase(it);
+            _dest->_metrics->setQueued(_queue.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LogDestination::Writer::push(const LogRecord& rec, 
+                                  const RecordRendering::Text& text) 
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    if (_queue.size() >= _capacity) {
+        bool wait = false;
+        switch (_overflow) {
+        case DROP_NEWEST:
+            _drop(rec.getImportance());
+            return false;
+        case DROP_OLDEST:
+            _drop(_queue.front().rec.getImportance());
+            _queue.pop_front();
+            break;
+        case DROP_BELOW:
+            if (rec.getImportance() < _dest->_shedThreshold) {
+                _drop(rec.getImportance());
+                return false;
+            }
+            wait = ! _shed(_dest->_shedThreshold);
+            break;
+        case SHED:
+            if (rec.getImportance() < _dest->_shedThreshold) {
+                _drop(rec.getImportance());
+                return false;
+            }
+            if (! _shed(_dest->_shedThreshold)) {
+                // shed the oldest of the least important records, unless
+                // the new one is less important still
+                std::deque<Entry>::iterator least = _queue.begin(), it;
+                for(it = _queue.begin(); it != _queue.end(); ++it) {
+                    if (it->rec.getImportance() < least->rec.getImportance())
+                        least = it;
+                }
+                if (rec.getImportance() < least->rec.getImportance()) {
+                    _drop(rec.getImportance());
+                    return false;
+                }
+                _drop(least->rec.getImportance());
+                _queue.erase(least);
+            }
+            break;
+        default:
+            wait = true;
+        }
+
+        if (wait) {
+            auto hasRoom = [this]{ return _queue.size() < _capacity; };
+            if (_dest->_blockTimeout < 0) {
+                room.wait(lock, hasRoom);
+            }
+            else if (! room.wait_for(lock, 
+                         std::chrono::milliseconds(_dest->_blockTimeout), 
+                         hasRoom)) 
+            {
+                _drop(rec.getImportance());
+                return false;
+            }
+        }
+    }
+    _queue.emplace_back(rec, text);
+    _dest->_metrics->setQueued(_queue.size());
+    lock.unlock();
+    ready.notify_one();
+    return true;
+}
+
+bool LogDestination::Writer::flush(
+                          bool summarize, 
+                          std::chrono::steady_clock::time_point deadline) 
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    if (summarize && _summaryDue) {
+        _summarizeNow = true;
+        ready.notify_one();
+    }
+    return idle.wait_until(lock, deadline, [this]{ 
+        return _queue.empty() && ! _busy && ! _summarizeNow; 
+    });
+}
+
+std::size_t LogDestination::Writer::dropped() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return _total;
+}
+
+/*
+ * write a record reporting the records dropped since the last summary.
+ * This is called by the writer thread with the lock held; the record is 
+ * built under the lock, which is released while it is written so that 
+ * a slow (or synced) write does not hold up the threads queueing records.
+ */
+void LogDestination::Writer::_writeSummary(std::unique_lock<std::mutex>& lock)
+{
+    static const char *names[NLEVELS] = { "DEBUG", "INFO", "WARN", "FATAL" };
+
+    std::size_t count = 0;
+    std::ostringstream msg;
+    for(int i=0; i < NLEVELS; ++i) count += _pending[i];
+    _summaryDue = false;
+    if (count == 0) return;
+
+    msg << "dropped " << count << " records (";
+    const char *sep = "";
+    for(int i=0; i < NLEVELS; ++i) {
+        if (_pending[i] == 0) continue;
+        msg << sep << names[i] << ": " << _pending[i];
+        sep = ", ";
+        _pending[i] = 0;
+    }
+    msg << ") because the queue was full";
+
+    LogRecord rec(Log::WARN, Log::WARN);
+    rec.addProperty(LSST_LP_LOG, std::string("logging"));
+    rec.addComment(msg.str());
+    rec.addProperty("DROPPED", static_cast<int>(count));
+
+    bool busy = _busy;
+    _busy = true;
+    lock.unlock();
+    try {
+        _dest->_writeRecord(rec, 0);
+    }
+    catch (...) { }
+    lock.lock();
+    _busy = busy;
+    idle.notify_all();
+}
+
+void LogDestination::Writer::_run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        auto hasWork = [this]{ 
+            return _done || _summarizeNow || ! _queue.empty(); 
+        };
+        if (_summaryDue && _dest->_summaryInterval > 0) {
+            ready.wait_until(lock, _summaryTime, hasWork);
+            if (std::chrono::steady_clock::now() >= _summaryTime) 
+                _writeSummary(lock);
+        }
+        else {
+            ready.wait(lock, hasWork);
+        }
+        if (_queue.empty()) {
+            if (_summarizeNow) {
+                _summarizeNow = false;
+                _writeSummary(lock);
+                idle.notify_all();
+            }
+            if (_done && _queue.empty()) break;     // nothing left to write
+            continue;
+        }
+
+        Entry entry(std::move(_queue.front()));
+        _queue.pop_front();
+        _dest->_metrics->setQueued(_queue.size());
+        _busy = true;
+        lock.unlock();
+        room.notify_one();
+
+        try {
+            _dest->_writeRecord(entry.rec, entry.text.get());
+        }
+        catch (...) { }
+
+        lock.lock();
+        _busy = false;
+        if (_queue.empty()) idle.notify_all();
+    }
+    _writeSummary(lock);
+    idle.notify_all();
+}
+
 /*
  * @brief create a destination with a threshold.  
  * @param strm       the output stream to send messages to.  If the pointer
@@ -52,28 +447,44 @@ using std::shared_ptr;
 LogDestination::LogDestination(ostream *strm, 
                                const shared_ptr<LogFormatter>& formatter,
                                int threshold) 
-    : _threshold(threshold), _strm(strm), _frmtr(formatter)
+    : _threshold(threshold), _strm(strm), _frmtr(formatter), _filter(), 
+      _writer(),
+      _blockTimeout(-1), _shedThreshold(Log::WARN), _summaryInterval(60),
+      _metrics(LogMetrics::_newDestination())
 { }
 
 /*
  * create a copy
  */
 LogDestination::LogDestination(const LogDestination& that)
-    : _threshold(that._threshold), _strm(that._strm), _frmtr(that._frmtr)
-{ }
+    : _threshold(that._threshold), _strm(that._strm), _frmtr(that._frmtr),
+      _filter(std::atomic_load(&that._filter)), _writer(), _blockTimeout(that._blockTimeout), 
+      _shedThreshold(that._shedThreshold), 
+      _summaryInterval(that._summaryInterval),
+      _metrics(LogMetrics::_newDestination())
+{ 
+    _metrics->setLabel(that._metrics->snapshot().label);
+}
 
 /*
  * delete this destination
  */
-LogDestination::~LogDestination() { }
+LogDestination::~LogDestination() { 
+    stopWriter();
+}
 
 /*
  * copy a destination into this one
  */
 LogDestination& LogDestination::operator=(const LogDestination& that) {
+    stopWriter();
     _threshold = that._threshold;
     _strm = that._strm; 
     _frmtr = that._frmtr;
+    std::atomic_store(&_filter, std::atomic_load(&that._filter));
+    _blockTimeout = that._blockTimeout;
+    _shedThreshold = that._shedThreshold;
+    _summaryInterval = that._summaryInterval;
     return *this;
 }
 
@@ -81,22 +492,204 @@ LogDestination& LogDestination::operator=(const LogDestination& that) {
  * record a given log record to this destinations output stream. The 
  * record will be sent to the stream attached to this class if (a)
  * there is actually an attached stream, (b) there is an attached
- * formatter, and (c) the importance level associated with the
+ * formatter, (c) the importance level associated with the
  * record is equal to or greater than the threshold associated
- * with this destination. 
+ * with this destination, and (d) the record satisfies the filter, 
+ * if there is one. 
  * @return  true if the record was actually passed to the
  *          associated stream. 
  */
 bool LogDestination::write(const LogRecord& rec) {
-    if (_strm != 0 && _frmtr.get() != 0 && 
-        rec.getImportance() >= _threshold)
-    {
-        _frmtr->write(_strm, rec);
-        return true;
+    return _write(rec, 0);
+}
+
+/*
+ * record a given log record to this destination's output stream, using 
+ * (or adding to) a rendering of the record shared with other destinations.
+ */
+bool LogDestination::write(const LogRecord& rec, RecordRendering& rendering) {
+    return _write(rec, &rendering);
+}
+
+bool LogDestination::_write(const LogRecord& rec, RecordRendering *rendering) {
+    if (_strm == 0 || _frmtr.get() == 0 || rec.getImportance() < _threshold)
+        return false;
+    shared_ptr<const RecordFilter> filter = std::atomic_load(&_filter);
+    if (filter.get() == 0 || filter->matches(rec)) {
+        LSST_LOGGING_PROBE2(write__start, _metrics->id, rec.getImportance());
+        bool timed = LogMetrics::isRecordingLatency();
+        std::chrono::steady_clock::time_point start;
+        if (timed) start = std::chrono::steady_clock::now();
+
+        // a writer thread formats records itself unless another 
+        // destination has already done so
+        bool written = true;
+        shared_ptr<Writer> writer = std::atomic_load(&_writer);
+        if (writer) {
+            written = writer->push(rec, (rendering == 0) 
+                                         ? RecordRendering::Text()
+                                         : rendering->find(*_frmtr));
+        }
+        else if (rendering != 0) {
+            _writeRecord(rec, rendering->render(*_frmtr).get());
+        }
+        else {
+            _writeRecord(rec, 0);
+        }
+
+        if (timed) _metrics->recordWrite(start);
+        LSST_LOGGING_PROBE2(write__done, _metrics->id, rec.getImportance());
+        return written;
     }
     return false;
 }
 
+/*
+ * format a record (unless it has been already) and write it to the stream
+ */
+void LogDestination::_writeRecord(const LogRecord& rec, 
+                                  const std::string *text) 
+{
+    if (text != 0) {
+        // the formatters end each line with std::endl, so flush the 
+        // stream as they would have
+        typedef std::chrono::steady_clock clock;
+        bool timing = LogMetrics::isTiming();
+        clock::time_point start;
+        if (timing) start = clock::now();
+        _strm->write(text->data(), text->size());
+        _strm->flush();
+        if (timing) 
+            _metrics->writeNanos.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - start).count(), std::memory_order_relaxed);
+        _metrics->records.fetch_add(1, std::memory_order_relaxed);
+        _metrics->bytes.fetch_add(text->size(), std::memory_order_relaxed);
+        return;
+    }
+
+    if (! LogMetrics::isTiming()) {
+        _frmtr->write(_strm, rec);
+        _metrics->records.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // format into a buffer so that formatting and writing can be timed 
+    // separately.  The formatters end each line with std::endl, so flush 
+    // the stream as they would have.
+    typedef std::chrono::steady_clock clock;
+    static thread_local std::ostringstream buf;
+    buf.str("");
+    buf.clear();
+    clock::time_point start = clock::now();
+    _frmtr->write(&buf, rec);
+    std::string rendered = buf.str();
+    clock::time_point formatted = clock::now();
+    _strm->write(rendered.data(), rendered.size());
+    _strm->flush();
+    clock::time_point written = clock::now();
+
+    _metrics->records.fetch_add(1, std::memory_order_relaxed);
+    _metrics->bytes.fetch_add(rendered.size(), std::memory_order_relaxed);
+    _metrics->formatNanos.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            formatted - start).count(), std::memory_order_relaxed);
+    _metrics->writeNanos.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            written - formatted).count(), std::memory_order_relaxed);
+}
+
+/*
+ * start a thread dedicated to writing this destination's records.  
+ */
+void LogDestination::startWriter(std::size_t capacity, Overflow overflow, 
+                                 int cpu) 
+{
+    stopWriter();
+    std::atomic_store(&_writer, 
+                      shared_ptr<Writer>(new Writer(this, capacity, 
+                                                    overflow, cpu)));
+}
+
+/*
+ * write out any queued records and stop the writer thread.  Once the 
+ * writer is unpublished, no thread can pick it up again; the threads 
+ * still pushing to it are waited out so that the queue is drained, and 
+ * the thread stopped, here.
+ */
+void LogDestination::stopWriter() {
+    shared_ptr<Writer> writer = std::atomic_exchange(&_writer, 
+                                                     shared_ptr<Writer>());
+    if (! writer) return;
+    while (writer.use_count() > 1) std::this_thread::yield();
+    writer.reset();
+}
+
+/*
+ * return true if this destination has a writer thread running
+ */
+bool LogDestination::hasWriter() const {
+    return (std::atomic_load(&_writer) != 0);
+}
+
+/*
+ * wait until all records queued so far have been written to the stream.
+ */
+void LogDestination::flushWriter() {
+    shared_ptr<Writer> writer = std::atomic_load(&_writer);
+    if (writer) writer->flush();
+}
+
+/*
+ * set the longest time write() will wait for room in a full queue.
+ */
+void LogDestination::setBlockTimeout(int millis) {
+    shared_ptr<Writer> writer = std::atomic_load(&_writer);
+    if (! writer) {
+        _blockTimeout = millis;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writer->mtx);
+    _blockTimeout = millis;
+}
+
+/*
+ * set the importance below which records are shed first under DROP_BELOW
+ */
+void LogDestination::setShedThreshold(int importance) {
+    shared_ptr<Writer> writer = std::atomic_load(&_writer);
+    if (! writer) {
+        _shedThreshold = importance;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writer->mtx);
+    _shedThreshold = importance;
+}
+
+/*
+ * set the time between summary records reporting dropped records.
+ */
+void LogDestination::setDropSummaryInterval(int seconds) {
+    shared_ptr<Writer> writer = std::atomic_load(&_writer);
+    if (! writer) {
+        _summaryInterval = seconds;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writer->mtx);
+        _summaryInterval = seconds;
+    }
+    writer->ready.notify_one();
+}
+
+/*
+ * return the total number of records dropped by the overflow policy
+ */
+std::size_t LogDestination::getDroppedCount() const {
+    shared_ptr<Writer> writer = std::atomic_load(&_writer);
+    return (! writer) ? 0 : writer->dropped();
+}
+
 //@endcond
 }}} // end lsst::pex::logging
 
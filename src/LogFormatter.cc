@@ -31,6 +31,7 @@
 #include "lsst/pex/logging/LogRecord.h"
 #include "lsst/pex/logging/Log.h"
 #include "lsst/pex/logging/PropertyPrinter.h"
+#include "lsst/pex/logging/TextScan.h"
 #include "lsst/pex/exceptions.h"
 #include "lsst/daf/base/PropertySet.h"
 
@@ -38,6 +39,8 @@
 #include <boost/any.hpp>
 #include <string>
 #include <sstream>
+#include <typeinfo>
+#include <vector>
 
 using std::string;
 
@@ -54,6 +57,107 @@ namespace pexExcept = lsst::pex::exceptions;
 
 LogFormatter::~LogFormatter() {}
 
+///////////////////////////////////////////////////////////
+//  PreambleCache
+///////////////////////////////////////////////////////////
+
+const int PreambleCache::MAX_SNAPSHOTS;
+
+PreambleCache::Texts::Texts(dafBase::PropertySet::ConstPtr const& snapshot,
+                            Render const& render)
+    : _snapshot(snapshot), _texts()
+{
+    std::ostringstream buf;
+    std::vector<std::string> names = snapshot->paramNames(false);
+    for (auto const& vi : names) {
+        buf.str("");
+        render(&buf, *snapshot, vi);
+        _texts.push_back(std::make_pair(vi, buf.str()));
+    }
+}
+
+/*
+ * return the rendered properties of a snapshot, rendering them if 
+ * necessary
+ */
+std::shared_ptr<PreambleCache::Texts const> 
+PreambleCache::get(dafBase::PropertySet::ConstPtr const& snapshot, 
+                   Render const& render) 
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    for (auto const& texts : _texts) {
+        if (texts->getSnapshot() == snapshot) return texts;
+    }
+
+    std::shared_ptr<Texts const> out(new Texts(snapshot, render));
+    if (_texts.size() < static_cast<std::size_t>(MAX_SNAPSHOTS)) {
+        _texts.push_back(out);
+    }
+    else {
+        _texts[_next] = out;
+        _next = (_next + 1) % MAX_SNAPSHOTS;
+    }
+    return out;
+}
+
+namespace {
+
+    /*
+     * the indentation of the lines after the first of a multi-line 
+     * comment or property value
+     */
+    const string continuation("    ");
+
+    /*
+     * write each value of a property on a line of its own
+     */
+    void writeProperty(std::ostream *strm, dafBase::PropertySet const& props,
+                       string const& name)
+    {
+        if (props.typeOf(name) == typeid(string)) {
+            std::vector<string> values = props.getArray<string>(name);
+            for (auto const& value : values) {
+                (*strm) << "  " << name << ": ";
+                writeIndented(strm, value, continuation);
+                (*strm) << std::endl;
+            }
+            return;
+        }
+
+        PropertyPrinter pp(props, name);
+        for (PropertyPrinter::iterator pi=pp.begin(); pi.notAtEnd(); ++pi) {
+            (*strm) << "  " << name << ": ";
+            pi.write(strm) << std::endl;
+        }
+    }
+
+    /*
+     * write all the properties of a record but its log name and comments
+     * (and its label if skipLabel is true), taking the text of those from
+     * the record's shared preamble from the cache.
+     */
+    void writeProperties(std::ostream *strm, LogRecord const& rec, 
+                         PreambleCache& cache, bool skipLabel) 
+    {
+        dafBase::PropertySet::ConstPtr const& shared = rec.getSharedPreamble();
+        std::shared_ptr<PreambleCache::Texts const> pre;
+        if (shared) pre = cache.get(shared, writeProperty);
+
+        std::vector<std::string> names = rec.paramNames();
+        for (auto const& vi : names) {
+            if (vi == LSST_LP_COMMENT || vi == LSST_LP_LOG) continue;
+            if (skipLabel && vi == LSST_LP_LABEL) continue;
+
+            dafBase::PropertySet const& props = rec.propertiesFor(vi);
+            string const *text = (&props == shared.get()) ? pre->find(vi) : 0;
+            if (text) 
+                (*strm) << *text;
+            else
+                writeProperty(strm, props, vi);
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////
 //  BriefFormatter
 ///////////////////////////////////////////////////////////
@@ -72,7 +176,7 @@ void BriefFormatter::write(std::ostream *strm, LogRecord const& rec) {
     std::vector<std::string> comments;
 
     try {
-        level = rec.data().get<int>(LSST_LP_LEVEL);
+        level = rec.propertiesFor(LSST_LP_LEVEL).get<int>(LSST_LP_LEVEL);
         if (level >= Log::FATAL) levstr = " FATAL: ";
         else if (level >= Log::WARN) levstr = " WARNING: ";
         else if (level < Log::INFO) levstr = " DEBUG: ";
@@ -80,32 +184,25 @@ void BriefFormatter::write(std::ostream *strm, LogRecord const& rec) {
     } catch (pexExcept::NotFoundError const & ex) {}
 
     try { 
-        log = rec.data().get<string>(LSST_LP_LOG);
+        log = rec.propertiesFor(LSST_LP_LOG).get<string>(LSST_LP_LOG);
     } catch (pexExcept::TypeError const & ex) {
         log = "mis-specified_log_name";
     } catch (pexExcept::NotFoundError const & ex) {}
 
     try {
-        comments = rec.data().getArray<string>(LSST_LP_COMMENT);
+        comments = rec.propertiesFor(LSST_LP_COMMENT).getArray<string>(LSST_LP_COMMENT);
     } catch (pexExcept::TypeError const & ex) {
         comments.push_back("(mis-specified_comment)");
     } catch (pexExcept::NotFoundError const & ex) {}
 
     for (auto const& vi : comments) {
-        (*strm) << log << levstr << vi << std::endl;
+        (*strm) << log << levstr;
+        writeIndented(strm, vi, continuation);
+        (*strm) << std::endl;
     }
 
     if (isVerbose() || rec.willShowAll()) {
-        std::vector<std::string> names = rec.data().paramNames(false);
-        for (auto const& vi : names) {
-            if (vi == LSST_LP_COMMENT || vi == LSST_LP_LOG) continue;
-
-            PropertyPrinter pp(rec.data(), vi);
-            for (PropertyPrinter::iterator pi=pp.begin(); pi.notAtEnd(); ++pi) {
-                (*strm) << "  " << vi << ": ";
-                pi.write(strm) << std::endl;
-            }
-        }
+        writeProperties(strm, rec, _preambleCache, false);
         (*strm)  << std::endl;
     }
 }
@@ -128,7 +225,7 @@ void IndentedFormatter::write(std::ostream *strm, LogRecord const& rec) {
     std::vector<std::string> comments;
 
     try {
-        level = rec.data().get<int>(LSST_LP_LEVEL);
+        level = rec.propertiesFor(LSST_LP_LEVEL).get<int>(LSST_LP_LEVEL);
         if (level >= Log::FATAL) levstr = " FATAL: ";
         else if (level >= Log::WARN) levstr = " WARNING: ";
         else if (level < Log::INFO) levstr = " DEBUG: ";
@@ -136,13 +233,13 @@ void IndentedFormatter::write(std::ostream *strm, LogRecord const& rec) {
     } catch (pexExcept::NotFoundError const & ex) {}
 
     try { 
-        log = rec.data().get<string>(LSST_LP_LOG);
+        log = rec.propertiesFor(LSST_LP_LOG).get<string>(LSST_LP_LOG);
     } catch (pexExcept::TypeError const & ex) {
         log = "mis-specified_log_name";
     } catch (pexExcept::NotFoundError const & ex) {}
 
     try {
-        comments = rec.data().getArray<string>(LSST_LP_COMMENT);
+        comments = rec.propertiesFor(LSST_LP_COMMENT).getArray<string>(LSST_LP_COMMENT);
     } catch (pexExcept::TypeError const & ex) {
         comments.push_back("(mis-specified_comment)");
     } catch (pexExcept::NotFoundError const & ex) {}
@@ -155,17 +252,31 @@ void IndentedFormatter::write(std::ostream *strm, LogRecord const& rec) {
         }
     }
     string indent(indentstr.str());
+    string contindent(indent + continuation);
 
     for (auto const& vi : comments) {
-        (*strm) << indent << log << levstr << vi << std::endl;
+        (*strm) << indent << log << levstr;
+        writeIndented(strm, vi, contindent);
+        (*strm) << std::endl;
     }
 
     if (isVerbose() || rec.willShowAll()) {
-        std::vector<std::string> names = rec.data().paramNames(false);
+        std::vector<std::string> names = rec.paramNames();
         for (auto const& vi : names) {
             if (vi == LSST_LP_COMMENT || vi == LSST_LP_LOG) continue;
 
-            PropertyPrinter pp(rec.data(), vi);
+            dafBase::PropertySet const& props = rec.propertiesFor(vi);
+            if (props.typeOf(vi) == typeid(string)) {
+                std::vector<string> values = props.getArray<string>(vi);
+                for (auto const& value : values) {
+                    (*strm) << indent << "  " << vi << ": ";
+                    writeIndented(strm, value, contindent);
+                    (*strm) << std::endl;
+                }
+                continue;
+            }
+
+            PropertyPrinter pp(props, vi);
             for (PropertyPrinter::iterator pi=pp.begin(); pi.notAtEnd(); ++pi) {
                 (*strm) << indent << "  " << vi << ": ";
                 pi.write(strm) << std::endl;
@@ -222,30 +333,66 @@ NetLoggerFormatter& NetLoggerFormatter::operator=(NetLoggerFormatter const& that
  * @param rec    the record to write
  */
 void NetLoggerFormatter::write(std::ostream *strm, LogRecord const& rec) {
-    string newl("\n");
-    bool wrote = false;
-    std::vector<std::string> comments;
+    dafBase::PropertySet::ConstPtr const& shared = rec.getSharedPreamble();
+    std::shared_ptr<PreambleCache::Texts const> pre;
+    if (shared) {
+        pre = _preambleCache.get(shared, 
+            [this](std::ostream *os, dafBase::PropertySet const& props, 
+                   string const& name) { writeProperty(os, props, name); });
+    }
 
-    std::vector<std::string> names = rec.data().paramNames(false);
+    bool wrote = false;
+    std::vector<std::string> names = rec.paramNames();
     for (auto const& vi : names) {
-        char tp = _tplookup[rec.data().typeOf(vi).name()];
-        if (vi == "DATE")
-            tp = 't';
-        else if (tp == 0) 
-            tp = '?';
-        
-
-        PropertyPrinter pp(rec.data(), vi);
-        for (PropertyPrinter::iterator pi=pp.begin(); pi.notAtEnd(); ++pi) {
-            (*strm) << tp << " " << vi << _midfix;
-            pi.write(strm) << newl;
-            if (!wrote) wrote = true;
+        dafBase::PropertySet const& props = rec.propertiesFor(vi);
+        string const *text = (&props == shared.get()) ? pre->find(vi) : 0;
+        if (text) {
+            (*strm) << *text;
+            if (! text->empty()) wrote = true;
+        }
+        else if (writeProperty(strm, props, vi)) {
+            wrote = true;
         }
     }
 
     if (wrote) (*strm) << std::endl;
 }
 
+/*
+ * write each value of a property on a line of its own, tagged with its 
+ * type.  Return false if there were no values to write.
+ */
+bool NetLoggerFormatter::writeProperty(std::ostream *strm, 
+                                       dafBase::PropertySet const& props,
+                                       string const& name)
+{
+    bool wrote = false;
+    char tp = _tplookup[props.typeOf(name).name()];
+    if (name == "DATE")
+        tp = 't';
+    else if (tp == 0) 
+        tp = '?';
+
+    if (props.typeOf(name) == typeid(string)) {
+        std::vector<string> values = props.getArray<string>(name);
+        for (auto const& value : values) {
+            (*strm) << tp << " " << name << _midfix;
+            writeEscaped(strm, value);
+            (*strm) << "\n";
+            wrote = true;
+        }
+        return wrote;
+    }
+
+    PropertyPrinter pp(props, name);
+    for (PropertyPrinter::iterator pi=pp.begin(); pi.notAtEnd(); ++pi) {
+        (*strm) << tp << " " << name << _midfix;
+        pi.write(strm) << "\n";
+        wrote = true;
+    }
+    return wrote;
+}
+
 ///////////////////////////////////////////////////////////
 //  PrependedFormatter
 ///////////////////////////////////////////////////////////
@@ -260,7 +407,7 @@ PrependedFormatter::~PrependedFormatter() {}
 void PrependedFormatter::write(std::ostream *strm, LogRecord const& rec) {
     string date;
     try {
-        date = rec.data().get<string>(LSST_LP_DATE) + ": ";
+        date = rec.propertiesFor(LSST_LP_DATE).get<string>(LSST_LP_DATE) + ": ";
     } catch (...) {
         date = "(failed to get timestamp): ";
     }
@@ -268,7 +415,7 @@ void PrependedFormatter::write(std::ostream *strm, LogRecord const& rec) {
     int level = 0;
     string levstr(": ");
     try {
-        level = rec.data().get<int>(LSST_LP_LEVEL);
+        level = rec.propertiesFor(LSST_LP_LEVEL).get<int>(LSST_LP_LEVEL);
         if (level >= Log::FATAL) levstr = " FATAL: ";
         else if (level >= Log::WARN) levstr = " WARNING: ";
         else if (level < Log::INFO) levstr = " DEBUG: ";
@@ -277,40 +424,33 @@ void PrependedFormatter::write(std::ostream *strm, LogRecord const& rec) {
 
     string log;
     try {
-        log = rec.data().get<string>(LSST_LP_LOG);
+        log = rec.propertiesFor(LSST_LP_LOG).get<string>(LSST_LP_LOG);
     } catch (pexExcept::TypeError const & ex) {
         log = "mis-specified_log_name";
     } catch (pexExcept::NotFoundError const & ex) {}
 
     std::vector<std::string> comments;
     try {
-        comments = rec.data().getArray<string>(LSST_LP_COMMENT);
+        comments = rec.propertiesFor(LSST_LP_COMMENT).getArray<string>(LSST_LP_COMMENT);
     } catch (pexExcept::TypeError const & ex) {
         comments.push_back("(mis-specified_comment)");
     } catch (pexExcept::NotFoundError const & ex) {}
 
     string label;
     try {
-        label = rec.data().get<string>(LSST_LP_LABEL);
+        label = rec.propertiesFor(LSST_LP_LABEL).get<string>(LSST_LP_LABEL);
     } catch (pexExcept::TypeError const & ex) {
         label = "mis-specified_label";
     } catch (pexExcept::NotFoundError const & ex) {}
 
     for (auto const& vi : comments) {
-        (*strm) << date << label << ": " << log << levstr << vi << std::endl;
+        (*strm) << date << label << ": " << log << levstr;
+        writeIndented(strm, vi, continuation);
+        (*strm) << std::endl;
     }
 
     if (isVerbose() || rec.willShowAll()) {
-        std::vector<std::string> names = rec.data().paramNames(false);
-        for (auto const& vi : names) {
-            if (vi == LSST_LP_COMMENT || vi == LSST_LP_LOG || vi == LSST_LP_LABEL) continue;
-
-            PropertyPrinter pp(rec.data(), vi);
-            for (PropertyPrinter::iterator pi=pp.begin(); pi.notAtEnd(); ++pi) {
-                (*strm) << "  " << vi << ": ";
-                pi.write(strm) << std::endl;
-            }
-        }
+        writeProperties(strm, rec, _preambleCache, true);
         (*strm) << std::endl;
     }
 }
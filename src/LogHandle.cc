@@ -0,0 +1,175 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LogHandle.cc
+ */
+#include "lsst/pex/logging/LogHandle.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+using std::string;
+using std::shared_ptr;
+using std::weak_ptr;
+using lsst::daf::base::PropertySet;
+
+namespace {
+
+/*
+ * an interned Log.  The Log is held weakly so that it (and the 
+ * destinations it refers to) goes away with the last handle.  For a 
+ * child Log, source is the parent preamble snapshot it was derived from.
+ */
+struct Interned {
+    weak_ptr<Log> log;
+    weak_ptr<const PropertySet> source;
+};
+
+typedef std::unordered_map<string, Interned> Registry;
+
+Registry& registry() {
+    static Registry reg;
+    return reg;
+}
+
+std::mutex& registryMutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+/*
+ * return the entry for a key, creating it if needed.  The entries of 
+ * names whose Logs have all gone away are swept out whenever the 
+ * registry has doubled in size since the last sweep, so that it stays 
+ * within a small multiple of the number of names in use.  The caller 
+ * must hold the registry mutex.
+ */
+Interned& lookup(const string& key) {
+    static std::size_t sweepAt = 64;
+    Registry& reg = registry();
+    if (reg.size() >= sweepAt) {
+        for(Registry::iterator it = reg.begin(); it != reg.end(); ) {
+            if (it->second.log.expired()) 
+                it = reg.erase(it);
+            else
+                ++it;
+        }
+        sweepAt = std::max<std::size_t>(64, 2 * reg.size());
+    }
+    return reg[key];
+}
+
+/*
+ * return true if two pointers refer to the same PropertySet instance.  
+ * Comparing ownership keeps this correct even after the instance has 
+ * been freed and its address reused.
+ */
+bool sameSnapshot(const weak_ptr<const PropertySet>& a, 
+                  const PropertySet::ConstPtr& b) 
+{
+    return ! a.owner_before(b) && ! b.owner_before(a);
+}
+
+/*
+ * the key buffer is kept per thread so that its capacity is reused and 
+ * looking up a name that has already been seen does not allocate.
+ */
+string& scratchKey() {
+    static thread_local string key;
+    return key;
+}
+
+} // end anonymous namespace
+
+LogHandle::LogHandle() : _log(_internCopy(Log::getDefaultLog())) { }
+
+LogHandle::LogHandle(const Log& log) : _log(_internCopy(log)) { }
+
+LogHandle::LogHandle(boost::string_view childName) 
+    : _log(_internChild(Log::getDefaultLog(), childName)) 
+{ }
+
+LogHandle::LogHandle(const Log& parent, boost::string_view childName) 
+    : _log(_internChild(parent, childName)) 
+{ }
+
+shared_ptr<Log> LogHandle::_internCopy(const Log& log) {
+    string& key = scratchKey();
+    key.assign(1, '=');
+    key += log._name;
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    Interned& entry = lookup(key);
+    shared_ptr<Log> out = entry.log.lock();
+    if (out && out->_threshold == log._threshold && 
+        out->_defShowAll == log._defShowAll && 
+        out->_myShowAll == log._myShowAll && 
+        out->_thresholds == log._thresholds && 
+        out->_destinations == log._destinations && 
+        out->_preamble == log._preamble) 
+    {
+        return out;
+    }
+
+    out.reset(new Log(log));
+    entry.log = out;
+    entry.source.reset();
+    return out;
+}
+
+shared_ptr<Log> LogHandle::_internChild(const Log& parent, 
+                                        boost::string_view childName) 
+{
+    string& key = scratchKey();
+    key.assign(1, '.');
+    key += parent._name;
+    if (parent._name.length() > 0) key += Log::_sep;
+    key.append(childName.data(), childName.size());
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    Interned& entry = lookup(key);
+    shared_ptr<Log> out = entry.log.lock();
+    if (out && sameSnapshot(entry.source, parent._preamble) && 
+        out->_defShowAll == parent._defShowAll && 
+        out->_thresholds == parent._thresholds && 
+        out->_destinations == parent._destinations) 
+    {
+        return out;
+    }
+
+    out.reset(new Log(parent, childName.to_string()));
+    entry.log = out;
+    entry.source = parent._preamble;
+    return out;
+}
+
+//@endcond
+}}} // end lsst::pex::logging
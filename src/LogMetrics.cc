@@ -0,0 +1,451 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LogMetrics.cc
+ */
+#include "lsst/pex/logging/LogMetrics.h"
+#include "lsst/pex/logging/Log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <iomanip>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+using std::string;
+using std::uint64_t;
+
+thread_local LogMetrics::Block *LogMetrics::_block = 0;
+std::atomic<bool> LogMetrics::_timing(false);
+std::atomic<bool> LogMetrics::_latency(false);
+
+namespace {
+    // the number of shards in each latency histogram
+    const int LATENCY_SHARDS = 8;
+
+    /*
+     * record the time since start in a histogram that is created the 
+     * first time it is needed.
+     */
+    void recordLatency(std::atomic<LatencyHistogram*>& hist, 
+                       std::chrono::steady_clock::time_point start) 
+    {
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start).count();
+        LatencyHistogram *h = hist.load(std::memory_order_acquire);
+        if (h == 0) {
+            LatencyHistogram *created = new LatencyHistogram(LATENCY_SHARDS);
+            if (hist.compare_exchange_strong(h, created, 
+                                             std::memory_order_acq_rel)) 
+                h = created;
+            else
+                delete created;
+        }
+        h->record(nanos);
+    }
+
+    LatencyHistogram copyLatency(const std::atomic<LatencyHistogram*>& hist) {
+        LatencyHistogram *h = hist.load(std::memory_order_acquire);
+        return (h == 0) ? LatencyHistogram() : LatencyHistogram(*h);
+    }
+}
+
+/*
+ * the state shared by all threads:  the per-thread counter blocks, the 
+ * destinations' counters and the reporting thread.  It is never deleted,
+ * so that threads can exit safely during static destruction.
+ */
+struct LogMetrics::Registry {
+    std::mutex mtx;
+    std::vector<Block*> blocks;     // every block, in use or not
+    std::vector<Block*> unused;     // blocks released by exited threads
+    Block orphan;                   // shared by threads exiting after release
+    std::vector<std::weak_ptr<Destination> > dests;
+    unsigned int nextId;
+
+    // the state of the last report, guarded by reportMtx
+    std::mutex reportMtx;
+    std::chrono::steady_clock::time_point last;
+    uint64_t counts[NCOUNTERS];
+    std::map<unsigned int, DestinationMetrics> lastDests;
+
+    // the send latency histogram, created when first needed
+    std::atomic<LatencyHistogram*> sendLatency;
+
+    // the reporting thread, guarded by mtx
+    std::thread reporter;
+    std::condition_variable wake;
+    int interval;
+    bool stopping;
+
+    Registry() 
+        : orphan(true), nextId(0), last(std::chrono::steady_clock::now()), 
+          sendLatency(0), interval(0), stopping(false)
+    { 
+        for(int i=0; i < NCOUNTERS; ++i) counts[i] = 0;
+    }
+
+    uint64_t sum(Counter which) {
+        uint64_t total = orphan.n[which].load(std::memory_order_relaxed);
+        for(std::size_t i=0; i < blocks.size(); ++i) 
+            total += blocks[i]->n[which].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void run();
+
+    /*
+     * returns a thread's block to the registry when the thread exits.  
+     * The counts stay in the block, which is handed to the next new 
+     * thread.
+     */
+    struct Releaser {
+        Block *block;
+        Releaser() : block(0) { }
+        ~Releaser();
+    };
+
+    /*
+     * stops the reporting thread at exit
+     */
+    struct Stopper {
+        ~Stopper() { LogMetrics::stopReporting(); }
+    };
+};
+
+LogMetrics::Registry& LogMetrics::_registry() {
+    static Registry *reg = new Registry();
+    return *reg;
+}
+
+LogMetrics::Registry::Releaser::~Releaser() {
+    if (block == 0) return;
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    r.unused.push_back(block);
+    LogMetrics::_block = &r.orphan;
+}
+
+LogMetrics::Block::Block(bool isShared) : shared(isShared) {
+    for(int i=0; i < NCOUNTERS; ++i) n[i].store(0);
+}
+
+/*
+ * give the calling thread a counter block
+ */
+LogMetrics::Block *LogMetrics::_newBlock() {
+    static thread_local Registry::Releaser releaser;
+    Registry& r = _registry();
+    Block *b;
+    {
+        std::lock_guard<std::mutex> lock(r.mtx);
+        if (r.unused.empty()) {
+            b = new Block();
+            r.blocks.push_back(b);
+        }
+        else {
+            b = r.unused.back();
+            r.unused.pop_back();
+        }
+    }
+    releaser.block = b;
+    _block = b;
+    return b;
+}
+
+/*
+ * return the number of events of a given kind counted so far
+ */
+uint64_t LogMetrics::get(Counter which) {
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    return r.sum(which);
+}
+
+/*
+ * return the fraction of threshold checks that did not need a lookup
+ */
+double LogMetrics::getThresholdHitRate() {
+    uint64_t hits, lookups;
+    {
+        Registry& r = _registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        hits = r.sum(SKIPPED) + r.sum(LOCAL);
+        lookups = r.sum(LOOKUPS);
+    }
+    return (hits + lookups == 0) ? 1.0 
+                                 : double(hits) / double(hits + lookups);
+}
+
+LogMetrics::Destination::Destination(unsigned int id) 
+    : records(0), bytes(0), formatNanos(0), writeNanos(0), queued(0), 
+      maxQueued(0), dropped(0), id(id), _writeLatency(0), _label()
+{ }
+
+LogMetrics::Destination::~Destination() {
+    delete _writeLatency.load();
+}
+
+void LogMetrics::Destination::recordWrite(
+                                   std::chrono::steady_clock::time_point start)
+{
+    recordLatency(_writeLatency, start);
+}
+
+LatencyHistogram LogMetrics::Destination::writeLatency() const {
+    return copyLatency(_writeLatency);
+}
+
+void LogMetrics::Destination::setLabel(const string& label) {
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    _label = label;
+}
+
+DestinationMetrics LogMetrics::Destination::snapshot() const {
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    return _snapshot();
+}
+
+DestinationMetrics LogMetrics::Destination::_snapshot() const {
+    DestinationMetrics out;
+    out.id = id;
+    out.label = _label;
+    out.records = records.load(std::memory_order_relaxed);
+    out.bytes = bytes.load(std::memory_order_relaxed);
+    out.formatNanos = formatNanos.load(std::memory_order_relaxed);
+    out.writeNanos = writeNanos.load(std::memory_order_relaxed);
+    out.queued = queued.load(std::memory_order_relaxed);
+    out.maxQueued = maxQueued.load(std::memory_order_relaxed);
+    out.dropped = dropped.load(std::memory_order_relaxed);
+    return out;
+}
+
+/*
+ * create and register the counters for a new destination
+ */
+std::shared_ptr<LogMetrics::Destination> LogMetrics::_newDestination() {
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    std::shared_ptr<Destination> dest(new Destination(++r.nextId));
+    r.dests.push_back(dest);
+    return dest;
+}
+
+/*
+ * return snapshots of the counters of all existing destinations
+ */
+std::vector<DestinationMetrics> LogMetrics::getDestinationMetrics() {
+    std::vector<DestinationMetrics> out;
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    std::vector<std::weak_ptr<Destination> >::iterator it = r.dests.begin();
+    while (it != r.dests.end()) {
+        std::shared_ptr<Destination> dest = it->lock();
+        if (dest.get() == 0) {
+            it = r.dests.erase(it);
+            continue;
+        }
+        out.push_back(dest->_snapshot());
+        ++it;
+    }
+    return out;
+}
+
+/*
+ * record the time taken to send a record
+ */
+void LogMetrics::recordSendLatency(std::chrono::steady_clock::time_point start)
+{
+    recordLatency(_registry().sendLatency, start);
+}
+
+/*
+ * return a copy of the send latency histogram
+ */
+LatencyHistogram LogMetrics::getSendLatency() {
+    return copyLatency(_registry().sendLatency);
+}
+
+/*
+ * return a copy of a destination's write latency histogram
+ */
+LatencyHistogram LogMetrics::getWriteLatency(unsigned int id) {
+    std::shared_ptr<Destination> dest;
+    {
+        Registry& r = _registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for(std::size_t i=0; i < r.dests.size(); ++i) {
+            std::shared_ptr<Destination> d = r.dests[i].lock();
+            if (d.get() != 0 && d->id == id) {
+                dest = d;
+                break;
+            }
+        }
+    }
+    return (dest.get() == 0) ? LatencyHistogram() : dest->writeLatency();
+}
+
+/*
+ * log a report of the metrics to the "logging.stats" Log now.  Latency 
+ * percentiles cover all the time since recording began.
+ */
+void LogMetrics::report() {
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> reportLock(r.reportMtx);
+
+    std::chrono::steady_clock::time_point now = 
+        std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - r.last).count();
+    if (secs <= 0) secs = 1;
+    r.last = now;
+
+    uint64_t counts[NCOUNTERS];
+    {
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for(int i=0; i < NCOUNTERS; ++i) 
+            counts[i] = r.sum(static_cast<Counter>(i));
+    }
+    uint64_t delta[NCOUNTERS];
+    for(int i=0; i < NCOUNTERS; ++i) {
+        delta[i] = counts[i] - r.counts[i];
+        r.counts[i] = counts[i];
+    }
+    uint64_t checks = delta[SKIPPED] + delta[LOCAL] + delta[LOOKUPS];
+    double hitRate = (checks == 0) ? 1.0 
+                         : double(delta[SKIPPED] + delta[LOCAL]) / checks;
+
+    Log log(Log::getDefaultLog(), "logging.stats");
+    std::ostringstream msg;
+    msg << std::fixed << std::setprecision(1) 
+        << "sent " << delta[SENT]/secs << " records/s; " 
+        << checks/secs << " threshold checks/s, " 
+        << 100*hitRate << "% without lookup";
+    if (isRecordingLatency()) {
+        msg << "; send latency: ";
+        getSendLatency().write(msg);
+    }
+    LogRec(log, Log::INFO) << msg.str() 
+                           << Prop<double>("RECORDS_PER_SEC", delta[SENT]/secs)
+                           << Prop<double>("CHECKS_PER_SEC", checks/secs)
+                           << Prop<double>("HIT_RATE", hitRate)
+                           << LogRec::endr;
+
+    std::vector<DestinationMetrics> dests = getDestinationMetrics();
+    std::map<unsigned int, DestinationMetrics> current;
+    for(std::size_t i=0; i < dests.size(); ++i) {
+        const DestinationMetrics& d = dests[i];
+        current[d.id] = d;
+        DestinationMetrics prev = DestinationMetrics();
+        std::map<unsigned int, DestinationMetrics>::iterator p = 
+            r.lastDests.find(d.id);
+        if (p != r.lastDests.end()) prev = p->second;
+
+        uint64_t records = d.records - prev.records;
+        uint64_t dropped = d.dropped - prev.dropped;
+        msg.str("");
+        msg << "destination " << d.id;
+        if (d.label.length() > 0) msg << " (" << d.label << ")";
+        msg << ": " << records/secs << " records/s";
+        if (isTiming()) {
+            double perRecord = (records == 0) ? 0.0 : 0.001 / records;
+            msg << ", " << (d.bytes - prev.bytes)/secs << " bytes/s"
+                << ", format " 
+                << (d.formatNanos - prev.formatNanos)*perRecord 
+                << " usec/record, write "
+                << (d.writeNanos - prev.writeNanos)*perRecord 
+                << " usec/record";
+        }
+        msg << ", " << d.queued << " queued, " << dropped << " dropped";
+        if (isRecordingLatency()) {
+            msg << "; write latency: ";
+            getWriteLatency(d.id).write(msg);
+        }
+        LogRec(log, Log::INFO) << msg.str() 
+                               << Prop<int>("DESTINATION", int(d.id))
+                               << Prop<double>("RECORDS_PER_SEC", records/secs)
+                               << Prop<double>("BYTES_PER_SEC", 
+                                               (d.bytes - prev.bytes)/secs)
+                               << Prop<int>("QUEUED", int(d.queued))
+                               << Prop<int>("DROPPED", int(dropped))
+                               << LogRec::endr;
+    }
+    r.lastDests.swap(current);
+}
+
+void LogMetrics::Registry::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (! stopping) {
+        std::chrono::steady_clock::time_point due = 
+            std::chrono::steady_clock::now() + std::chrono::seconds(interval);
+        if (wake.wait_until(lock, due, [this]{ return stopping; })) break;
+        lock.unlock();
+        try {
+            LogMetrics::report();
+        }
+        catch (...) { }
+        lock.lock();
+    }
+}
+
+/*
+ * start periodically logging the metrics
+ */
+void LogMetrics::startReporting(int seconds) {
+    static Registry::Stopper stopper;
+    if (seconds <= 0) seconds = 1;
+    Registry& r = _registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    r.interval = seconds;
+    if (! r.reporter.joinable()) {
+        r.stopping = false;
+        r.reporter = std::thread(&Registry::run, &r);
+    }
+    r.wake.notify_all();
+}
+
+/*
+ * stop logging reports of the metrics
+ */
+void LogMetrics::stopReporting() {
+    Registry& r = _registry();
+    std::thread reporter;
+    {
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.stopping = true;
+        reporter.swap(r.reporter);
+    }
+    r.wake.notify_all();
+    if (reporter.joinable()) reporter.join();
+}
+
+//@endcond
+}}} // end lsst::pex::logging
@@ -0,0 +1,735 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file LogReader.cc
+ * @brief implementation of the LogReader class
+ */
+#include "lsst/pex/logging/LogReader.h"
+#include "lsst/pex/exceptions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+namespace pexExcept = lsst::pex::exceptions;
+using std::string;
+using boost::string_view;
+
+namespace {
+
+    const char *lineEnd(const char *p, const char *end) {
+        const char *e = static_cast<const char*>(std::memchr(p, '\n', end-p));
+        return (e) ? e : end;
+    }
+
+    const char *nextLine(const char *p, const char *end) {
+        const char *e = lineEnd(p, end);
+        return (e < end) ? e+1 : end;
+    }
+
+    /*
+     * return the first occurrence of delim in [p, end), or null
+     */
+    const char *findDelim(const char *p, const char *end, 
+                          const string& delim) 
+    {
+        const std::size_t len = delim.size();
+        while (p + len <= end) {
+            p = static_cast<const char*>(std::memchr(p, delim[0], end-p));
+            if (! p || p + len > end) return 0;
+            if (std::memcmp(p, delim.data(), len) == 0) return p;
+            ++p;
+        }
+        return 0;
+    }
+
+    bool startsWith(const char *p, const char *end, const char *prefix) {
+        std::size_t len = std::strlen(prefix);
+        return std::size_t(end - p) >= len && std::memcmp(p, prefix, len) == 0;
+    }
+
+    const string colonSpace(": ");
+    const char continuation[] = "    ";
+
+    /*
+     * a Prepended formatter line that starts a record, split into parts
+     */
+    struct Header {
+        string_view date, label, log, comment;
+        const char *level;         // the LEVEL as text
+        std::size_t prefix;        // the length of the text before comment
+    };
+
+    /*
+     * split the line [b, e) into the parts of a record.  Return false if
+     * it does not have the expected form.
+     */
+    bool splitHeader(const char *b, const char *e, Header& h) {
+        const char *d = findDelim(b, e, colonSpace);
+        if (! d) return false;
+        h.date = string_view(b, d-b);
+
+        // a label in braces may itself contain ": "
+        const char *q = d + 2, *r = 0;
+        if (q < e && *q == '{') {
+            int depth = 0;
+            char quote = '\0';
+            for (const char *s = q; s < e; ++s) {
+                if (quote) { 
+                    if (*s == quote) quote = '\0'; 
+                }
+                else if (*s == '\'' || *s == '"') quote = *s;
+                else if (*s == '{') ++depth;
+                else if (*s == '}' && --depth == 0) {
+                    if (startsWith(s+1, e, ": ")) r = s+1;
+                    break;
+                }
+            }
+        }
+        if (! r) r = findDelim(q, e, colonSpace);
+        if (! r) return false;
+        h.label = string_view(q, r-q);
+
+        // the log name ends with ": " or with the space before a level tag
+        q = r + 2;
+        h.level = "0";
+        for (const char *s = q; s < e; ++s) {
+            if (*s == ':' && startsWith(s, e, ": ")) {
+                h.log = string_view(q, s-q);
+                h.comment = string_view(s+2, e-s-2);
+                h.prefix = s + 2 - b;
+                return true;
+            }
+            if (*s == ' ') {
+                static const struct { const char *tag, *level; } tags[] = {
+                    { " FATAL: ", "20" }, { " WARNING: ", "10" }, 
+                    { " DEBUG: ", "-10" }
+                };
+                for (auto const& t : tags) {
+                    if (startsWith(s, e, t.tag)) {
+                        const char *c = s + std::strlen(t.tag);
+                        h.log = string_view(q, s-q);
+                        h.level = t.level;
+                        h.comment = string_view(c, e-c);
+                        h.prefix = c - b;
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /*
+     * return true if the line at p starts a Prepended formatter record
+     */
+    bool isHeaderLine(const char *p, const char *end) {
+        return p < end && *p != ' ' && *p != '\n';
+    }
+
+    /*
+     * return the end of the text that starts on the line ending at e and 
+     * continues on the indented lines that follow it
+     */
+    const char *continued(const char *e, const char *end) {
+        while (e < end && startsWith(e+1, end, continuation)) 
+            e = lineEnd(e+1, end);
+        return e;
+    }
+
+    /*
+     * parse an integer, returning false if text is not one
+     */
+    bool parseInteger(string_view text, std::int64_t& out) {
+        const char *p = text.data(), *e = p + text.size();
+        bool neg = false;
+        if (p < e && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+        if (p == e) return false;
+        std::uint64_t v = 0;
+        for (; p < e; ++p) {
+            unsigned d = static_cast<unsigned char>(*p) - '0';
+            if (d > 9) return false;
+            v = v * 10 + d;
+        }
+        out = (neg) ? -static_cast<std::int64_t>(v) 
+                    : static_cast<std::int64_t>(v);
+        return true;
+    }
+
+    bool isInteger(char type) { 
+        return type == 'i' || type == 'l' || type == 'L'; 
+    }
+
+    LogReader::Column::Type columnType(char type) {
+        if (isInteger(type)) return LogReader::Column::INTEGER;
+        if (type == 'f' || type == 'd') return LogReader::Column::FLOAT;
+        if (type == 'b') return LogReader::Column::BOOL;
+        return LogReader::Column::STRING;
+    }
+
+    /*
+     * return the type that can hold values of both types
+     */
+    LogReader::Column::Type joinTypes(LogReader::Column::Type a, 
+                                      LogReader::Column::Type b) 
+    {
+        typedef LogReader::Column C;
+        if (a == b) return a;
+        if (a == C::STRING || b == C::STRING) return C::STRING;
+        if (a == C::FLOAT || b == C::FLOAT) 
+            return (a == C::BOOL || b == C::BOOL) ? C::STRING : C::FLOAT;
+        return C::INTEGER;
+    }
+
+    const double gapFloat = std::numeric_limits<double>::quiet_NaN();
+}
+
+///////////////////////////////////////////////////////////
+//  Field
+///////////////////////////////////////////////////////////
+
+std::int64_t LogReader::Field::asInteger() const {
+    std::int64_t out = 0;
+    if (_type == 'b') {
+        if (_text == "true") return 1;
+        if (_text == "false") return 0;
+    }
+    if ((isInteger(_type) || _type == 'b') && parseInteger(_text, out))
+        return out;
+    throw LSST_EXCEPT(pexExcept::TypeError, 
+                      _name.to_string() + ": not an integer: " + 
+                      _text.to_string());
+}
+
+double LogReader::Field::asFloat() const {
+    if (isInteger(_type)) return static_cast<double>(asInteger());
+    if (_type == 'f' || _type == 'd') {
+        /* strtod() needs a terminated string */
+        char buf[64];
+        string big;
+        const char *s = buf;
+        if (_text.size() < sizeof(buf)) {
+            std::memcpy(buf, _text.data(), _text.size());
+            buf[_text.size()] = '\0';
+        }
+        else {
+            big = _text.to_string();
+            s = big.c_str();
+        }
+        char *e = 0;
+        double out = std::strtod(s, &e);
+        if (e != s && *e == '\0') return out;
+    }
+    throw LSST_EXCEPT(pexExcept::TypeError, 
+                      _name.to_string() + ": not a number: " + 
+                      _text.to_string());
+}
+
+std::string LogReader::Field::asString() const {
+    string out;
+    out.reserve(_text.size());
+    const char *p = _text.data(), *e = p + _text.size();
+    if (_escaped) {
+        while (p < e) {
+            const char *b = static_cast<const char*>(std::memchr(p, '\\', e-p));
+            if (! b) b = e;
+            out.append(p, b);
+            if (b == e) break;
+            p = b + 1;
+            if (p < e && *p == 'n')       { out += '\n'; ++p; }
+            else if (p < e && *p == 'r')  { out += '\r'; ++p; }
+            else if (p < e && *p == '\\') { out += '\\'; ++p; }
+            else if (p + 2 < e && *p == 'x' && std::isxdigit(p[1]) && 
+                     std::isxdigit(p[2])) 
+            {
+                out += static_cast<char>(std::strtol(string(p+1, 2).c_str(), 
+                                                     0, 16));
+                p += 3;
+            }
+            else 
+                out += '\\';
+        }
+    }
+    else {
+        /* drop the indentation of continuation lines */
+        while (p < e) {
+            const char *n = static_cast<const char*>(std::memchr(p, '\n', e-p));
+            if (! n) n = e;
+            out.append(p, n);
+            if (n == e) break;
+            out += '\n';
+            p = n + 1;
+            if (startsWith(p, e, continuation)) p += sizeof(continuation)-1;
+        }
+    }
+    return out;
+}
+
+///////////////////////////////////////////////////////////
+//  Record
+///////////////////////////////////////////////////////////
+
+const LogReader::Field *LogReader::Record::find(string_view name) const {
+    for (auto it = _fields.rbegin(); it != _fields.rend(); ++it) 
+        if (it->getName() == name) return &*it;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////
+//  iterator
+///////////////////////////////////////////////////////////
+
+LogReader::iterator::iterator(const LogReader *reader, const char *begin, 
+                              const char *end)
+    : _reader(reader), _next(begin), _end(end), _rec()
+{
+    ++(*this);
+}
+
+LogReader::iterator& LogReader::iterator::operator++() {
+    while (_reader && _next < _end) {
+        _next = _reader->_parse(_next, _end, _rec);
+        if (_rec.size() > 0) return *this;
+    }
+    _reader = 0;
+    return *this;
+}
+
+///////////////////////////////////////////////////////////
+//  Column
+///////////////////////////////////////////////////////////
+
+void LogReader::Column::pad(std::size_t rows) {
+    if (rows <= _present.size()) return;
+    _present.resize(rows, 0);
+    switch (_type) {
+    case FLOAT:   _floats.resize(rows, gapFloat); break;
+    case STRING:  _strings.resize(rows);          break;
+    default:      _integers.resize(rows, 0);
+    }
+}
+
+void LogReader::Column::set(std::size_t row, const Field& field) {
+    _promote(joinTypes((_typed) ? _type : columnType(field.getType()), 
+                       columnType(field.getType())));
+    pad(row+1);
+    switch (_type) {
+    case FLOAT:
+        _floats[row] = field.asFloat();
+        break;
+    case STRING:
+        if (_present[row]) 
+            _strings[row] += '\n' + field.asString();
+        else 
+            _strings[row] = field.asString();
+        break;
+    default:
+        _integers[row] = field.asInteger();
+    }
+    _present[row] = 1;
+}
+
+void LogReader::Column::append(const Column& that) {
+    if (! that._typed) {
+        pad(size() + that.size());
+        return;
+    }
+    _promote((_typed) ? joinTypes(_type, that._type) : that._type);
+
+    const Column *src = &that;
+    Column promoted;
+    if (that._type != _type) {
+        promoted = that;
+        promoted._promote(_type);
+        src = &promoted;
+    }
+    switch (_type) {
+    case FLOAT:  
+        _floats.insert(_floats.end(), src->_floats.begin(), 
+                       src->_floats.end()); 
+        break;
+    case STRING: 
+        _strings.insert(_strings.end(), src->_strings.begin(), 
+                        src->_strings.end()); 
+        break;
+    default:     
+        _integers.insert(_integers.end(), src->_integers.begin(), 
+                         src->_integers.end()); 
+    }
+    _present.insert(_present.end(), src->_present.begin(), 
+                    src->_present.end());
+}
+
+/*
+ * convert the values to a given type
+ */
+void LogReader::Column::_promote(Type type) {
+    if (_typed && type == _type) return;
+    std::size_t n = size();
+    if (! _typed) {
+        /* only gaps so far */
+        _integers.clear();
+        _type = type;
+        _typed = true;
+        _present.clear();
+        pad(n);
+        return;
+    }
+
+    if (type == FLOAT) {
+        _floats.resize(n, gapFloat);
+        for (std::size_t i = 0; i < n; ++i) 
+            if (_present[i]) _floats[i] = static_cast<double>(_integers[i]);
+    }
+    else if (type == STRING) {
+        _strings.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (! _present[i]) continue;
+            if (_type == BOOL) 
+                _strings[i] = (_integers[i]) ? "true" : "false";
+            else if (_type == INTEGER) 
+                _strings[i] = std::to_string(_integers[i]);
+            else {
+                /* as the formatter wrote it */
+                std::ostringstream os;
+                os << _floats[i];
+                _strings[i] = os.str();
+            }
+        }
+        _floats.clear();
+    }
+    if (type != INTEGER) _integers.clear();
+    _type = type;
+}
+
+///////////////////////////////////////////////////////////
+//  LogReader
+///////////////////////////////////////////////////////////
+
+LogReader::LogReader(const string& path, Format format, 
+                     const string& valueDelim)
+    : _format(format), _delim(valueDelim), _data(0), _size(0)
+{
+    if (_delim.empty()) 
+        throw LSST_EXCEPT(pexExcept::InvalidParameterError, 
+                          "empty value delimiter");
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) 
+        throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                          "unable to open log file for reading: " + path + 
+                          ": " + std::strerror(errno));
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                          "unable to read log file size: " + path + ": " + 
+                          std::strerror(err));
+    }
+
+    _size = st.st_size;
+    if (_size > 0) {
+        void *addr = ::mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                              "unable to map log file: " + path + ": " + 
+                              std::strerror(err));
+        }
+        ::madvise(addr, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(addr);
+    }
+    ::close(fd);
+}
+
+LogReader::~LogReader() {
+    if (_data) ::munmap(const_cast<char*>(_data), _size);
+}
+
+/*
+ * parse the record starting at or after p into rec, returning the 
+ * position after it.  rec is left empty if there are no more records.
+ */
+const char *LogReader::_parse(const char *p, const char *end, 
+                              Record& rec) const 
+{
+    rec._fields.clear();
+    if (_format == PREPENDED) 
+        return _parsePrepended(p, end, rec);
+    return _parseNetLogger(p, end, rec);
+}
+
+const char *LogReader::_parseNetLogger(const char *p, const char *end, 
+                                       Record& rec) const 
+{
+    while (p < end && *p == '\n') ++p;
+    rec._offset = p - _data;
+
+    while (p < end) {
+        const char *e = lineEnd(p, end);
+        if (e == p) return e+1;     // a blank line ends the record
+
+        /* a line reads "t name: value" */
+        const char *d = 0;
+        if (e - p > 2 && p[1] == ' ' && p[0] != ' ') 
+            d = findDelim(p+2, e, _delim);
+        if (d) {
+            const char *v = d + _delim.size();
+            rec._fields.emplace_back(string_view(p+2, d-p-2), *p, 
+                                     string_view(v, e-v), 
+                                     *p == 's' || *p == 't');
+        }
+        else if (! rec._fields.empty()) {
+            /* an unescaped line break (from an older formatter) */
+            Field& f = rec._fields.back();
+            f._text = string_view(f._text.data(), e - f._text.data());
+        }
+        p = (e < end) ? e+1 : end;
+    }
+    return p;
+}
+
+const char *LogReader::_parsePrepended(const char *p, const char *end, 
+                                       Record& rec) const 
+{
+    static const char *names[] = { "DATE", "LABEL", "LOG", "LEVEL" };
+
+    /* skip anything not attached to a record */
+    while (p < end && ! isHeaderLine(p, end)) p = nextLine(p, end);
+    if (p == end) return p;
+    rec._offset = p - _data;
+
+    const char *first = p;
+    Header h;
+    const char *e = lineEnd(p, end);
+    std::size_t nheader = 0;
+    if (splitHeader(p, e, h)) {
+        rec._fields.emplace_back(names[0], 's', h.date, false);
+        rec._fields.emplace_back(names[1], 's', h.label, false);
+        rec._fields.emplace_back(names[2], 's', h.log, false);
+        rec._fields.emplace_back(names[3], 'i', string_view(h.level), false);
+        nheader = rec._fields.size();
+    }
+    else {
+        h.comment = string_view(p, e-p);
+        h.prefix = 0;
+    }
+
+    /* the comments, each with its continuation lines */
+    while (true) {
+        e = continued(e, end);
+        const char *c = h.comment.data();
+        rec._fields.emplace_back("COMMENT", 's', string_view(c, e-c), false);
+        p = (e < end) ? e+1 : end;
+
+        /* further comments repeat the start of the first line */
+        if (! nheader || ! isHeaderLine(p, end)) break;
+        e = lineEnd(p, end);
+        Header more;
+        if (! splitHeader(p, e, more) || more.prefix != h.prefix || 
+            std::memcmp(p, first, h.prefix) != 0)
+            return p;
+        h = more;
+    }
+
+    /* properties written in verbose mode, up to a blank line */
+    while (p < end && ! isHeaderLine(p, end)) {
+        e = lineEnd(p, end);
+        if (e == p) return e+1;
+        const char *d = findDelim(p, e, colonSpace);
+        if (e - p > 2 && p[1] == ' ' && p[2] != ' ' && d) {
+            string_view name(p+2, d-p-2);
+            char type = 's';
+            if (name == "LEVEL") 
+                type = 'i';
+            else if (name == "TIMESTAMP" || name == "MONOTONIC") 
+                type = 'L';
+            e = continued(e, end);
+            Field f(name, type, string_view(d+2, e-d-2), false);
+            std::size_t i = 0;
+            while (i < nheader && rec._fields[i].getName() != name) ++i;
+            if (i < nheader) 
+                rec._fields[i] = f;
+            else 
+                rec._fields.push_back(f);
+        }
+        p = (e < end) ? e+1 : end;
+    }
+    return p;
+}
+
+/*
+ * return the start of the first record that starts at or after p
+ */
+const char *LogReader::_nextRecord(const char *p, const char *end) const {
+    if (p <= _data) return _data;
+
+    if (_format == NETLOGGER) {
+        /* just after a blank line */
+        for (const char *s = std::max(p-2, _data); s + 1 < end; ++s) {
+            s = static_cast<const char*>(std::memchr(s, '\n', end-s));
+            if (! s) break;
+            if (s + 1 < end && s[1] == '\n') return s+2;
+        }
+        return end;
+    }
+
+    /* at a line that is not indented and does not continue a record */
+    if (p[-1] != '\n') p = nextLine(p, end);
+    for (; p < end; p = nextLine(p, end)) {
+        if (! isHeaderLine(p, end)) continue;
+        /* skip back over the previous line's continuation lines */
+        const char *prevEnd = p - 1, *prev;
+        while (true) {
+            prev = prevEnd;
+            while (prev > _data && prev[-1] != '\n') --prev;
+            if (prev == _data || ! startsWith(prev, prevEnd, continuation)) 
+                break;
+            prevEnd = prev - 1;
+        }
+
+        /* a line repeating the start of the one before adds a comment */
+        Header h, ph;
+        if (! isHeaderLine(prev, prevEnd) || 
+            ! splitHeader(p, lineEnd(p, end), h) ||
+            ! splitHeader(prev, prevEnd, ph) || h.prefix != ph.prefix || 
+            std::memcmp(p, prev, h.prefix) != 0)
+            return p;
+    }
+    return end;
+}
+
+/*
+ * read the records in [begin, end) into columns, returning the number 
+ * of records read
+ */
+std::size_t LogReader::_readColumns(const char *begin, const char *end, 
+                                    Columns& columns) const 
+{
+    /* names usually come in the same order, so remember where each was */
+    std::vector<std::pair<string_view, Column*> > seen;
+    Record rec;
+    std::size_t rows = 0;
+    for (const char *p = begin; p < end; ) {
+        p = _parse(p, end, rec);
+        if (rec.size() == 0) continue;
+
+        std::size_t hint = 0;
+        for (auto const& field : rec) {
+            std::size_t i = hint;
+            while (i < seen.size() && seen[i].first != field.getName()) ++i;
+            if (i == seen.size()) {
+                i = 0;
+                while (i < hint && seen[i].first != field.getName()) ++i;
+                if (i == hint) {
+                    Column *col = &columns[field.getName().to_string()];
+                    i = seen.size();
+                    seen.emplace_back(field.getName(), col);
+                }
+            }
+            seen[i].second->set(rows, field);
+            hint = i + 1;
+        }
+        ++rows;
+    }
+    for (auto& col : columns) col.second.pad(rows);
+    return rows;
+}
+
+LogReader::Columns LogReader::readColumns(int nthreads) const {
+    if (nthreads <= 0) {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+        nthreads = std::min<std::size_t>(nthreads, 
+                                         std::max<std::size_t>(1, _size >> 20));
+    }
+
+    /* divide the file at record boundaries */
+    const char *end = _data + _size;
+    std::vector<const char*> bounds(1, _data);
+    for (int i = 1; i < nthreads; ++i) {
+        const char *b = _nextRecord(_data + _size * i / nthreads, end);
+        if (b > bounds.back() && b < end) bounds.push_back(b);
+    }
+    bounds.push_back(end);
+
+    std::size_t nparts = bounds.size() - 1;
+    std::vector<Columns> parts(nparts);
+    std::vector<std::size_t> rows(nparts, 0);
+    std::vector<std::exception_ptr> errors(nparts);
+    auto work = [&](std::size_t i) {
+        try {
+            rows[i] = _readColumns(bounds[i], bounds[i+1], parts[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < nparts; ++i) threads.emplace_back(work, i);
+    if (nparts > 0) work(0);
+    for (auto& t : threads) t.join();
+    for (auto const& err : errors) 
+        if (err) std::rethrow_exception(err);
+
+    /* join the parts in order */
+    Columns out;
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < nparts; ++i) {
+        for (auto& col : parts[i]) {
+            Column& dest = out[col.first];
+            if (offset == 0 && dest.size() == 0) {
+                dest = std::move(col.second);
+            }
+            else {
+                dest.pad(offset);
+                dest.append(col.second);
+            }
+        }
+        offset += rows[i];
+        parts[i].clear();
+    }
+    for (auto& col : out) col.second.pad(offset);
+    return out;
+}
+
+//@endcond
+}}} // end lsst::pex::logging
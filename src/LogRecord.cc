@@ -28,8 +28,12 @@
 #include "lsst/pex/exceptions.h"
 #include "lsst/daf/base/DateTime.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 #include <time.h>
 
 namespace lsst {
@@ -43,6 +47,35 @@ using lsst::daf::base::DateTime;
 using lsst::daf::base::PropertySet;
 namespace pexExcept = lsst::pex::exceptions;
 
+const std::size_t LogRecord::MAX_POOLED = 16;
+
+namespace {
+
+    /*
+     * the emptied PropertySets a thread holds for reuse.  Records are 
+     * usually deleted in the thread that created them, so no locking is
+     * needed; one released in another thread simply joins that thread's 
+     * pool.
+     */
+    struct DataPool {
+        std::vector<PropertySet::Ptr> sets;
+
+        DataPool() { sets.reserve(LogRecord::MAX_POOLED); }
+        ~DataPool() { closed = true; }
+
+        // set once the calling thread's pool has been destroyed, so that
+        // records deleted later during thread exit do not touch it.
+        static thread_local bool closed;
+    };
+    thread_local bool DataPool::closed = false;
+
+    DataPool *dataPool() {
+        if (DataPool::closed) return 0;
+        static thread_local DataPool pool;
+        return &pool;
+    }
+}
+
 
 /*
  * Create a log record to be sent to a given log.  
@@ -52,7 +85,9 @@ namespace pexExcept = lsst::pex::exceptions;
  */
 LogRecord::LogRecord(int threshold, int importance, bool showAll)
     : _send(threshold <= importance), _showAll(showAll), _vol(importance), 
-      _data(new PropertySet())
+      _nsecs(0), _monoNsecs(0), _monoStamp(false),
+      _lazyDate(false), _dates(), _preamble(), 
+      _data(_acquireData())
 { 
     _init();
 }
@@ -72,68 +107,322 @@ LogRecord::LogRecord(int threshold, int importance, bool showAll)
 LogRecord::LogRecord(int threshold, int importance, const PropertySet& preamble,
                      bool showAll) 
     : _send(threshold <= importance), _showAll(showAll), _vol(importance),
-      _data()
+      _nsecs(0), _monoNsecs(0), _monoStamp(false),
+      _lazyDate(false), _dates(), _preamble(), _data()
 {
     if (_send) {
         _data = preamble.deepCopy();
     }
     else {
-        _data = std::shared_ptr<PropertySet>(new PropertySet());
+        _data = _acquireData();
     }
     _init();
 }
 
+/*
+ * Create a log record that shares an immutable preamble.  
+ * @param threshold  the importance threshold that determines if a message
+ *                     is printed.
+ * @param importance  the loudness of the record.  
+ * @param preamble   the shared preamble snapshot
+ */
+LogRecord::LogRecord(int threshold, int importance, 
+                     const PropertySet::ConstPtr& preamble, bool showAll) 
+    : _send(threshold <= importance), _showAll(showAll), _vol(importance),
+      _nsecs(0), _monoNsecs(0), _monoStamp(false),
+      _lazyDate(false), _dates(), _preamble(), 
+      _data(_acquireData())
+{
+    if (_send) _preamble = preamble;
+    _init();
+}
+
 /*
  * delete this log record
  */
-LogRecord::~LogRecord() { }
+LogRecord::~LogRecord() { 
+    _releaseData(_merged);
+    _releaseData(_dates);
+    _releaseData(_data);
+}
+
+PropertySet::Ptr LogRecord::_acquireData() {
+    DataPool *pool = dataPool();
+    if (! pool || pool->sets.empty()) 
+        return PropertySet::Ptr(new PropertySet());
+
+    PropertySet::Ptr out;
+    out.swap(pool->sets.back());
+    pool->sets.pop_back();
+    return out;
+}
+
+void LogRecord::_releaseData(PropertySet::Ptr& data) {
+    PropertySet::Ptr released;
+    released.swap(data);
+    if (! released || released.use_count() > 1) return;
+
+    DataPool *pool = dataPool();
+    if (! pool || pool->sets.size() >= MAX_POOLED) return;
+
+    // removing each top-level name also removes any hierarchy under it, 
+    // which removing the full names would leave behind as empty nodes
+    std::vector<std::string> names = released->names(true);
+    for(std::vector<std::string>::iterator it = names.begin(); 
+        it != names.end(); ++it) 
+    {
+        released->remove(*it);
+    }
+    pool->sets.push_back(released);
+}
+
+std::size_t LogRecord::getPoolSize() {
+    DataPool *pool = dataPool();
+    return (pool) ? pool->sets.size() : 0;
+}
+
+namespace {
+
+    /*
+     * whether records carry the MONOTONIC property by default
+     */
+    std::atomic<bool> monotonicStamps(false);
+
+    long long nsecsOf(const struct timespec& ts) {
+        return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+}
 
 long long LogRecord::utcnow() {
-    struct timeval tv;      
-    struct timezone tz;     
-    gettimeofday(&tv,&tz);
-    // _tv.tv_sec = seconds since the epoch
-    // _tv.tv_usec = microseconds since tv.tv_sec
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return nsecsOf(ts);
+}
+
+long long LogRecord::monotonicnow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return nsecsOf(ts);
+}
+
+void LogRecord::_readClocks() {
+    struct timespec real, mono;
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    _nsecs = nsecsOf(real);
+    _monoNsecs = nsecsOf(mono);
+}
+
+void LogRecord::setMonotonicStamps(bool yesno) {
+    monotonicStamps.store(yesno, std::memory_order_relaxed);
+}
+
+bool LogRecord::willStampMonotonic() {
+    return monotonicStamps.load(std::memory_order_relaxed);
+}
+
+void LogRecord::stampMonotonic() {
+    if (! _send || _monoStamp) return;
+    _touch();
+    _monoStamp = true;
+    if (_lazyDate) 
+        _releaseData(_dates);
+    else
+        _data->set(LSST_LP_MONOTONIC, _monoNsecs);
+}
+
+namespace {
+
+    /*
+     * format a time for the DATE property
+     */
+    string formatDate(const DateTime& time) {
+        char datestr[40];
+        struct timeval tv = time.timeval(DateTime::UTC);
+
+        struct tm timeinfo;
+        time_t secs = (time_t) tv.tv_sec;
+        gmtime_r(&secs, &timeinfo);
+
+        if ( 0 == strftime(datestr,39,"%Y-%m-%dT%H:%M:%S.", &timeinfo) ) {
+            throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                              "Failed to format time successfully");
+        }
+        
+        return str(format("%s%d") % string(datestr) % tv.tv_usec);
+    }
 
-    long long nsec = static_cast<long long>(tv.tv_sec) * 1000000000L;
-    nsec += tv.tv_usec * 1000L;
-    return nsec;
+    /*
+     * the lock guarding the properties a record creates when first asked
+     * for through its const interface.  Records share a small set of 
+     * locks, chosen by address, so that a record needs none of its own.
+     */
+    std::mutex& lazyLock(const LogRecord *rec) {
+        static std::mutex locks[16];
+        return locks[(reinterpret_cast<std::uintptr_t>(rec) >> 4) % 16];
+    }
+
+    /*
+     * copy the time properties from one set to another
+     */
+    void copyDates(const PropertySet::Ptr& to, 
+                   const PropertySet::ConstPtr& from) 
+    {
+        static const char *names[] = { 
+            LSST_LP_TIMESTAMP, LSST_LP_DATE, LSST_LP_MONOTONIC 
+        };
+        for (auto name : names) 
+            if (from->exists(name)) to->copy(name, from, name);
+    }
 }
 
 void LogRecord::setTimestamp() {
-    _data->set(LSST_LP_TIMESTAMP, DateTime(utcnow(), DateTime::UTC));
+    _touch();
+    _readClocks();
+    if (_lazyDate) {
+        _releaseData(_dates);
+        return;
+    }
+    _data->set(LSST_LP_TIMESTAMP, DateTime(_nsecs, DateTime::UTC));
+    if (_monoStamp) _data->set(LSST_LP_MONOTONIC, _monoNsecs);
 }
 
 void LogRecord::setDate() {
     if (! _send) return;
-    if (! data().exists(LSST_LP_TIMESTAMP)) setTimestamp();
+    _touch();
+    if (_lazyDate) {
+        _mergeDate();
+        return;
+    }
+    if (! _data->exists(LSST_LP_TIMESTAMP)) setTimestamp();
+    _data->add(LSST_LP_DATE, 
+               formatDate(_data->get<DateTime>(LSST_LP_TIMESTAMP)));
+}
 
-    char datestr[40];
-    struct timeval tv = _data->get<DateTime>(LSST_LP_TIMESTAMP).timeval(DateTime::UTC);
+const PropertySet& LogRecord::_dateProperties() const {
+    std::lock_guard<std::mutex> lock(lazyLock(this));
+    if (! _dates) {
+        DateTime time(_nsecs, DateTime::UTC);
+        PropertySet::Ptr dates(_acquireData());
+        dates->set(LSST_LP_TIMESTAMP, time);
+        dates->set(LSST_LP_DATE, formatDate(time));
+        if (_monoStamp) dates->set(LSST_LP_MONOTONIC, _monoNsecs);
+        _dates = dates;
+    }
+    return *_dates;
+}
 
-    struct tm timeinfo;
-    time_t secs = (time_t) tv.tv_sec;
-    gmtime_r(&secs, &timeinfo);
+PropertySet::Ptr LogRecord::_withDates(const PropertySet::ConstPtr& own, 
+                                       const PropertySet::ConstPtr& dates) 
+{
+    PropertySet::Ptr merged(_acquireData());
+    std::vector<std::string> names = own->names();
+    bool placed = false;
+    for(std::vector<std::string>::iterator it = names.begin(); 
+        it != names.end(); ++it) 
+    {
+        merged->copy(*it, own, *it);
+        if (*it == LSST_LP_LEVEL) {
+            copyDates(merged, dates);
+            placed = true;
+        }
+    }
+    if (! placed) copyDates(merged, dates);
+    return merged;
+}
+
+PropertySet::Ptr LogRecord::_withPreamble(const PropertySet::ConstPtr& preamble,
+                                          const PropertySet::ConstPtr& own) 
+{
+    PropertySet::Ptr merged(preamble->deepCopy());
+    std::vector<std::string> names = own->paramNames(false);
+    for(std::vector<std::string>::iterator it = names.begin(); 
+        it != names.end(); ++it) 
+    {
+        if (merged->exists(*it)) merged->remove(*it);
+    }
+    merged->combine(own);
+    return merged;
+}
 
-    if ( 0 == strftime(datestr,39,"%Y-%m-%dT%H:%M:%S.", &timeinfo) ) {
-        throw LSST_EXCEPT(pexExcept::RuntimeError, 
-                          "Failed to format time successfully");
+PropertySet::Ptr LogRecord::_sharedDates() const {
+    std::lock_guard<std::mutex> lock(lazyLock(this));
+    return _dates;
+}
+
+const PropertySet& LogRecord::_mergedView() const {
+    if (_lazyDate) _dateProperties();
+    PropertySet::Ptr dates = _sharedDates();
+
+    std::lock_guard<std::mutex> lock(lazyLock(this));
+    if (! _merged) {
+        PropertySet::Ptr merged = _data;
+        if (_preamble) merged = _withPreamble(_preamble, merged);
+        if (_lazyDate) merged = _withDates(merged, dates);
+        _merged = merged;
     }
-    
-    string fulldate(str(format("%s%d") % string(datestr) % tv.tv_usec));
-    data().add(LSST_LP_DATE, fulldate);
+    return *_merged;
+}
+
+void LogRecord::_adoptMerged() {
+    _releaseData(_data);
+    _data = _merged;
+    _merged.reset();
+    _preamble.reset();
+    _releaseData(_dates);
+    _lazyDate = false;
+}
+
+void LogRecord::_mergeDate() {
+    _dateProperties();
+    PropertySet::Ptr merged = _withDates(_data, _dates);
+    _releaseData(_data);
+    _releaseData(_dates);
+    _data = merged;
+    _lazyDate = false;
 }
 
 size_t LogRecord::countParamValues() const {
     size_t sum = 0;
-    std::vector<std::string> names = _data->names(false);
+    std::vector<std::string> names = paramNames();
     std::vector<std::string>::iterator it;
     for(it = names.begin(); it != names.end(); ++it) {
-        sum += _data->valueCount(*it);
+        sum += propertiesFor(*it).valueCount(*it);
     }
     return sum;
 }
 
+std::vector<std::string> LogRecord::paramNames() const {
+    std::vector<std::string> names;
+    if (_preamble) {
+        std::vector<std::string> pnames = _preamble->paramNames(false);
+        for(std::vector<std::string>::iterator it = pnames.begin(); 
+            it != pnames.end(); ++it) 
+        {
+            if (! _data->exists(*it)) names.push_back(*it);
+        }
+    }
+    std::vector<std::string> own = _data->paramNames(false);
+    for(std::vector<std::string>::iterator it = own.begin(); 
+        it != own.end(); ++it) 
+    {
+        names.push_back(*it);
+        if (_lazyDate && *it == LSST_LP_LEVEL) {
+            names.push_back(LSST_LP_TIMESTAMP);
+            names.push_back(LSST_LP_DATE);
+            if (_monoStamp) names.push_back(LSST_LP_MONOTONIC);
+        }
+    }
+    return names;
+}
+
+void LogRecord::_mergePreamble() {
+    PropertySet::Ptr merged = _withPreamble(_preamble, _data);
+    _releaseData(_data);
+    _data = merged;
+    _preamble.reset();
+}
+
 void LogRecord::addProperties(const PropertySet& props) {
     PropertySet::Ptr temp(props.deepCopy());
     if (temp->exists("LEVEL")) temp->remove("LEVEL");
@@ -141,7 +430,15 @@ void LogRecord::addProperties(const PropertySet& props) {
     if (temp->exists("LOG")) temp->remove("LOG");
     if (temp->exists("TIMESTAMP")) temp->remove("TIMESTAMP");
     if (temp->exists("DATE")) temp->remove("DATE");
-    data().combine(temp);
+    if (temp->exists("MONOTONIC")) temp->remove("MONOTONIC");
+    _touch();
+    if (_preamble) {
+        std::vector<std::string> names = temp->names(true);
+        for(std::vector<std::string>::iterator it = names.begin(); 
+            it != names.end(); ++it) 
+            _unshare(*it);
+    }
+    _data->combine(temp);
 }
 
 //@endcond
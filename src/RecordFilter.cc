@@ -0,0 +1,429 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file RecordFilter.cc
+ * @brief implementation of the RecordFilter class
+ */
+#include "lsst/pex/logging/RecordFilter.h"
+#include "lsst/pex/logging/LogRecord.h"
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/exceptions.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <typeinfo>
+
+namespace pexExcept = lsst::pex::exceptions;
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+using std::string;
+using lsst::daf::base::PropertySet;
+
+/*
+ * a recursive-descent parser that compiles an expression into a filter's
+ * instructions.  From lowest to highest precedence:
+ *
+ *   or         := and { ("or" | "||") and }
+ *   and        := not { ("and" | "&&") not }
+ *   not        := ("not" | "!") not | "(" or ")" | comparison
+ *   comparison := "LEVEL" op (number | levelname)
+ *               | ("LOG" | "COMMENT") op string
+ *               | ["PROPERTY"] name ("exists" | op (number | string))
+ */
+class RecordFilter::Parser {
+public:
+    explicit Parser(RecordFilter& filter) 
+        : _f(filter), _s(filter._expr), _pos(0) 
+    { }
+
+    void parse() {
+        _or();
+        _skip();
+        if (_pos < _s.size()) _fail("expected \"and\", \"or\" or end");
+    }
+
+private:
+    void _or() {
+        _and();
+        std::vector<std::size_t> jumps;
+        while (_keyword("or") || _symbol("||")) {
+            jumps.push_back(_emit(Instr::OR));
+            _and();
+        }
+        for(std::size_t i=0; i < jumps.size(); ++i) 
+            _f._code[jumps[i]].target = _f._code.size();
+    }
+
+    void _and() {
+        _not();
+        std::vector<std::size_t> jumps;
+        while (_keyword("and") || _symbol("&&")) {
+            jumps.push_back(_emit(Instr::AND));
+            _not();
+        }
+        for(std::size_t i=0; i < jumps.size(); ++i) 
+            _f._code[jumps[i]].target = _f._code.size();
+    }
+
+    void _not() {
+        if (_keyword("not") || 
+            (_peek() == '!' && _pos+1 < _s.size() && _s[_pos+1] != '=' && 
+             _symbol("!")))
+        {
+            _not();
+            _emit(Instr::NOT);
+        }
+        else if (_symbol("(")) {
+            _or();
+            if (! _symbol(")")) _fail("expected \")\"");
+        }
+        else {
+            _comparison();
+        }
+    }
+
+    void _comparison() {
+        string field = _identifier();
+        if (field.empty()) _fail("expected a field name or \"(\"");
+
+        if (field == "LEVEL") {
+            std::size_t i = _emit(Instr::LEVEL);
+            _f._code[i].op = _op(false);
+            _f._code[i].number = _level();
+        }
+        else if (field == "LOG" || field == "COMMENT") {
+            std::size_t i = 
+                _emit((field == "LOG") ? Instr::LOG : Instr::COMMENT);
+            _f._code[i].op = _op(true);
+            if (! _string(_f._code[i].str)) _fail("expected a quoted string");
+        }
+        else {
+            if (field == "PROPERTY") {
+                field = _identifier();
+                if (field.empty()) _fail("expected a property name");
+            }
+            int name = static_cast<int>(_f._names.size());
+            _f._names.push_back(field);
+
+            if (_keyword("exists")) {
+                _f._code[_emit(Instr::EXISTS)].name = name;
+                return;
+            }
+            Instr::Op op = _op(true);
+            string str;
+            if (_string(str)) {
+                std::size_t i = _emit(Instr::STRING);
+                _f._code[i].str = str;
+                _f._code[i].op = op;
+                _f._code[i].name = name;
+            }
+            else {
+                if (op >= Instr::STARTS) 
+                    _fail("expected a quoted string");
+                std::size_t i = _emit(Instr::NUMBER);
+                _f._code[i].number = _number();
+                _f._code[i].op = op;
+                _f._code[i].name = name;
+            }
+        }
+    }
+
+    Instr::Op _op(bool strings) {
+        if (_symbol("==") || _symbol("=")) return Instr::EQ;
+        if (_symbol("!=")) return Instr::NE;
+        if (_symbol("<=")) return Instr::LE;
+        if (_symbol(">=")) return Instr::GE;
+        if (_symbol("<")) return Instr::LT;
+        if (_symbol(">")) return Instr::GT;
+        if (strings) {
+            if (_keyword("startswith")) return Instr::STARTS;
+            if (_keyword("endswith")) return Instr::ENDS;
+            if (_keyword("contains")) return Instr::CONTAINS;
+        }
+        _fail("expected a comparison operator");
+        return Instr::EQ;
+    }
+
+    double _level() {
+        std::size_t start = _pos;
+        string name = _identifier();
+        if (name == "DEBUG") return Log::DEBUG;
+        if (name == "INFO") return Log::INFO;
+        if (name == "WARN" || name == "WARNING") return Log::WARN;
+        if (name == "FATAL") return Log::FATAL;
+        if (! name.empty()) {
+            _pos = start;
+            _fail("expected a level name");
+        }
+        return _number();
+    }
+
+    double _number() {
+        _skip();
+        const char *start = _s.c_str() + _pos;
+        char *end = 0;
+        double val = std::strtod(start, &end);
+        if (end == start) _fail("expected a number");
+        _pos += end - start;
+        return val;
+    }
+
+    bool _string(string& out) {
+        char quote = _peek();
+        if (quote != '\'' && quote != '"') return false;
+        out.clear();
+        for(++_pos; _pos < _s.size() && _s[_pos] != quote; ++_pos) {
+            if (_s[_pos] == '\\' && _pos+1 < _s.size()) ++_pos;
+            out += _s[_pos];
+        }
+        if (_pos >= _s.size()) _fail("unterminated string");
+        ++_pos;
+        return true;
+    }
+
+    /*
+     * consume and return the identifier at the current position, or 
+     * return an empty string if there is none
+     */
+    string _identifier() {
+        _skip();
+        std::size_t end = _identifierEnd();
+        string id = _s.substr(_pos, end - _pos);
+        _pos = end;
+        return id;
+    }
+
+    std::size_t _identifierEnd() const {
+        std::size_t end = _pos;
+        if (end < _s.size() && (std::isalpha(_s[end]) || _s[end] == '_')) {
+            while (end < _s.size() && 
+                   (std::isalnum(_s[end]) || _s[end] == '_' || _s[end] == '.'))
+                ++end;
+        }
+        return end;
+    }
+
+    /*
+     * consume a (case-insensitive) keyword if it is next
+     */
+    bool _keyword(const char *word) {
+        _skip();
+        std::size_t end = _identifierEnd();
+        if (end == _pos) return false;
+        for(std::size_t i=_pos; i < end; ++i, ++word) {
+            if (*word == '\0' || std::tolower(_s[i]) != *word) return false;
+        }
+        if (*word != '\0') return false;
+        _pos = end;
+        return true;
+    }
+
+    bool _symbol(const char *sym) {
+        _skip();
+        std::size_t len = std::char_traits<char>::length(sym);
+        if (_s.compare(_pos, len, sym) != 0) return false;
+        _pos += len;
+        return true;
+    }
+
+    char _peek() {
+        _skip();
+        return (_pos < _s.size()) ? _s[_pos] : '\0';
+    }
+
+    void _skip() {
+        while (_pos < _s.size() && std::isspace(_s[_pos])) ++_pos;
+    }
+
+    std::size_t _emit(Instr::Code code) {
+        Instr in;
+        in.code = code;
+        in.op = Instr::EQ;
+        in.name = -1;
+        in.target = 0;
+        in.number = 0.0;
+        _f._code.push_back(in);
+        return _f._code.size() - 1;
+    }
+
+    void _fail(const string& what) {
+        throw LSST_EXCEPT(pexExcept::InvalidParameterError, 
+                          "bad record filter \"" + _s + "\" at position " + 
+                          std::to_string(_pos) + ": " + what);
+    }
+
+    RecordFilter& _f;
+    const string& _s;
+    std::size_t _pos;
+};
+
+namespace {
+
+    /*
+     * fetch a numeric property as a double; return false if it is not
+     * numeric.
+     */
+    bool getNumber(const PropertySet& props, const string& name, 
+                   double& val) 
+    {
+        const std::type_info& type = props.typeOf(name);
+        if (type == typeid(int)) 
+            val = props.get<int>(name);
+        else if (type == typeid(double)) 
+            val = props.get<double>(name);
+        else if (type == typeid(long)) 
+            val = props.get<long>(name);
+        else if (type == typeid(long long)) 
+            val = props.get<long long>(name);
+        else if (type == typeid(float)) 
+            val = props.get<float>(name);
+        else if (type == typeid(unsigned int)) 
+            val = props.get<unsigned int>(name);
+        else if (type == typeid(unsigned long)) 
+            val = props.get<unsigned long>(name);
+        else if (type == typeid(unsigned long long)) 
+            val = props.get<unsigned long long>(name);
+        else if (type == typeid(short)) 
+            val = props.get<short>(name);
+        else if (type == typeid(bool)) 
+            val = props.get<bool>(name);
+        else 
+            return false;
+        return true;
+    }
+}
+
+RecordFilter::RecordFilter(const string& expr) : _expr(expr) {
+    Parser(*this).parse();
+}
+
+/*
+ * return true if a record satisfies this filter's expression
+ */
+bool RecordFilter::matches(const LogRecord& rec) const {
+    bool result = true;
+    std::size_t n = _code.size();
+    for(std::size_t pc=0; pc < n; ++pc) {
+        const Instr& in = _code[pc];
+        switch (in.code) {
+        case Instr::LEVEL:
+            result = _compare(in, static_cast<double>(rec.getImportance()));
+            break;
+
+        case Instr::LOG: {
+            const PropertySet& props = rec.propertiesFor(LSST_LP_LOG);
+            result = props.exists(LSST_LP_LOG) && 
+                     _compare(in, props.get<string>(LSST_LP_LOG));
+            break;
+        }
+
+        case Instr::COMMENT: {
+            const PropertySet& props = rec.propertiesFor(LSST_LP_COMMENT);
+            result = false;
+            if (props.exists(LSST_LP_COMMENT)) {
+                std::vector<string> comments = 
+                    props.getArray<string>(LSST_LP_COMMENT);
+                for(std::size_t i=0; i < comments.size() && ! result; ++i) 
+                    result = _compare(in, comments[i]);
+            }
+            break;
+        }
+
+        case Instr::NUMBER: {
+            const string& name = _names[in.name];
+            const PropertySet& props = rec.propertiesFor(name);
+            double val;
+            result = props.exists(name) && getNumber(props, name, val) &&
+                     _compare(in, val);
+            break;
+        }
+
+        case Instr::STRING: {
+            const string& name = _names[in.name];
+            const PropertySet& props = rec.propertiesFor(name);
+            result = props.exists(name) && 
+                     props.typeOf(name) == typeid(string) &&
+                     _compare(in, props.get<string>(name));
+            break;
+        }
+
+        case Instr::EXISTS: {
+            const string& name = _names[in.name];
+            result = rec.propertiesFor(name).exists(name);
+            break;
+        }
+
+        case Instr::AND:
+            if (! result) pc = in.target - 1;
+            break;
+
+        case Instr::OR:
+            if (result) pc = in.target - 1;
+            break;
+
+        case Instr::NOT:
+            result = ! result;
+            break;
+        }
+    }
+    return result;
+}
+
+bool RecordFilter::_compare(const Instr& in, double val) const {
+    switch (in.op) {
+    case Instr::EQ:  return val == in.number;
+    case Instr::NE:  return val != in.number;
+    case Instr::LT:  return val < in.number;
+    case Instr::LE:  return val <= in.number;
+    case Instr::GT:  return val > in.number;
+    case Instr::GE:  return val >= in.number;
+    default:         return false;
+    }
+}
+
+bool RecordFilter::_compare(const Instr& in, const string& val) const {
+    const string& with = in.str;
+    switch (in.op) {
+    case Instr::EQ:  return val == with;
+    case Instr::NE:  return val != with;
+    case Instr::LT:  return val < with;
+    case Instr::LE:  return val <= with;
+    case Instr::GT:  return val > with;
+    case Instr::GE:  return val >= with;
+    case Instr::STARTS:  
+        return val.compare(0, with.size(), with) == 0;
+    case Instr::ENDS:  
+        return val.size() >= with.size() && 
+               val.compare(val.size() - with.size(), with.size(), with) == 0;
+    case Instr::CONTAINS:  
+        return val.find(with) != string::npos;
+    }
+    return false;
+}
+//@endcond
+
+}}}     // end lsst::pex::logging
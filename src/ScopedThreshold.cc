@@ -0,0 +1,82 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file ScopedThreshold.cc
+ */
+#include "lsst/pex/logging/ScopedThreshold.h"
+#include "lsst/pex/logging/Log.h"
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+using std::string;
+
+thread_local const ScopedThreshold *ScopedThreshold::_top = 0;
+
+/*
+ * override the threshold for a Log and its descendants in the 
+ * current thread
+ */
+ScopedThreshold::ScopedThreshold(const string& name, int threshold) 
+    : _name(name), _threshold(threshold), _prev(_top)
+{
+    _top = this;
+}
+
+/*
+ * restore the thresholds that were in effect when this object was 
+ * created.
+ */
+ScopedThreshold::~ScopedThreshold() {
+    _top = _prev;
+}
+
+/*
+ * look up the overriding threshold for a Log in the current thread.
+ */
+bool ScopedThreshold::findThresholdFor(const string& name, int& threshold) {
+    for(const ScopedThreshold *s = _top; s != 0; s = s->_prev) {
+        if (s->_matches(name)) {
+            threshold = s->_threshold;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * return true if name is the name of this scope's Log or of one of its 
+ * descendants.
+ */
+bool ScopedThreshold::_matches(const string& name) const {
+    if (_name.length() == 0 || name == _name) return true;
+    const string& sep = Log::_sep;
+    return (name.length() > _name.length() + sep.length() && 
+            name.compare(0, _name.length(), _name) == 0 && 
+            name.compare(_name.length(), sep.length(), sep) == 0);
+}
+
+//@endcond
+}}} // end lsst::pex::logging
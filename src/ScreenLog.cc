@@ -60,7 +60,9 @@ ScreenLog::ScreenLog(const PropertySet& preamble, bool verbose, int threshold)
     : Log(threshold), _screen(0), _screenFrmtr(0)
 {
     configure(verbose);
-    _preamble->combine(preamble.deepCopy());
+    PropertySet::Ptr full = _copyPreamble();
+    full->combine(preamble.deepCopy());
+    _setPreamble(full);
 }
 
 /*
@@ -93,10 +95,21 @@ void ScreenLog::configure(bool verbose) {
     _screen = new LogDestination(&clog, fmtr, INHERIT_THRESHOLD);
     shared_ptr<LogDestination> dest(_screen);
     _destinations.push_back( dest );
+    _destinationsChanged();
 }
 
 ScreenLog::~ScreenLog() { }
 
+/*
+ * set whether the screen is written by a thread of its own
+ */
+void ScreenLog::setScreenNonBlocking(bool nonBlocking, std::size_t capacity) {
+    if (nonBlocking) 
+        _screen->startWriter(capacity, LogDestination::SHED);
+    else
+        _screen->stopWriter();
+}
+
 /*
  *  copy another ScreenLog into this one
  */
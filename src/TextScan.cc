@@ -0,0 +1,167 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file TextScan.cc
+ * @brief implementation of the functions that find and treat the line 
+ * breaks and control characters in the text of log records
+ */
+#include "lsst/pex/logging/TextScan.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+
+namespace {
+
+    const char hexDigits[] = "0123456789abcdef";
+
+    bool isSpecial(char c, char delim) {
+        unsigned char u = static_cast<unsigned char>(c);
+        return (u < 0x20 && c != '\t') || u == 0x7f || 
+               (c == delim && delim != '\0');
+    }
+
+#if ! defined(__SSE2__)
+    /*
+     * return a word with every byte set to c
+     */
+    std::uint64_t spread(unsigned char c) {
+        return 0x0101010101010101ULL * c;
+    }
+
+    /*
+     * return non-zero if any byte of x is zero
+     */
+    std::uint64_t hasZero(std::uint64_t x) {
+        return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+    }
+#endif
+
+    void writeHex(std::ostream *strm, char c) {
+        unsigned char u = static_cast<unsigned char>(c);
+        char esc[4] = { '\\', 'x', hexDigits[u >> 4], hexDigits[u & 0xf] };
+        strm->write(esc, 4);
+    }
+}
+
+/*
+ * return a pointer to the first control character or delimiter in 
+ * [begin, end), or end if there is none
+ */
+const char *findSpecial(const char *begin, const char *end, char delim) {
+    const char *p = begin;
+
+#if defined(__SSE2__)
+    // a byte is special if it is no more than 0x1f (but not a tab), is 
+    // DEL or is the delimiter (DEL stands in for a NUL delimiter, which 
+    // is already caught as a control character).
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i dlm = _mm_set1_epi8((delim != '\0') ? delim : 0x7f);
+    for(; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v);
+        hit = _mm_andnot_si128(_mm_cmpeq_epi8(v, tab), hit);
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, del));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, dlm));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+#else
+    // look at a word at a time for a byte below 0x20, DEL or the 
+    // delimiter.  Tabs also turn up as candidates, so a word with a 
+    // candidate is checked byte by byte.
+    const std::uint64_t low = spread(0x20);
+    const std::uint64_t del = spread(0x7f);
+    const std::uint64_t dlm = spread(static_cast<unsigned char>(delim));
+    for(; end - p >= 8; p += 8) {
+        std::uint64_t x;
+        std::memcpy(&x, p, 8);
+        if (((x - low) & ~x & 0x8080808080808080ULL) == 0 && 
+            hasZero(x ^ del) == 0 && hasZero(x ^ dlm) == 0) 
+            continue;
+        for(int i=0; i < 8; ++i) 
+            if (isSpecial(p[i], delim)) return p + i;
+    }
+#endif
+
+    for(; p != end; ++p) 
+        if (isSpecial(*p, delim)) return p;
+    return end;
+}
+
+/*
+ * write text, indenting each line after the first
+ */
+void writeIndented(std::ostream *strm, boost::string_view text, 
+                   boost::string_view indent) 
+{
+    const char *p = text.data(), *end = p + text.size();
+    while (true) {
+        const char *special = findSpecial(p, end);
+        strm->write(p, special - p);
+        if (special == end) break;
+
+        if (*special == '\n') {
+            strm->put('\n');
+            strm->write(indent.data(), indent.size());
+        }
+        else if (*special != '\r' || special+1 == end || special[1] != '\n') {
+            writeHex(strm, *special);
+        }
+        p = special + 1;
+    }
+}
+
+/*
+ * write text as a single line, escaping line breaks and control characters
+ */
+void writeEscaped(std::ostream *strm, boost::string_view text) {
+    const char *p = text.data(), *end = p + text.size();
+    while (true) {
+        const char *special = findSpecial(p, end, '\\');
+        strm->write(p, special - p);
+        if (special == end) break;
+
+        switch (*special) {
+        case '\n':  strm->write("\\n", 2);   break;
+        case '\r':  strm->write("\\r", 2);   break;
+        case '\\':  strm->write("\\\\", 2);  break;
+        default:    writeHex(strm, *special);
+        }
+        p = special + 1;
+    }
+}
+
+//@endcond
+}}} // end lsst::pex::logging
@@ -0,0 +1,476 @@
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsstcorp.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/**
+ * @file UringFileDestination.cc
+ */
+#include "lsst/pex/logging/UringFileDestination.h"
+#include "lsst/pex/logging/LogFormatter.h"
+#include "lsst/pex/exceptions.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && \
+    defined(IORING_OFF_SQES)
+#define LSST_LOGGING_HAVE_URING 1
+#endif
+
+namespace lsst {
+namespace pex {
+namespace logging {
+
+//@cond
+namespace pexExcept = lsst::pex::exceptions;
+
+#ifdef LSST_LOGGING_HAVE_URING
+namespace {
+
+/*
+ * a minimal io_uring submission/completion ring, driven directly via 
+ * the system calls (liburing is not required).
+ */
+class Ring {
+public:
+    Ring() : _fd(-1), _sq(0), _cq(0), _sqes(0), _sqSize(0), _cqSize(0), 
+             _sqesSize(0) 
+    { }
+
+    ~Ring() { close(); }
+
+    /*
+     * set up a ring with the given number of entries and register the 
+     * given buffers.  Return false if io_uring is unavailable.
+     */
+    bool open(unsigned entries, const std::vector<struct iovec>& bufs) {
+        struct io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (_fd < 0) return false;
+
+        _sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        _cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) _sqSize = _cqSize = std::max(_sqSize, _cqSize);
+
+        _sq = mmap(0, _sqSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                   _fd, IORING_OFF_SQ_RING);
+        if (_sq == MAP_FAILED) { _sq = 0; close(); return false; }
+        if (single) {
+            _cq = _sq;
+        }
+        else {
+            _cq = mmap(0, _cqSize, PROT_READ|PROT_WRITE, 
+                       MAP_SHARED|MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+            if (_cq == MAP_FAILED) { _cq = 0; close(); return false; }
+        }
+        _sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+        void *sqes = mmap(0, _sqesSize, PROT_READ|PROT_WRITE, 
+                          MAP_SHARED|MAP_POPULATE, _fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) { close(); return false; }
+        _sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+        char *sq = static_cast<char*>(_sq), *cq = static_cast<char*>(_cq);
+        _sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        _sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        _sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        _cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        _cqes = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+        if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, 
+                    &bufs[0], bufs.size()) < 0) 
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return _fd >= 0; }
+
+    /*
+     * submit a write of a registered buffer at a file offset
+     */
+    bool submitWrite(int fd, int bufIndex, const char *data, unsigned len, 
+                     off_t offset) 
+    {
+        unsigned tail = *_sqTail;
+        unsigned idx = tail & _sqMask;
+        struct io_uring_sqe *sqe = &_sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<unsigned long>(data);
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->buf_index = bufIndex;
+        sqe->user_data = bufIndex;
+        _sqArray[idx] = idx;
+        __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        int rc;
+        do {
+            rc = static_cast<int>(
+                     syscall(__NR_io_uring_enter, _fd, 1, 0, 0, 0, 0));
+        } while (rc < 0 && errno == EINTR);
+        return rc == 1;
+    }
+
+    /*
+     * wait for at least one completion
+     */
+    void wait() {
+        int rc;
+        do {
+            rc = static_cast<int>(syscall(__NR_io_uring_enter, _fd, 0, 1, 
+                                          IORING_ENTER_GETEVENTS, 0, 0));
+        } while (rc < 0 && errno == EINTR);
+    }
+
+    /*
+     * pass each available completion (buffer index and result) to f
+     */
+    template <typename F>
+    void reap(F f) {
+        unsigned head = *_cqHead;
+        while (head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) {
+            const struct io_uring_cqe& cqe = _cqes[head & _cqMask];
+            f(static_cast<int>(cqe.user_data), cqe.res);
+            ++head;
+            __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    void close() {
+        if (_sqes != 0) munmap(_sqes, _sqesSize);
+        if (_cq != 0 && _cq != _sq) munmap(_cq, _cqSize);
+        if (_sq != 0) munmap(_sq, _sqSize);
+        if (_fd >= 0) ::close(_fd);
+        _sqes = 0; _cq = 0; _sq = 0; _fd = -1;
+    }
+
+private:
+    int _fd;
+    void *_sq, *_cq;
+    struct io_uring_sqe *_sqes;
+    std::size_t _sqSize, _cqSize, _sqesSize;
+    unsigned *_sqTail, *_sqArray, *_cqHead, *_cqTail;
+    unsigned _sqMask, _cqMask;
+    struct io_uring_cqe *_cqes;
+};
+
+}  // end anonymous namespace
+#else
+namespace {
+class Ring {
+public:
+    bool open(unsigned, const std::vector<struct iovec>&) { return false; }
+    bool isOpen() const { return false; }
+    bool submitWrite(int, int, const char*, unsigned, off_t) { return false; }
+    void wait() { }
+    template <typename F> void reap(F) { }
+};
+}  // end anonymous namespace
+#endif
+
+/*
+ * a stream buffer that renders into a set of fixed buffers and writes 
+ * them to a file asynchronously
+ */
+class UringFileBuf : public std::streambuf {
+public:
+    UringFileBuf(int fd, off_t offset, std::size_t bufferSize, int nbuffers)
+        : _fd(fd), _offset(offset), _size(bufferSize > 0 ? bufferSize : 4096),
+          _bufs(nbuffers > 1 ? nbuffers : 2), _inflight(_bufs.size(), false),
+          _pending(_bufs.size(), 0), _offsets(_bufs.size(), 0), _cur(0), 
+          _ring(), _uring(false), _error(0)
+    {
+        std::vector<struct iovec> iov(_bufs.size());
+        for(std::size_t i=0; i < _bufs.size(); ++i) {
+            void *mem = 0;
+            if (posix_memalign(&mem, 4096, _size) != 0) {
+                for(std::size_t j=0; j < i; ++j) std::free(_bufs[j]);
+                ::close(_fd);
+                throw std::bad_alloc();
+            }
+            _bufs[i] = static_cast<char*>(mem);
+            iov[i].iov_base = mem;
+            iov[i].iov_len = _size;
+        }
+        _uring = _ring.open(2 * _bufs.size(), iov);
+        setp(_bufs[_cur], _bufs[_cur] + _size);
+    }
+
+    ~UringFileBuf() {
+        drain();
+        ::close(_fd);
+        for(std::size_t i=0; i < _bufs.size(); ++i) std::free(_bufs[i]);
+    }
+
+    bool usesUring() const { return _uring; }
+
+    /*
+     * return the errno of the first write that could not be completed, 
+     * or 0 if none has failed.  Once a write fails, sync() and overflow()
+     * report failure, so the stream is marked bad.
+     */
+    int error() const { return _error; }
+
+    /*
+     * submit what is buffered and wait for all writes to complete
+     */
+    void drain() {
+        _submit();
+        while (_ring.isOpen() && _nInflight() > 0) {
+            _ring.wait();
+            _reap();
+        }
+    }
+
+protected:
+    /*
+     * called at the end of each record:  submit the current buffer if 
+     * no write is in flight; otherwise let records accumulate.
+     */
+    virtual int sync() {
+        _reap();
+        if (pptr() > pbase() && (! usesUring() || _nInflight() == 0)) 
+            _submit();
+        return (_error == 0) ? 0 : -1;
+    }
+
+    /*
+     * the current buffer is full
+     */
+    virtual int_type overflow(int_type c) {
+        _submit();
+        if (! traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        if (_error != 0) return traits_type::eof();
+        return traits_type::not_eof(c);
+    }
+
+private:
+    /*
+     * write out the current buffer and switch to a free one, waiting for 
+     * one if necessary.
+     */
+    void _submit() {
+        std::size_t len = pptr() - pbase();
+        if (len == 0) return;
+
+        // if a submission ever fails, switch to pwritev() for good
+        if (_uring && 
+            ! _ring.submitWrite(_fd, _cur, _bufs[_cur], len, _offset)) 
+            _uring = false;
+
+        if (_uring) {
+            _inflight[_cur] = true;
+            _pending[_cur] = len;
+            _offsets[_cur] = _offset;
+            _offset += len;
+
+            int next;
+            while ((next = _freeBuffer()) < 0) {
+                _ring.wait();
+                _reap();
+            }
+            _cur = next;
+        }
+        else {
+            _pwrite(_bufs[_cur], len, _offset);
+            _offset += len;
+        }
+        setp(_bufs[_cur], _bufs[_cur] + _size);
+    }
+
+    void _reap() {
+        _ring.reap([this](int i, int res) {
+            if (i < 0 || i >= static_cast<int>(_bufs.size())) return;
+            std::size_t len = _pending[i];
+            if (res < 0) res = 0;        // retry a failed write in full
+            if (static_cast<std::size_t>(res) < len)   // finish short write
+                _pwrite(_bufs[i] + res, len - res, _offsets[i] + res);
+            _inflight[i] = false;
+        });
+    }
+
+    void _pwrite(const char *data, std::size_t len, off_t offset) {
+        while (len > 0) {
+            struct iovec iov;
+            iov.iov_base = const_cast<char*>(data);
+            iov.iov_len = len;
+            ssize_t n = pwritev(_fd, &iov, 1, offset);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                if (_error == 0) _error = (n < 0) ? errno : EIO;
+                return;
+            }
+            data += n;
+            len -= n;
+            offset += n;
+        }
+    }
+
+    int _freeBuffer() const {
+        for(std::size_t i=0; i < _bufs.size(); ++i) {
+            if (! _inflight[i] && static_cast<int>(i) != _cur) return i;
+        }
+        return -1;
+    }
+
+    std::size_t _nInflight() const {
+        std::size_t n = 0;
+        for(std::size_t i=0; i < _inflight.size(); ++i) if (_inflight[i]) ++n;
+        return n;
+    }
+
+    int _fd;
+    off_t _offset;
+    std::size_t _size;
+    std::vector<char*> _bufs;
+    std::vector<bool> _inflight;
+    std::vector<std::size_t> _pending;
+    std::vector<off_t> _offsets;
+    int _cur;
+    Ring _ring;
+    bool _uring;
+    int _error;
+};
+
+UringFileDestination::UringFileDestination(const std::string& filepath,
+                               const std::shared_ptr<LogFormatter>& formatter, 
+                               int threshold, bool truncate, 
+                               std::size_t bufferSize, int nbuffers)
+    : LogDestination(0, formatter, threshold), _path(filepath), _buf()
+{ 
+    _open(truncate, bufferSize, nbuffers);
+}
+
+UringFileDestination::UringFileDestination(
+                               const boost::filesystem::path& filepath,
+                               const std::shared_ptr<LogFormatter>& formatter, 
+                               int threshold, bool truncate, 
+                               std::size_t bufferSize, int nbuffers)
+    : LogDestination(0, formatter, threshold), _path(filepath), _buf()
+{ 
+    _open(truncate, bufferSize, nbuffers);
+}
+
+UringFileDestination::UringFileDestination(const std::string& filepath, 
+                                           bool verbose, int threshold, 
+                                           bool truncate)
+    : LogDestination(0, 
+                 std::shared_ptr<LogFormatter>(new PrependedFormatter(verbose)),
+                 threshold), 
+      _path(filepath), _buf()
+{ 
+    _open(truncate, 65536, 4);
+}
+
+UringFileDestination::UringFileDestination(
+                                       const boost::filesystem::path& filepath,
+                                       bool verbose, int threshold, 
+                                       bool truncate)
+    : LogDestination(0, 
+                 std::shared_ptr<LogFormatter>(new PrependedFormatter(verbose)),
+                 threshold), 
+      _path(filepath), _buf()
+{ 
+    _open(truncate, 65536, 4);
+}
+
+/*
+ * open the file and attach the buffered stream.  If the file cannot be 
+ * opened, the destination will act as a null-op destination.  Writing 
+ * starts at the current end of the file and the offsets are tracked 
+ * here, so this must be the file's only writer.
+ */
+void UringFileDestination::_open(bool truncate, std::size_t bufferSize, 
+                                 int nbuffers) 
+{
+    setLabel(_path.string());
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    int fd = ::open(_path.string().c_str(), flags, 0644);
+    if (fd < 0) return;
+
+    struct stat st;
+    off_t offset = (fstat(fd, &st) == 0) ? st.st_size : 0;
+    _buf.reset(new UringFileBuf(fd, offset, bufferSize, nbuffers));
+    _strm = new std::ostream(_buf.get());
+}
+
+/*
+ * write out any buffered records, wait for them to complete, and 
+ * close the file.
+ */
+UringFileDestination::~UringFileDestination() {
+    stopWriter();
+    if (_buf.get() != 0) {
+        _strm->flush();
+        delete _strm;
+        _strm = 0;
+        try {
+            _buf->drain();
+        } catch (...) { }
+    }
+}
+
+bool UringFileDestination::usesUring() const {
+    return (_buf.get() != 0 && _buf->usesUring());
+}
+
+/*
+ * submit any buffered records and wait until all writes are complete.
+ */
+void UringFileDestination::flush() {
+    flushWriter();
+    if (_buf.get() == 0) return;
+    _buf->drain();
+    if (_buf->error() != 0) 
+        throw LSST_EXCEPT(pexExcept::RuntimeError, 
+                          "failed to write log file " + _path.string() + 
+                          ": " + std::strerror(_buf->error()));
+}
+
+//@endcond
+}}} // end lsst::pex::logging
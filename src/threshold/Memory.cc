@@ -105,12 +105,14 @@ Family* Family::makeDescendants(tokenizer::iterator toptoken,
 /**
  * set the threshold associated with a descendent with a given name
  */
-void Family::setThresholdFor(tokenizer::iterator toptoken, 
-                             const tokenizer::iterator& end,
-                             int threshold) 
+int Family::setThresholdFor(tokenizer::iterator toptoken, 
+                            const tokenizer::iterator& end,
+                            int threshold) 
 {
     Family *nfd = ensureDescendant(toptoken, end);
+    int old = nfd->_thresh;
     nfd->_thresh = threshold;
+    return old;
 }
 
 /**
@@ -143,6 +145,23 @@ Family::~Family() {
     deleteDescendants();
 }
 
+/*
+ * return the lower of a given threshold and the lowest threshold set 
+ * for any descendant.
+ */
+int Family::getLowestDescThreshold(int lowest) const {
+    if (_children == 0) return lowest;
+
+    ChildMap::const_iterator it;
+    for(it = _children->begin(); it != _children->end(); ++it) {
+        if (it->second == 0) continue;
+        if (it->second->_thresh != INHERIT && it->second->_thresh < lowest) 
+            lowest = it->second->_thresh;
+        lowest = it->second->getLowestDescThreshold(lowest);
+    }
+    return lowest;
+}
+
 void Family::printDescThresholds(std::ostream& out, 
                                  const std::string& prefix) const 
 {
@@ -169,9 +188,25 @@ void Family::printDescThresholds(std::ostream& out,
 /* ******************************************************************* */
 
 Memory::Memory(const std::string& delims) 
-    : _tree(), _sep(delims.c_str())
+    : _tree(), _sep(delims.c_str()), _lowest(_tree.getThreshold())
 { }
 
+/*
+ * update the lowest threshold after a descendant's threshold has changed 
+ * from oldThreshold to newThreshold (either of which may be INHERIT).  
+ * Lowering a threshold can only lower the watermark; the tree need only 
+ * be searched again when the threshold being raised or reset may have 
+ * been the lowest one.
+ */
+void Memory::_updateLowest(int oldThreshold, int newThreshold) {
+    int lowest = _lowest.load(std::memory_order_relaxed);
+    if (newThreshold == oldThreshold) return;
+    if (newThreshold != INHERIT && newThreshold < lowest) 
+        _lowest.store(newThreshold, std::memory_order_relaxed);
+    else if (oldThreshold != INHERIT && oldThreshold <= lowest) 
+        _lowest.store(_tree.getLowestThreshold(), std::memory_order_relaxed);
+}
+
 /**
  * print the thresholds stored in this Memory that are not set to INHERIT.
  */
@@ -25,6 +25,8 @@
  * @brief tests the BlockTimingLog class
  */
 #include "lsst/pex/logging/BlockTimingLog.h"
+#include "lsst/pex/logging/LogFormatter.h"
+#include <sstream>
 
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE test_BlockTimingLog
@@ -32,6 +34,9 @@
 
 using lsst::pex::logging::BlockTimingLog;
 using lsst::pex::logging::Log;
+using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::NetLoggerFormatter;
 
 BOOST_AUTO_TEST_CASE( test_BlockTimingLog )
 {
@@ -43,3 +48,46 @@ BOOST_AUTO_TEST_CASE( test_BlockTimingLog )
     tr->done();
     delete tr;
 }
+
+BOOST_AUTO_TEST_CASE( test_BlockTimingLogReuse )
+{
+    BlockTimingLog rtr = BlockTimingLog(Log::getDefaultLog(), "test");
+    BlockTimingLog *tr = rtr.createForBlock("api");
+    tr->done();
+    void *mem = tr;
+    delete tr;
+
+    // the memory of the deleted block is reused for the next one
+    tr = rtr.timeBlock("api2");
+    BOOST_CHECK_EQUAL(static_cast<void*>(tr), mem);
+    BOOST_CHECK_EQUAL(tr->getFunctionName(), "api2");
+    tr->done();
+    delete tr;
+}
+
+BOOST_AUTO_TEST_CASE( test_BlockTimingLogMonotonic )
+{
+    std::ostringstream out;
+    Log log(Log::INFO, "mono");
+    log.addDestination(out, BlockTimingLog::INSTRUM, 
+                       std::shared_ptr<LogFormatter>(new NetLoggerFormatter()));
+    BlockTimingLog rtr(log, "test", BlockTimingLog::INSTRUM);
+    rtr.setThreshold(BlockTimingLog::INSTRUM);
+
+    // the start and end messages are only stamped when all records are
+    BlockTimingLog *tr = rtr.timeBlock("plain");
+    tr->done();
+    delete tr;
+    BOOST_CHECK(out.str().find("Ending plain") != std::string::npos);
+    BOOST_CHECK(out.str().find("MONOTONIC") == std::string::npos);
+
+    LogRecord::setMonotonicStamps(true);
+    tr = rtr.timeBlock("stamped");
+    tr->done();
+    delete tr;
+    LogRecord::setMonotonicStamps(false);
+    std::string text = out.str();
+    std::size_t first = text.find("MONOTONIC");
+    BOOST_CHECK(first != std::string::npos);
+    BOOST_CHECK(text.find("MONOTONIC", first+1) != std::string::npos);
+}
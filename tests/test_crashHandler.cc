@@ -0,0 +1,135 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+/**
+ * @file test_crashHandler.cc
+ * @brief tests the CrashHandler class
+ */
+#include "lsst/pex/logging/CrashHandler.h"
+#include "lsst/pex/logging/Log.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::CrashHandler;
+using std::string;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+// recurse until the stack overflows
+volatile int maxDepth = -1;
+int recurse(int depth) {
+    volatile char frame[1024];
+    frame[0] = static_cast<char>(depth);
+    if (depth == maxDepth) return 0;
+    return recurse(depth + 1) + frame[0];
+}
+
+// a handler installed before the CrashHandler
+extern "C" void exitQuietly(int, siginfo_t *info, void *) {
+    _exit(info->si_signo == SIGABRT ? 42 : 1);
+}
+
+/*
+ * run a child process that calls crash() after installing the handler, 
+ * and return what the handler reported
+ */
+template <typename F>
+string reportFromChild(F crash, int& status) {
+    int fds[2];
+    assure(pipe(fds) == 0, "failed to create pipe");
+
+    pid_t pid = fork();
+    assure(pid >= 0, "fork failed");
+    if (pid == 0) {
+        close(fds[0]);
+        CrashHandler::install(fds[1], 256);
+        crash();
+        _exit(0);
+    }
+
+    close(fds[1]);
+    string report;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) report.append(buf, n);
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    return report;
+}
+
+int main() {
+    int status = 0;
+    string report = reportFromChild([]{
+        assure(CrashHandler::isInstalled(), "handler not installed");
+        Log log(Log::INFO, "worker");
+        log.addDestination(CrashHandler::getFlightRecorder());
+        for(int i=0; i < 20; ++i) log.infof("step %d", i);
+        raise(SIGSEGV);
+    }, status);
+    assure(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV, 
+           "child did not die from the signal");
+    assure(report.find("worker: step 19\n") != string::npos, 
+           "last record not reported:\n" + report);
+    assure(report.find("step 0\n") == string::npos, 
+           "flight recorder did not wrap:\n" + report);
+    assure(report.find("logging FATAL: caught SIGSEGV (signal 11)") 
+           != string::npos, "crash not reported:\n" + report);
+
+    // a stack overflow is reported from a thread given an alternate stack
+    report = reportFromChild([]{
+        std::thread t([]{
+            CrashHandler::protectThread();
+            recurse(0);
+        });
+        t.join();
+    }, status);
+    assure(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV, 
+           "child did not die from the stack overflow");
+    assure(report.find("logging FATAL: caught SIGSEGV (signal 11)") 
+           != string::npos, "stack overflow not reported:\n" + report);
+
+    // a handler that was installed earlier is called after the report
+    struct sigaction sa, old;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = exitQuietly;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO;
+    sigaction(SIGABRT, &sa, &old);
+    report = reportFromChild([]{ raise(SIGABRT); }, status);
+    sigaction(SIGABRT, &old, 0);
+    assure(WIFEXITED(status) && WEXITSTATUS(status) == 42, 
+           "previous handler not called");
+    assure(report.find("logging FATAL: caught SIGABRT (signal 6)") 
+           != string::npos, "chained crash not reported:\n" + report);
+
+    std::cout << "CrashHandler tests passed" << std::endl;
+}
@@ -0,0 +1,149 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+/**
+ * @file test_debugCapture.cc
+ * @brief tests the DebugCapture class
+ */
+#include "lsst/pex/logging/DebugCapture.h"
+#include "lsst/pex/logging/BlockTimingLog.h"
+#include "lsst/pex/logging/Debug.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::Debug;
+using lsst::pex::logging::DebugCapture;
+using lsst::pex::logging::BlockTimingLog;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+using std::string;
+using std::shared_ptr;
+namespace threshold = lsst::pex::logging::threshold;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+void failingTask(Log& log) {
+    DebugCapture capture(log);
+    log.logdebug("before failure");
+    throw std::runtime_error("task failed");
+}
+
+// captures over its destructor, which may run while unwinding
+struct Cleanup {
+    explicit Cleanup(Log& l) : log(l) { }
+    ~Cleanup() {
+        DebugCapture capture(log);
+        log.logdebug("cleanup detail");
+    }
+    Log& log;
+};
+
+int main() {
+    std::ostringstream out;
+    Log root(Log::INFO);
+    root.addDestination(out, threshold::PASS_ALL, 
+                        shared_ptr<LogFormatter>(new BriefFormatter()));
+    Log log(root, "task");
+
+    // a scope that ends normally discards what it captured
+    {
+        DebugCapture capture(log);
+        assure(DebugCapture::isActive(), "capture not active");
+        log.logdebug("discarded");
+        log.debugf("discarded %d", 2);
+        assure(capture.getCount() == 2, "records not captured");
+        log.info("passed");
+    }
+    assure(! DebugCapture::isActive(), "capture still active");
+    assure(out.str() == "task: passed\n", "unexpected output: " + out.str());
+    out.str("");
+
+    // a warning writes out the captured records ahead of it
+    {
+        DebugCapture capture(log);
+        log.logdebug("detail 1");
+        Debug dbg(log, "fit");
+        dbg.debug<5>("detail 2");
+        assure(capture.getCount() == 2, "debug record not captured");
+        log.warn("trouble");
+        assure(capture.isTriggered(), "warning did not trigger");
+        log.logdebug("detail 3");
+    }
+    assure(out.str() == "task DEBUG: detail 1\ntask.fit DEBUG: detail 2\n"
+                        "task WARNING: trouble\ntask DEBUG: detail 3\n", 
+           "unexpected output: " + out.str());
+    out.str("");
+
+    // an exception writes out the captured records
+    try {
+        failingTask(log);
+        assure(false, "failing task did not throw");
+    } catch (std::runtime_error&) { }
+    assure(out.str() == "task DEBUG: before failure\n", 
+           "unexpected output: " + out.str());
+    out.str("");
+
+    // a capture that ends normally while another exception unwinds the 
+    // stack discards what it captured
+    try {
+        Cleanup cleanup(log);
+        throw std::runtime_error("unwinding");
+    } catch (std::runtime_error&) { }
+    assure(out.str() == "", "unexpected output: " + out.str());
+
+    // only the tail is kept
+    {
+        DebugCapture capture(log, Log::DEBUG, Log::WARN, 2);
+        log.logdebug("old");
+        log.logdebug("recent 1");
+        log.logdebug("recent 2");
+        assure(capture.getDroppedCount() == 1, "wrong dropped count");
+        capture.flush();
+    }
+    assure(out.str() == "task DEBUG: 1 earlier captured records were dropped\n"
+                        "task DEBUG: recent 1\ntask DEBUG: recent 2\n", 
+           "unexpected output: " + out.str());
+    out.str("");
+
+    // capturing over a timed block
+    BlockTimingLog block(log, "block");
+    block.setUsageFlags(BlockTimingLog::NOUDATA);
+    {
+        DebugCapture capture(block);
+        block.logdebug("inside");
+        block.fatal("failed");
+    }
+    string result = out.str();
+    assure(result.find("task.block DEBUG: Starting block\n"
+                       "task.block DEBUG: inside\n") == 0,
+           "block start not captured: " + result);
+    assure(result.find("task.block FATAL: failed\n") != string::npos &&
+           result.find("Ending block") != string::npos, 
+           "unexpected block output: " + result);
+
+    std::cout << "DebugCapture tests passed" << std::endl;
+}
@@ -0,0 +1,331 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+/**
+ * @file test_destinationWriter.cc
+ * @brief tests LogDestinations with their own writer threads
+ */
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/LogDestination.h"
+#include "lsst/pex/logging/ScreenLog.h"
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::LogDestination;
+using lsst::pex::logging::ScreenLog;
+using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+/*
+ * a stream buffer that stalls its writer until it is opened
+ */
+class GatedBuf : public std::stringbuf {
+public:
+    GatedBuf() : _open(false) { }
+    void open() {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _open = true;
+        _cv.notify_all();
+    }
+protected:
+    virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+        _wait();
+        return std::stringbuf::xsputn(s, n);
+    }
+    virtual int_type overflow(int_type c) {
+        _wait();
+        return std::stringbuf::overflow(c);
+    }
+private:
+    void _wait() {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _cv.wait(lock, [this]{ return _open; });
+    }
+    bool _open;
+    std::mutex _mtx;
+    std::condition_variable _cv;
+};
+
+/*
+ * a stream buffer that discards what is written to it, counting the 
+ * bytes; it may be written by several threads at once
+ */
+class SinkBuf : public std::streambuf {
+public:
+    SinkBuf() : _bytes(0) { }
+    std::size_t bytes() {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _bytes;
+    }
+protected:
+    virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _bytes += n;
+        return n;
+    }
+    virtual int_type overflow(int_type c) {
+        std::lock_guard<std::mutex> lock(_mtx);
+        ++_bytes;
+        return c;
+    }
+private:
+    std::size_t _bytes;
+    std::mutex _mtx;
+};
+
+/*
+ * a formatter that counts the records it formats
+ */
+class CountingFormatter : public BriefFormatter {
+public:
+    CountingFormatter() : count(0) { }
+    virtual void write(std::ostream *strm, const LogRecord& rec) {
+        ++count;
+        BriefFormatter::write(strm, rec);
+    }
+    int count;
+};
+
+/*
+ * destinations that share a formatter share one rendering of each record
+ */
+void testSharedFormatter() {
+    shared_ptr<CountingFormatter> counting(new CountingFormatter());
+    shared_ptr<LogFormatter> other(new BriefFormatter());
+    std::ostringstream out1, out2, out3, out4;
+    shared_ptr<LogDestination> queued(new LogDestination(&out3, counting));
+    Log log(Log::DEBUG, "shared");
+    log.addDestination(shared_ptr<LogDestination>(
+                           new LogDestination(&out1, counting)));
+    log.addDestination(shared_ptr<LogDestination>(
+                           new LogDestination(&out2, counting)));
+    log.addDestination(queued);
+    log.addDestination(shared_ptr<LogDestination>(
+                           new LogDestination(&out4, other)));
+    queued->startWriter();
+
+    log.info("one");
+    log.warn("two");
+    queued->stopWriter();
+    string want("shared: one\nshared WARNING: two\n");
+    assure(out1.str() == want && out2.str() == want && out3.str() == want &&
+           out4.str() == want, "shared rendering mangled: " + out2.str());
+    assure(counting->count == 2, "record rendered more than once");
+
+    // child logs and logs made from a list of destinations share too
+    Log child(log, "child");
+    child.info("three");
+    std::list<shared_ptr<LogDestination> > dests;
+    dests.push_back(shared_ptr<LogDestination>(
+                        new LogDestination(&out1, counting)));
+    dests.push_back(shared_ptr<LogDestination>(
+                        new LogDestination(&out2, counting)));
+    Log listed(dests, lsst::daf::base::PropertySet(), "listed");
+    listed.info("four");
+    assure(counting->count == 4, "child or listed log rendered twice");
+}
+
+int main() {
+    testSharedFormatter();
+
+    shared_ptr<LogFormatter> brief(new BriefFormatter());
+    GatedBuf slowbuf;
+    std::ostream slow(&slowbuf);
+    std::ostringstream fast;
+
+    Log log(Log::INFO, "app");
+    shared_ptr<LogDestination> slowdest(new LogDestination(&slow, brief));
+    shared_ptr<LogDestination> fastdest(new LogDestination(&fast, brief));
+    log.addDestination(slowdest);
+    log.addDestination(fastdest);
+
+    // a stalled destination with a writer does not hold up the other
+    slowdest->startWriter(4, LogDestination::DROP_NEWEST);
+    assure(slowdest->hasWriter(), "writer not started");
+    for(int i=0; i < 10; ++i) log.infof("message %d", i);
+    string expected;
+    for(int i=0; i < 10; ++i) {
+        std::ostringstream line;
+        line << "app: message " << i << "\n";
+        expected += line.str();
+    }
+    assure(fast.str() == expected, "unexpected fast output: " + fast.str());
+
+    // once unstalled, the queued records come out in order; with a 
+    // capacity of 4, at most 5 (one being written) can have been kept.
+    slowbuf.open();
+    slowdest->flushWriter();
+    string got = slowbuf.str();
+    assure(got.find("app: message 0\n") == 0, "first record lost: " + got);
+    int lines = 0;
+    for(string::size_type i=0; i < got.length(); ++i) 
+        if (got[i] == '\n') ++lines;
+    assure(lines >= 4 && lines <= 5, "overflow not applied: " + got);
+    slowdest->stopWriter();
+    assure(slowbuf.str().find("logging WARNING: dropped ") != string::npos,
+           "no drop summary: " + slowbuf.str());
+
+    // the BLOCK policy keeps every record
+    slowbuf.str("");
+    slowdest->startWriter(2, LogDestination::BLOCK, 0);
+    for(int i=0; i < 10; ++i) log.infof("message %d", i);
+    slowdest->stopWriter();
+    assure(! slowdest->hasWriter(), "writer not stopped");
+    assure(slowbuf.str() == expected, "records lost: " + slowbuf.str());
+
+    // the other policies, with a summary of what was dropped
+    GatedBuf stallbuf;
+    std::ostream stall(&stallbuf);
+    shared_ptr<LogDestination> dest(new LogDestination(&stall, brief));
+    Log log2(Log::DEBUG, "app");
+    log2.addDestination(dest);
+    dest->setDropSummaryInterval(0);
+
+    dest->startWriter(3, LogDestination::DROP_BELOW);
+    dest->setBlockTimeout(10);
+    log2.warn("stuck");                   // held by the stalled writer
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    log2.warn("kept 1");
+    log2.logdebug("shed 1");
+    log2.warn("kept 2");                  // the queue is now full
+    log2.info("shed 2");
+    log2.fatal("kept 3");
+    log2.warn("timed out");
+    assure(dest->getDroppedCount() == 3, "records not shed");
+    stallbuf.open();
+    dest->stopWriter();
+    got = stallbuf.str();
+    assure(got.find("shed") == string::npos, "low records not shed: " + got);
+    assure(got.find("app FATAL: kept 3\n") != string::npos, 
+           "important record shed: " + got);
+    assure(got.find("logging WARNING: dropped ") != string::npos, 
+           "no drop summary: " + got);
+    assure(got.find("(DEBUG: 1, INFO: 1, WARN: 1)") != string::npos, 
+           "wrong summary: " + got);
+    assure(got.find("timed out") == string::npos, "record not timed out");
+
+    stallbuf.str("");
+    dest->setBlockTimeout(-1);
+    dest->startWriter(1, LogDestination::DROP_OLDEST);
+    for(int i=0; i < 10; ++i) log2.infof("message %d", i);
+    dest->stopWriter();
+    got = stallbuf.str();
+    assure(got.find("app: message 9\n") != string::npos, 
+           "newest record dropped: " + got);
+
+    // the SHED policy never waits, even when every queued record is
+    // important
+    GatedBuf floodbuf;
+    std::ostream flood(&floodbuf);
+    shared_ptr<LogDestination> floodDest(new LogDestination(&flood, brief));
+    Log log3(Log::DEBUG, "app");
+    log3.addDestination(floodDest);
+    floodDest->setDropSummaryInterval(0);
+    floodDest->startWriter(2, LogDestination::SHED);
+    log3.warn("stuck");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    log3.warn("lost 1");
+    log3.logdebug("shed 1");
+    log3.warn("kept 1");                  // the queue is now full
+    log3.info("shed 2");
+    log3.fatal("kept 2");                 // replaces "lost 1"
+    assure(floodDest->getDroppedCount() == 3, "records not shed");
+    floodbuf.open();
+    floodDest->stopWriter();
+    got = floodbuf.str();
+    assure(got.find("shed") == string::npos && got.find("lost") == string::npos,
+           "records not shed: " + got);
+    assure(got.find("app WARNING: kept 1\napp FATAL: kept 2\n") != string::npos,
+           "important records shed: " + got);
+    assure(got.find("(DEBUG: 1, INFO: 1, WARN: 1)") != string::npos, 
+           "wrong summary: " + got);
+
+    // ... but does not displace a record with a less important one
+    GatedBuf fatalbuf;
+    std::ostream fatalOut(&fatalbuf);
+    shared_ptr<LogDestination> fatalDest(new LogDestination(&fatalOut, brief));
+    Log log4(Log::DEBUG, "app");
+    log4.addDestination(fatalDest);
+    fatalDest->setDropSummaryInterval(0);
+    fatalDest->startWriter(2, LogDestination::SHED);
+    log4.warn("stuck");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    log4.fatal("fatal 1");
+    log4.warn("lost 1");                  // the queue is now full
+    log4.warn("lost 2");                  // replaces "lost 1"
+    log4.fatal("fatal 2");                // replaces "lost 2"
+    log4.warn("lost 3");                  // less important than the queue
+    assure(fatalDest->getDroppedCount() == 3, "records not shed");
+    fatalbuf.open();
+    fatalDest->stopWriter();
+    got = fatalbuf.str();
+    assure(got.find("lost") == string::npos, "records not shed: " + got);
+    assure(got.find("app FATAL: fatal 1\napp FATAL: fatal 2\n") != 
+           string::npos, "fatal record shed: " + got);
+
+    // the writer can be started and stopped while other threads write
+    SinkBuf sink;
+    std::ostream busyOut(&sink);
+    shared_ptr<LogDestination> busyDest(new LogDestination(&busyOut, brief));
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> loggers;
+    for(int i=0; i < 4; ++i) 
+        loggers.emplace_back([&busyDest, &stop]{
+            Log log5(Log::DEBUG, "app");
+            log5.addDestination(busyDest);
+            while (! stop) log5.info("busy");
+        });
+    for(int i=0; i < 50; ++i) {
+        busyDest->startWriter(8, LogDestination::SHED);
+        busyDest->stopWriter();
+    }
+    stop = true;
+    for(auto& t : loggers) t.join();
+    assure(! busyDest->hasWriter(), "writer left running");
+    assure(sink.bytes() > 0, "nothing written while switching writers");
+
+    ScreenLog screen;
+    screen.setScreenNonBlocking(true, 16);
+    assure(screen.isScreenNonBlocking() && 
+           screen.getScreenDestination().hasWriter(), "screen writer not started");
+    screen.setScreenNonBlocking(false);
+    assure(! screen.isScreenNonBlocking(), "screen writer not stopped");
+
+    std::cout << "writer thread tests passed" << std::endl;
+}
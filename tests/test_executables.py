@@ -7,15 +7,27 @@ class UtilsBinaryTester(lsst.utils.tests.ExecutablesTestCase):
 
 # Do not run the executables that have their output compared in python
 EXECUTABLES = ("test_blockTimingLog",
+               "test_crashHandler",
+               "test_debugCapture",
                "test_defLog",
+               "test_destinationWriter",
                "test_fileDest",
+               "test_format",
                "test_log",
                "test_logFormatter",
+               "test_logHandle",
+               "test_logMetrics",
+               "test_logReader",
                "test_logRecord",
                "test_noTrace",
                "test_propertyPrinter",
+               "test_recordFilter",
+               "test_recordProps",
+               "test_scopedThreshold",
+               "test_textScan",
                "test_thresholdMemory",
                "test_trace",
+               "test_uringFileDest",
                "test_timeSyscalls")
 UtilsBinaryTester.create_executable_tests(__file__, EXECUTABLES)
 
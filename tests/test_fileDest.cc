@@ -22,14 +22,20 @@
  
 #include "lsst/pex/logging/Log.h"
 #include "lsst/pex/logging/FileDestination.h"
+#include "lsst/pex/exceptions.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <memory>
+#include <thread>
+#include <vector>
 
 using lsst::pex::logging::Log;
 using lsst::pex::logging::FileDestination;
 using lsst::pex::logging::LogDestination;
 using lsst::pex::logging::LogFormatter;
 using lsst::pex::logging::PrependedFormatter;
+using lsst::pex::logging::BriefFormatter;
 using namespace std;
 
 void assure(bool mustBeTrue, const string& failureMsg) {
@@ -54,4 +60,74 @@ int main() {
     log.log(Log::DEBUG, "debugging");
     log.setThreshold(Log::DEBUG);
     log.log(Log::DEBUG, "hear this");
+
+    // durable records
+    std::string durablepath("tests/testFileDestination-durable.txt");
+    std::shared_ptr<LogFormatter> terse(new BriefFormatter());
+    std::shared_ptr<FileDestination> 
+        durable(new FileDestination(durablepath, terse, 0, true));
+    Log audit(Log::INFO, "audit");
+    audit.addDestination(durable);
+    assure(! durable->isDurable(), "durable by default");
+    durable->setDurability(Log::WARN);
+    assure(durable->isDurable(), "durability not set");
+    assure(durable->getDurableThreshold() == Log::WARN, 
+           "wrong durable threshold");
+
+    audit.log(Log::INFO, "buffered");
+    assure(durable->getSyncCount() == 0, "synced a buffered record");
+    audit.log(Log::WARN, "committed");
+    assure(durable->getSyncCount() == 1, "durable record not synced");
+    {
+        std::ifstream in(durablepath.c_str());
+        std::stringstream got;
+        got << in.rdbuf();
+        assure(got.str() == "audit: buffered\naudit WARNING: committed\n",
+               "unexpected file contents: " + got.str());
+    }
+
+    // concurrent durable records share syncs
+    durable->setDurability(Log::WARN, 2000);
+    const int nthreads = 8, nrecs = 25;
+    std::vector<std::thread> threads;
+    for(int i=0; i < nthreads; ++i) {
+        threads.push_back(std::thread([&audit]{
+            for(int j=0; j < nrecs; ++j) audit.log(Log::WARN, "burst");
+        }));
+    }
+    for(auto& t : threads) t.join();
+    std::size_t syncs = durable->getSyncCount();
+    cout << nthreads*nrecs << " durable records took " << syncs 
+         << " syncs" << endl;
+    assure(syncs > 0 && syncs < std::size_t(nthreads*nrecs), 
+           "durable records were not grouped");
+    {
+        std::ifstream in(durablepath.c_str());
+        std::string line;
+        int count = 0;
+        while (std::getline(in, line)) 
+            if (line == "audit WARNING: burst") ++count;
+        assure(count == nthreads*nrecs, "durable records missing");
+    }
+
+    durable->clearDurability();
+    assure(! durable->isDurable(), "durability not cleared");
+    audit.log(Log::WARN, "buffered again");
+    assure(durable->getSyncCount() == 0, "synced after clearing");
+
+    // a failed sync is reported rather than taken as a commit 
+    // (/dev/null cannot be synced)
+    std::shared_ptr<FileDestination> 
+        unsyncable(new FileDestination("/dev/null", terse, 0, false));
+    unsyncable->setDurability(Log::WARN);
+    Log audit2(Log::INFO, "audit");
+    audit2.addDestination(unsyncable);
+    bool reported = false;
+    try {
+        audit2.log(Log::WARN, "not durable");
+    } catch (lsst::pex::exceptions::RuntimeError&) {
+        reported = true;
+    }
+    assure(reported, "failed sync not reported");
+    assure(unsyncable->getSyncCount() == 1, "wrong sync count");
 }
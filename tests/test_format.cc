@@ -0,0 +1,220 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+ 
+/**
+ * @file test_format.cc
+ * @brief tests the "{}"-style message formatting API
+ */
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/Debug.h"
+#include "lsst/pex/logging/Format.h"
+#include "lsst/pex/logging/LogHandle.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <cmath>
+#include <climits>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::Debug;
+using lsst::pex::logging::LogHandle;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+using lsst::pex::logging::FormatBuffer;
+using lsst::pex::logging::FormatSpec;
+using lsst::pex::logging::FormatValue;
+using lsst::pex::logging::formatTo;
+using lsst::pex::logging::formatToString;
+using lsst::daf::base::DateTime;
+namespace formatting = lsst::pex::logging::formatting;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+void expect(const string& got, const string& want, const string& what) {
+    if (got != want) 
+        throw std::runtime_error(what + ": got \"" + got + 
+                                 "\", expected \"" + want + "\"");
+}
+
+// format strings are checked at compile time
+static_assert(formatting::check<int, double>("x={} y={:.3f}", 13) 
+              == formatting::OK, "good format rejected");
+static_assert(formatting::check<int>("{}{}", 4) 
+              == formatting::TOO_FEW_ARGS, "missing argument accepted");
+static_assert(formatting::check<int, int>("{}", 2) 
+              == formatting::TOO_MANY_ARGS, "extra argument accepted");
+static_assert(formatting::check<double>("{:d}", 4) 
+              == formatting::BAD_TYPE, "{:d} accepted for a double");
+static_assert(formatting::check<int>("{:.2}", 5) 
+              == formatting::BAD_TYPE, "precision accepted for an int");
+static_assert(formatting::check<const char*>("{:+}", 4) 
+              == formatting::BAD_TYPE, "sign accepted for a string");
+static_assert(formatting::check<int>("{", 1) 
+              == formatting::UNMATCHED_BRACE, "lone { accepted");
+static_assert(formatting::check<>("a}b", 3) 
+              == formatting::UNMATCHED_BRACE, "lone } accepted");
+static_assert(formatting::check<>("{{}}", 4) 
+              == formatting::OK, "escaped braces rejected");
+static_assert(formatting::check<int>("{0}", 3) 
+              == formatting::INDEXED_FIELD, "numbered field accepted");
+static_assert(formatting::check<int>("{:>8.}", 6) 
+              == formatting::BAD_SPEC, "bad spec accepted");
+
+/*
+ * a type that is written with its operator<<()
+ */
+struct Point { 
+    int x, y; 
+};
+std::ostream& operator<<(std::ostream& os, const Point& p) {
+    return os << '(' << p.x << ", " << p.y << ')';
+}
+
+/*
+ * a type with its own formatting that counts how often it is formatted
+ */
+struct Counted { 
+    mutable int formatted; 
+};
+
+enum Color { RED, GREEN };
+
+namespace lsst { namespace pex { namespace logging {
+template <>
+struct FormatValue<Counted> {
+    static void format(FormatBuffer& out, const Counted& c, 
+                       const FormatSpec& spec) 
+    {
+        ++c.formatted;
+        out.append(spec.type == 'v' ? "verbose" : "counted", 7);
+    }
+};
+}}}
+
+void testFormatting() {
+    expect(formatToString(LSST_FMT("x={} y={:.3f}"), 3, 2.5), 
+           "x=3 y=2.500", "basic");
+    expect(formatToString(LSST_FMT("{{{}}}"), "a"), "{a}", "braces");
+    expect(formatToString(LSST_FMT("no fields")), "no fields", "literal");
+
+    // integers
+    expect(formatToString(LSST_FMT("{} {} {}"), -42, 0u, LLONG_MIN), 
+           "-42 0 -9223372036854775808", "integers");
+    expect(formatToString(LSST_FMT("{:x} {:#X} {:#o} {:b}"), 255, 255, 8, 5), 
+           "ff 0XFF 0o10 101", "bases");
+    expect(formatToString(LSST_FMT("[{:5}][{:<5}][{:^5}][{:*>5}]"), 
+                          42, 42, 42, 42), 
+           "[   42][42   ][ 42  ][***42]", "integer alignment");
+    expect(formatToString(LSST_FMT("[{:05}][{:+}][{: }][{:+05}]"), 
+                          -42, 42, 42, 42), 
+           "[-0042][+42][ 42][+0042]", "integer sign and zeros");
+    expect(formatToString(LSST_FMT("{:c}{}"), 65, RED), "A0", "char, enum");
+
+    // floating point
+    expect(formatToString(LSST_FMT("{} {} {}"), 0.1, 1e100, -2.0), 
+           "0.1 1e+100 -2", "shortest floats");
+    expect(formatToString(LSST_FMT("{}"), 0.1+0.2), 
+           "0.30000000000000004", "round-trip float");
+    expect(formatToString(LSST_FMT("{:.2e} {:10.3f}|{:<8.1f}|{:08.2f}"), 
+                          12345.678, 3.14159, 2.0, -1.5), 
+           "1.23e+04      3.142|2.0     |-0001.50", "float specs");
+    expect(formatToString(LSST_FMT("{:.1%} {:g}"), 0.25, 1e-5f), 
+           "25.0% 1e-05", "percent, float");
+    assure(formatToString(LSST_FMT("{:.1f}"), 1e300).size() == 303, 
+           "long fixed-point float mangled");
+    
+    // strings, chars, bools and pointers
+    string s("hello");
+    expect(formatToString(LSST_FMT("{} {:>7} {:.3} {:-^9}"), 
+                          s, "abc", s, boost::string_view("mid")), 
+           "hello     abc hel ---mid---", "strings");
+    const char *null = 0;
+    expect(formatToString(LSST_FMT("{}|{:3}|{:d}"), null, 'c', 'A'), 
+           "(null)|c  |65", "null string, chars");
+    expect(formatToString(LSST_FMT("{} {:>6} {:d}"), true, false, true), 
+           "true  false 1", "bools");
+    expect(formatToString(LSST_FMT("{}"), reinterpret_cast<void*>(0x1f)), 
+           "0x1f", "pointer");
+
+    // DateTime and user types
+    DateTime t(1234567890123456789LL, DateTime::UTC);
+    expect(formatToString(LSST_FMT("{} {:n}"), t, t),
+           "2009-02-13T23:31:30.123456Z 1234567890123456789", "DateTime");
+    Point p = { 1, -2 };
+    Counted c = { 0 };
+    expect(formatToString(LSST_FMT("{}|{:>10}|{}|{:v}"), p, p, c, c), 
+           "(1, -2)|   (1, -2)|counted|verbose", "user types");
+
+    // long messages spill from the inline buffer onto the heap
+    string big(2000, 'z');
+    FormatBuffer buf;
+    formatTo(buf, LSST_FMT("<{}>{}"), big, 1);
+    assure(buf.size() == 2003 && buf.str() == "<" + big + ">1", 
+           "long message mangled");
+}
+
+void testLogging() {
+    std::ostringstream out;
+    Log root(Log::INFO);
+    root.addDestination(out, Log::DEBUG, 
+                        shared_ptr<LogFormatter>(new BriefFormatter()));
+    Log log(root, "fmt");
+
+    Counted c = { 0 };
+    log.info(LSST_FMT("x={} y={:.3f} {}"), 3, 1.0/3.0, c);
+    log.log(Log::WARN, LSST_FMT("{:>4}%"), 99);
+    log.logdebug(LSST_FMT("hidden {}"), c);
+    assure(c.formatted == 1, "message formatted though it was not recorded");
+
+    Debug dbg(root, "dbg", 5);
+    dbg.debug<3>(LSST_FMT("level {}"), 3);
+    dbg.debug(9, LSST_FMT("level {}"), c);
+    assure(c.formatted == 1, "debug message formatted though too verbose");
+
+    LogHandle h(root, "handle");
+    h.fatal(LSST_FMT("{}!"), "boom");
+
+    expect(out.str(), 
+           "fmt: x=3 y=0.333 counted\n"
+           "fmt WARNING:   99%\n"
+           "dbg DEBUG: level 3\n"
+           "handle FATAL: boom!\n", "log output");
+}
+
+int main() {
+    try {
+        testFormatting();
+        testLogging();
+    }
+    catch (std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
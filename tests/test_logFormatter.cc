@@ -161,6 +161,49 @@ int main() {
            "Prepended formatting miswrote log message");
     cout << "-------------" << endl;
 
+    // the properties of a shared preamble are rendered once per snapshot, 
+    // and a record's own property is added to the preamble's
+    PropertySet::Ptr snapshot(preamble.deepCopy());
+    LogRecord lr6(1, 5, PropertySet::ConstPtr(snapshot));
+    lr6.addComment("shared preamble");
+    lr6.addProperty("IP", string("222.222.222.222"));
+    LogRecord lr7(lr6);
+    lr7.data();
+    Assert(lr6.getSharedPreamble() && ! lr7.getSharedPreamble(), 
+           "preamble not merged");
+
+    LogFormatter *formatters[] = { notsobrief, nl };
+    for (LogFormatter *frmtr : formatters) {
+        cap.reset(new ostringstream());
+        frmtr->write(cap.get(), lr6);
+        string first = cap->str();
+        cap.reset(new ostringstream());
+        frmtr->write(cap.get(), lr6);
+        msg = cap->str();
+        cout << msg;
+        Assert(msg == first, "cached preamble rendered differently");
+        Assert(msg.find("HOST: localhost.localdomain\n") != string::npos,
+               "cached preamble miswrote HOST");
+        Assert(msg.find("IP: 111.111.111.111\n") != string::npos &&
+               msg.find("IP: 222.222.222.222\n") >
+                   msg.find("IP: 111.111.111.111\n") &&
+               msg.find("222.222.222.222") != string::npos,
+               "record property not added to preamble property");
+        cap.reset(new ostringstream());
+        frmtr->write(cap.get(), lr7);
+        Assert(cap->str() == msg, "cached preamble differs from merged");
+    }
+
+    snapshot = preamble.deepCopy();
+    snapshot->set("HOST", string("otherhost"));
+    LogRecord lr8(1, 5, PropertySet::ConstPtr(snapshot));
+    cap.reset(new ostringstream());
+    notsobrief->write(cap.get(), lr8);
+    msg = cap->str();
+    Assert(msg.find("  HOST: otherhost\n") != string::npos,
+           "new preamble snapshot not rendered");
+    cout << "-------------" << endl;
+
     delete notsobrief;
     delete brief;
     delete nl;
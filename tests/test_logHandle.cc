@@ -0,0 +1,111 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+/**
+ * @file test_logHandle.cc
+ * @brief tests the LogHandle class and LogClientHelper
+ */
+#include "lsst/pex/logging/LogClient.h"
+#include "lsst/pex/logging/LogHandle.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::LogHandle;
+using lsst::pex::logging::LogClientHelper;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+class Source : public LogClientHelper {
+public:
+    Source() : LogClientHelper("source") { }
+    virtual const Log& getLog() const { return _log; }
+    virtual Log& getLog() { return _log; }
+    virtual void setLog(const Log& log) { _log = log; }
+    void measure() { _log.info("measuring"); }
+};
+
+int main() {
+    std::ostringstream out;
+    Log root(Log::INFO);
+    root.addDestination(out, Log::INFO, 
+                        shared_ptr<LogFormatter>(new BriefFormatter()));
+
+    LogHandle h1(root, "pipe.astrom");
+    LogHandle h2(root, "pipe.astrom");
+    assure(h1.getName() == "pipe.astrom", "wrong handle name");
+    assure(&h1.getLog() == &h2.getLog(), "handles with same name not shared");
+
+    LogHandle h3(root, "pipe.phot");
+    assure(&h1.getLog() != &h3.getLog(), "handles with different names shared");
+
+    Log parent(root, "pipe");
+    LogHandle h4(parent, "astrom");
+    assure(h4.getName() == "pipe.astrom", "wrong handle name via child");
+
+    h1.info("handle message");
+    h1.logdebug("suppressed message");
+    h1.infof("formatted %d", 3);
+    assure(out.str() == "pipe.astrom: handle message\npipe.astrom: formatted 3\n", 
+           "unexpected handle output: " + out.str());
+
+    // changing the parent's configuration must not be ignored
+    std::ostringstream out2;
+    root.addDestination(out2, Log::INFO, 
+                        shared_ptr<LogFormatter>(new BriefFormatter()));
+    LogHandle h5(root, "pipe.astrom");
+    assure(&h5.getLog() != &h1.getLog(), "stale interned Log reused");
+    h5.warn("to both");
+    assure(out2.str() == "pipe.astrom WARNING: to both\n", 
+           "new destination not used: " + out2.str());
+
+    // LogClientHelper subclasses each keep their own Log
+    Source s1, s2;
+    assure(&s1.getLog() != &s2.getLog(), "clients share their Log");
+    assure(s1.getLog().getName() == "source", "wrong client log name");
+    s2.getLog().addLabel("second");
+    assure(s1.getLog().getSharedPreamble() != s2.getLog().getSharedPreamble(),
+           "client configuration leaked to another client");
+    s1.setLog(root);
+    assure(s1.getLog().getName() == "", "setLog did not take effect");
+
+    // names no longer in use are swept out without disturbing live ones
+    for(int i=0; i < 1000; ++i) {
+        std::ostringstream name;
+        name << "obj" << i;
+        LogHandle tmp(root, name.str());
+    }
+    LogHandle h6(root, "pipe.astrom");
+    assure(&h6.getLog() == &h5.getLog(), "live handle lost in sweep");
+    LogHandle h7(root, "obj1");
+    assure(h7.getName() == "obj1", "wrong name after sweep");
+
+    std::cout << "LogHandle tests passed" << std::endl;
+}
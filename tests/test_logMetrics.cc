@@ -0,0 +1,236 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+ 
+/**
+ * @file test_logMetrics.cc
+ * @brief tests the logging system's self-monitoring counters
+ */
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/LogMetrics.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::LogMetrics;
+using lsst::pex::logging::LogDestination;
+using lsst::pex::logging::DestinationMetrics;
+using lsst::pex::logging::LatencyHistogram;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+namespace threshold = lsst::pex::logging::threshold;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+/*
+ * a stream buffer that stalls whenever it is flushed while stalling
+ * is set
+ */
+class StallingBuf : public std::stringbuf {
+public:
+    StallingBuf() : stall(false) { }
+    bool stall;
+protected:
+    virtual int sync() {
+        if (stall) 
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return std::stringbuf::sync();
+    }
+};
+
+void testHistogram() {
+    // buckets are contiguous and bound the relative error
+    std::uint64_t limit = 0;
+    for(int b=0; b < LatencyHistogram::NBUCKETS; ++b) {
+        std::uint64_t next = LatencyHistogram::bucketLimit(b);
+        assure(b == 0 || next > limit, "bucket limits not increasing");
+        assure(LatencyHistogram::bucketFor(limit+1) == b || b == 0, 
+               "bucket boundaries inconsistent");
+        assure(LatencyHistogram::bucketFor(next) == b, 
+               "bucket limit outside bucket");
+        limit = next;
+    }
+    assure(LatencyHistogram::bucketFor(~std::uint64_t(0)) == 
+           LatencyHistogram::NBUCKETS - 1, "huge latency not clamped");
+
+    LatencyHistogram h(4);
+    assure(h.getCount() == 0 && h.getPercentile(50) == 0, "not empty");
+    for(std::uint64_t v=1; v <= 1000; ++v) h.record(v * 1000);
+    assure(h.getCount() == 1000, "wrong count");
+    assure(h.getMax() == 1000000, "wrong max");
+    std::uint64_t p50 = h.getPercentile(50), p99 = h.getPercentile(99);
+    assure(p50 >= 500000 && p50 <= 500000 + 500000/16, "inaccurate p50");
+    assure(p99 >= 990000 && p99 <= 1000000, "inaccurate p99");
+    assure(h.getPercentile(100) == 1000000, "p100 is not the max");
+
+    // sharded recording from several threads, and merging
+    std::vector<std::thread> threads;
+    for(int i=0; i < 4; ++i) {
+        threads.push_back(std::thread([&h]{
+            for(int j=0; j < 1000; ++j) h.record(100);
+        }));
+    }
+    for(std::size_t i=0; i < threads.size(); ++i) threads[i].join();
+    assure(h.getCount() == 5000, "counts lost across shards");
+    LatencyHistogram merged;
+    merged.merge(h);
+    merged.merge(h);
+    assure(merged.getCount() == 10000, "merge lost counts");
+    assure(merged.getPercentile(50) == 
+           LatencyHistogram::bucketLimit(LatencyHistogram::bucketFor(100)),
+           "merged percentile wrong");
+}
+
+int main() {
+    testHistogram();
+
+    std::ostringstream out;
+    shared_ptr<LogFormatter> brief(new BriefFormatter());
+    shared_ptr<LogDestination> dest(new LogDestination(&out, brief));
+    dest->setLabel("out");
+    Log root(Log::INFO);
+    root.addDestination(dest);
+    Log pipe(root, "pipe");
+
+    // threshold checks
+    std::uint64_t skipped = LogMetrics::get(LogMetrics::SKIPPED);
+    std::uint64_t lookups = LogMetrics::get(LogMetrics::LOOKUPS);
+    std::uint64_t sent = LogMetrics::get(LogMetrics::SENT);
+    for(int i=0; i < 10; ++i) pipe.logdebug("hidden");
+    assure(LogMetrics::get(LogMetrics::SKIPPED) == skipped + 10, 
+           "rejections not counted");
+    assure(LogMetrics::get(LogMetrics::LOOKUPS) == lookups, 
+           "rejection needed a lookup");
+    pipe.info("shown");
+    assure(LogMetrics::get(LogMetrics::LOOKUPS) > lookups, 
+           "lookup not counted");
+    assure(LogMetrics::get(LogMetrics::SENT) == sent + 1, 
+           "sent record not counted");
+    double hitRate = LogMetrics::getThresholdHitRate();
+    assure(hitRate > 0.0 && hitRate < 1.0, "unexpected hit rate");
+
+    // counts from exited threads are kept
+    skipped = LogMetrics::get(LogMetrics::SKIPPED);
+    std::vector<std::thread> threads;
+    for(int i=0; i < 4; ++i) {
+        threads.push_back(std::thread([&pipe]{
+            for(int j=0; j < 1000; ++j) pipe.logdebug("hidden");
+        }));
+    }
+    for(std::size_t i=0; i < threads.size(); ++i) threads[i].join();
+    assure(LogMetrics::get(LogMetrics::SKIPPED) == skipped + 4000, 
+           "counts from other threads lost");
+
+    // destination counters
+    DestinationMetrics m = dest->getMetrics();
+    assure(m.label == "out", "wrong label");
+    assure(m.records == 1, "record not counted");
+    assure(m.bytes == 0, "bytes counted without timing");
+
+    assure(! LogMetrics::isTiming(), "timing on by default");
+    LogMetrics::setTiming(true);
+    out.str("");
+    pipe.info("timed");
+    LogMetrics::setTiming(false);
+    assure(out.str() == "pipe: timed\n", "timed record garbled: " + out.str());
+    m = dest->getMetrics();
+    assure(m.records == 2, "timed record not counted");
+    assure(m.bytes == out.str().length(), "wrong byte count");
+    assure(m.formatNanos > 0 && m.writeNanos > 0, "record not timed");
+
+    bool found = false;
+    std::vector<DestinationMetrics> all = LogMetrics::getDestinationMetrics();
+    for(std::size_t i=0; i < all.size(); ++i) 
+        if (all[i].id == m.id) found = (all[i].records == 2);
+    assure(found, "destination not registered");
+
+    // queue depth and drops
+    dest->startWriter(1, LogDestination::DROP_NEWEST);
+    for(int i=0; i < 100; ++i) pipe.info("queued");
+    dest->stopWriter();
+    m = dest->getMetrics();
+    assure(m.maxQueued == 1, "queue depth not tracked");
+    assure(m.queued == 0, "queue not emptied");
+    // every record was written or dropped, plus a summary of the drops
+    assure(m.records + m.dropped == 2 + 100 + (m.dropped > 0 ? 1 : 0), 
+           "records and drops don't add up");
+
+    // reports
+    std::ostringstream stats;
+    Log::getDefaultLog().addDestination(stats, threshold::PASS_ALL, brief);
+    LogMetrics::report();
+    assure(stats.str().find("logging.stats: sent ") == 0, 
+           "report not logged: " + stats.str());
+    assure(stats.str().find("(out)") != string::npos, 
+           "destination not reported: " + stats.str());
+
+    // latency histograms attribute a stall to its destination
+    StallingBuf stallbuf;
+    std::ostream stallstrm(&stallbuf);
+    shared_ptr<LogDestination> slow(new LogDestination(&stallstrm, brief));
+    slow->setLabel("slow");
+    Log stalled(root, "stalled");
+    stalled.addDestination(slow);
+    assure(dest->getWriteLatency().getCount() == 0, 
+           "latency recorded while off");
+    LogMetrics::setLatencyRecording(true);
+    for(int i=0; i < 100; ++i) stalled.info("fast");
+    stallbuf.stall = true;
+    stalled.info("stall");
+    stallbuf.stall = false;
+    LogMetrics::setLatencyRecording(false);
+    stalled.info("unrecorded");
+
+    LatencyHistogram fast = dest->getWriteLatency();
+    LatencyHistogram slowest = slow->getWriteLatency();
+    LatencyHistogram sends = LogMetrics::getSendLatency();
+    assure(fast.getCount() == 101 && slowest.getCount() == 101, 
+           "wrong number of writes recorded");
+    assure(slowest.getMax() >= 20000000, "stall not recorded");
+    assure(fast.getMax() < 20000000, "stall blamed on wrong destination");
+    assure(slowest.getPercentile(50) < 20000000, "stall dominates median");
+    assure(sends.getCount() == 101 && sends.getMax() >= 20000000, 
+           "send latency not recorded");
+    assure(LogMetrics::getWriteLatency(slow->getMetrics().id).getCount() == 
+           101, "latency not found by id");
+    std::cout << "slow destination: ";
+    slowest.write(std::cout);
+    std::cout << std::endl;
+
+    // the cost of counting a rejected message
+    const int n = 10000000;
+    std::chrono::steady_clock::time_point start = 
+        std::chrono::steady_clock::now();
+    for(int i=0; i < n; ++i) pipe.logdebug("hidden");
+    double nanos = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / n;
+    std::cout << "rejected message: " << nanos << " nsec" << std::endl;
+}
@@ -0,0 +1,206 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+ 
+ 
+/**
+ * @file test_logReader.cc
+ * @brief tests the reading back of log files
+ */
+#include "lsst/pex/logging/LogReader.h"
+#include "lsst/pex/logging/LogFormatter.h"
+#include "lsst/pex/logging/LogRecord.h"
+#include "lsst/pex/exceptions.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using lsst::pex::logging::LogReader;
+using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::NetLoggerFormatter;
+using lsst::pex::logging::PrependedFormatter;
+using std::string;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+string tempPath() {
+    char path[] = "/tmp/test_logReaderXXXXXX";
+    int fd = mkstemp(path);
+    assure(fd >= 0, "unable to create a temporary file");
+    close(fd);
+    return path;
+}
+
+/*
+ * write n records of the sort a pipeline would
+ */
+void writeLog(const string& path, LogFormatter& fmtr, int n) {
+    std::ofstream out(path.c_str());
+    for(int i=0; i < n; ++i) {
+        int level = (i % 4 == 0) ? 10 : ((i % 4 == 1) ? -10 : 0);
+        LogRecord rec(-20, level);
+        rec.addProperty("LOG", string("pipe.stage"));
+        rec.addProperty("LABEL", string("{'patch': 0}"));
+        rec.addComment("step " + std::to_string(i));
+        if (i % 10 == 0) rec.addComment("Traceback:\n  frame 1\\2");
+        rec.addProperty("visit", i);
+        rec.addProperty("seeing", 0.5 + i);
+        rec.addProperty("done", i % 2 == 0);
+        if (i % 3 == 0) rec.addProperty("ccd", string("R22 S11"));
+        fmtr.write(&out, rec);
+    }
+}
+
+void assureSame(const LogReader::Columns& a, const LogReader::Columns& b) {
+    assure(a.size() == b.size(), "different columns");
+    for (auto const& col : a) {
+        auto it = b.find(col.first);
+        assure(it != b.end(), "missing column " + col.first);
+        const LogReader::Column& other = it->second;
+        assure(col.second.getType() == other.getType() &&
+               col.second.getPresent() == other.getPresent() &&
+               col.second.getIntegers() == other.getIntegers() && 
+               col.second.getStrings() == other.getStrings() && 
+               col.second.getFloats().size() == other.getFloats().size(),
+               "different column " + col.first);
+        for (std::size_t i=0; i < other.getFloats().size(); ++i) {
+            double x = col.second.getFloats()[i], y = other.getFloats()[i];
+            assure(x == y || (std::isnan(x) && std::isnan(y)), 
+                   "different value in " + col.first);
+        }
+    }
+}
+
+int main() {
+    const int n = 2000;
+
+    // NetLogger records come back with their types
+    string path = tempPath();
+    NetLoggerFormatter netlogger;
+    writeLog(path, netlogger, n);
+    {
+        LogReader reader(path);
+        int count = 0;
+        for (LogReader::iterator it = reader.begin(); it != reader.end(); 
+             ++it, ++count) 
+        {
+            const LogReader::Field *f = it->find("visit");
+            assure(f && f->getType() == 'i' && f->asInteger() == count, 
+                   "wrong visit");
+            assure(it->find("LEVEL")->asInteger() == 
+                   ((count % 4 == 0) ? 10 : ((count % 4 == 1) ? -10 : 0)),
+                   "wrong level");
+            assure(it->find("seeing")->asFloat() == 0.5 + count, 
+                   "wrong seeing");
+            assure(it->find("done")->asBool() == (count % 2 == 0), 
+                   "wrong flag");
+            assure((it->find("ccd") != 0) == (count % 3 == 0), 
+                   "wrong optional property");
+            if (count == 10)
+                assure(it->find("COMMENT")->asString() == 
+                       "Traceback:\n  frame 1\\2", "comment not unescaped: " +
+                       it->find("COMMENT")->asString());
+        }
+        assure(count == n, "wrong record count: " + std::to_string(count));
+
+        LogReader::Columns cols = reader.readColumns(1);
+        assure(cols["visit"].getType() == LogReader::Column::INTEGER &&
+               cols["visit"].size() == n && cols["visit"].getIntegers()[7] == 7,
+               "wrong visit column");
+        assure(cols["seeing"].getType() == LogReader::Column::FLOAT &&
+               cols["seeing"].getFloats()[3] == 3.5, "wrong seeing column");
+        assure(cols["done"].getType() == LogReader::Column::BOOL &&
+               cols["done"].getIntegers()[1] == 0, "wrong flag column");
+        assure(cols["TIMESTAMP"].getType() == LogReader::Column::INTEGER, 
+               "wrong TIMESTAMP column");
+        assure(cols["ccd"].getPresent()[3] == 1 && 
+               cols["ccd"].getPresent()[4] == 0 && 
+               cols["ccd"].getStrings()[3] == "R22 S11", 
+               "wrong optional column");
+        assure(cols["COMMENT"].getStrings()[20] == 
+               "step 20\nTraceback:\n  frame 1\\2", 
+               "comments not joined: " + cols["COMMENT"].getStrings()[20]);
+
+        // reading in parallel gives the same columns
+        assureSame(cols, reader.readColumns(4));
+        assureSame(cols, reader.readColumns(7));
+    }
+
+    // Prepended records
+    PrependedFormatter prepended;
+    writeLog(path, prepended, n);
+    {
+        LogReader reader(path, LogReader::PREPENDED);
+        LogReader::Columns cols = reader.readColumns(1);
+        assure(cols["COMMENT"].size() == n, "wrong prepended record count: " +
+               std::to_string(cols["COMMENT"].size()));
+        assure(cols["LEVEL"].getIntegers()[4] == 10 && 
+               cols["LEVEL"].getIntegers()[5] == -10 && 
+               cols["LEVEL"].getIntegers()[6] == 0, "wrong prepended levels");
+        assure(cols["LABEL"].getStrings()[0] == "{'patch': 0}" &&
+               cols["LOG"].getStrings()[0] == "pipe.stage", 
+               "wrong label or log name");
+        assure(cols["COMMENT"].getStrings()[10] == 
+               "step 10\nTraceback:\n  frame 1\\2", 
+               "wrong prepended comment: " + cols["COMMENT"].getStrings()[10]);
+        assure(cols.find("visit") == cols.end(), "unexpected property");
+        assureSame(cols, reader.readColumns(5));
+    }
+
+    // verbose Prepended records also carry their properties
+    PrependedFormatter verbose(true);
+    writeLog(path, verbose, n);
+    {
+        LogReader reader(path, LogReader::PREPENDED);
+        LogReader::Columns cols = reader.readColumns(1);
+        assure(cols["COMMENT"].size() == n, "wrong verbose record count");
+        assure(cols["visit"].getStrings()[9] == "9" && 
+               cols["ccd"].getPresent()[4] == 0, "wrong verbose properties");
+        assure(cols["LEVEL"].getType() == LogReader::Column::INTEGER &&
+               cols["TIMESTAMP"].getType() == LogReader::Column::INTEGER,
+               "wrong verbose LEVEL or TIMESTAMP");
+        assureSame(cols, reader.readColumns(3));
+    }
+
+    // an empty file has no records
+    std::ofstream(path.c_str()).close();
+    {
+        LogReader reader(path);
+        assure(reader.begin() == reader.end(), "records in an empty file");
+        assure(reader.readColumns().empty(), "columns in an empty file");
+    }
+    std::remove(path.c_str());
+
+    try {
+        LogReader reader(path);
+        throw std::runtime_error("missing file opened");
+    } catch (lsst::pex::exceptions::RuntimeError const&) { }
+}
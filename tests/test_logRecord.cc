@@ -22,7 +22,10 @@
  
 #include "lsst/pex/logging/LogRecord.h"
 #include "lsst/daf/base/DateTime.h"
+#include "lsst/pex/exceptions.h"
 #include <iostream>
+#include <thread>
+#include <vector>
 
 using lsst::pex::logging::LogRecord;
 using lsst::daf::base::PropertySet;
@@ -77,6 +80,16 @@ int main() {
     assure(comments.size() == 1, "First record has wrong number of comments");
     assure(! lr2.data().exists("COMMENT"), "2nd quiet record has comments"); 
 
+    boost::string_view view("a viewed comment, trimmed", 16);
+    lr1.addComment(view);
+    lr2.addComment(view);
+    comments = lis.getArray<string>("COMMENT");
+    assure(comments.size() == 2, "string_view comment not added");
+    assure(comments[1] == "a viewed comment", "Wrong string_view comment value");
+    assure(! lr2.data().exists("COMMENT"), "quiet record has viewed comments"); 
+    lr1.data().remove("COMMENT");
+    lr1.addComment(simple);
+
     lr1.addProperty("dpint", 2);
     lr2.addProperty("dpint", 2);
     lr1.addProperty("dpfloat", 2.5);
@@ -119,6 +132,155 @@ int main() {
     }
     cout << endl;
 
+    // a record built from a shared preamble refers to it rather than 
+    // copying it
+    PropertySet::ConstPtr shared(preamble.deepCopy());
+    LogRecord lr4(1, 5, shared);
+    assure(lr4.countParamNames()==6, "wrong initial count via shared preamble");
+    assure(&lr4.propertiesFor("dpint") == shared.get(), 
+           "shared preamble was copied");
+    lr4.addProperty("dpint", 3);
+    std::vector<int> dpints = lr4.propertiesFor("dpint").getArray<int>("dpint");
+    assure(dpints.size() == 2 && dpints[0] == 2 && dpints[1] == 3, 
+           "record property not added to preamble property");
+    assure(shared->valueCount("dpint") == 1, "shared preamble was modified");
+    assure(lr4.data().get<int>("dpint") == 3, "wrong merged value");
+    assure(lr4.data().valueCount("dpint") == 2, "wrong merged value count");
+    bool typeChecked = false;
+    try {
+        lr4.addProperty("dplong", string("five"));
+    } catch (lsst::pex::exceptions::TypeError&) {
+        typeChecked = true;
+    }
+    assure(typeChecked, "value of another type added to preamble property");
+    assure(lr4.data().exists("dplong"), "preamble property lost in merge");
+    assure(lr4.countParamNames()==6, "wrong count after merging preamble");
+
+    // the TIMESTAMP and DATE properties are only created when asked for,
+    // but appear where they always have
+    LogRecord lr5(1, 5, shared);
+    lr5.addComment(simple);
+    names = lr5.paramNames();
+    assure(names.size() == 7 && names[3] == "LEVEL" && 
+           names[4] == "TIMESTAMP" && names[5] == "DATE" && 
+           names[6] == "COMMENT", "wrong property order before merge");
+    assure(&lr5.propertiesFor("DATE") != &lr5.propertiesFor("COMMENT"),
+           "DATE created with the record");
+    long long ns = lr5.propertiesFor("TIMESTAMP").get<DateTime>("TIMESTAMP")
+                                                 .nsecs();
+    string date = lr5.propertiesFor("DATE").get<string>("DATE");
+    LogRecord lr6(lr5);
+    assure(lr6.propertiesFor("DATE").get<string>("DATE") == date, 
+           "copy has a different DATE");
+    names = lr5.data().paramNames(false);
+    assure(names.size() == 7 && names[3] == "LEVEL" && 
+           names[4] == "TIMESTAMP" && names[5] == "DATE" && 
+           names[6] == "COMMENT", "wrong property order after merge");
+    assure(lr5.data().get<string>("DATE") == date && 
+           lr5.data().get<DateTime>("TIMESTAMP").nsecs() == ns &&
+           lr5.data().valueCount("DATE") == 1, "DATE changed by merge");
+
+    // a deleted record's property storage is emptied and reused by the 
+    // next record created in the same thread
+    const PropertySet *storage = 0;
+    {
+        LogRecord lr7(1, 5);
+        lr7.addComment(simple);
+        storage = &lr7.data();
+    }
+    std::size_t pooled = LogRecord::getPoolSize();
+    assure(pooled > 0, "deleted record's storage was not kept");
+    {
+        LogRecord lr8(10, 5);
+        assure(&lr8.data() == storage, "kept storage was not reused");
+        assure(lr8.data().nameCount() == 0, "reused storage not emptied");
+        assure(LogRecord::getPoolSize() == pooled - 1, "wrong pool size");
+    }
+    assure(LogRecord::getPoolSize() == pooled, "storage not returned");
+
+    // reused storage keeps nothing of a hierarchical property
+    {
+        LogRecord lr15(1, 5);
+        lr15.addProperty("stage.name", string("calib"));
+    }
+    {
+        LogRecord lr16(1, 5);
+        assure(! lr16.data().exists("stage"), "reused storage not emptied");
+        lr16.addProperty("stage", 5);
+        assure(lr16.data().get<int>("stage") == 5, "wrong reused property");
+    }
+
+    // a record can be moved without copying its properties
+    {
+        LogRecord lr13(1, 5, shared);
+        lr13.addComment(simple);
+        const PropertySet *own = &lr13.propertiesFor("COMMENT");
+        LogRecord lr14(std::move(lr13));
+        assure(&lr14.propertiesFor("COMMENT") == own && 
+               lr14.getSharedPreamble() == shared, "moved record was copied");
+        assure(lr14.willRecord() && ! lr13.willRecord(), 
+               "wrong record moved from");
+        assure(lr14.countParamNames() == 7, "properties lost in move");
+    }
+
+    // reading a record through its const interface leaves its own 
+    // properties alone, so several threads may read it at once
+    LogRecord lr12(1, 5, shared);
+    lr12.addComment(simple);
+    const LogRecord& clr12 = lr12;
+    std::vector<const PropertySet*> seen(4, 0);
+    std::vector<std::thread> readers;
+    for(int i=0; i < 4; ++i) 
+        readers.emplace_back([&clr12, &seen, i]() {
+            clr12.propertiesFor("DATE");
+            seen[i] = &clr12.data();
+        });
+    for(auto& t : readers) t.join();
+    for(int i=1; i < 4; ++i) 
+        assure(seen[i] == seen[0], "const data() built more than once");
+    assure(seen[0]->exists("dpint") && seen[0]->exists("DATE") && 
+           seen[0]->exists("COMMENT"), "const data() incomplete");
+    assure(clr12.getSharedPreamble() == shared && 
+           &clr12.propertiesFor("dpint") == shared.get(), 
+           "const data() merged the preamble");
+
+    // a change after a const data() shows in the next one
+    lr12.addProperty("dpint", 7);
+    assure(clr12.data().get<int>("dpint") == 7 && 
+           clr12.data().valueCount("dpint") == 2 && 
+           clr12.data().valueCount("COMMENT") == 1, 
+           "change after const data() lost");
+
+    // a record can carry the monotonic clock time, read together with its
+    // timestamp, just after TIMESTAMP and DATE
+    assure(! LogRecord::willStampMonotonic(), "MONOTONIC stamped by default");
+    LogRecord lr9(1, 5, shared);
+    lr9.addComment(simple);
+    assure(lr9.getMonotonic() > 0, "monotonic time not read");
+    assure(! lr9.propertiesFor("TIMESTAMP").exists("MONOTONIC"),
+           "MONOTONIC carried without being asked for");
+    lr9.stampMonotonic();
+    names = lr9.paramNames();
+    assure(names.size() == 8 && names[5] == "DATE" &&
+           names[6] == "MONOTONIC" && names[7] == "COMMENT",
+           "wrong property order with MONOTONIC");
+    assure(lr9.propertiesFor("MONOTONIC").get<long long>("MONOTONIC") ==
+           lr9.getMonotonic(), "wrong MONOTONIC value");
+    names = lr9.data().paramNames(false);
+    assure(names.size() == 8 && names[6] == "MONOTONIC" &&
+           lr9.data().get<long long>("MONOTONIC") == lr9.getMonotonic(),
+           "MONOTONIC lost in merge");
+
+    LogRecord::setMonotonicStamps(true);
+    LogRecord lr10(1, 5);
+    LogRecord::setMonotonicStamps(false);
+    assure(lr10.data().exists("MONOTONIC") &&
+           lr10.getMonotonic() >= lr9.getMonotonic(),
+           "MONOTONIC not stamped on request");
+    LogRecord lr11(10, 5);
+    assure(lr11.getMonotonic() == 0 && ! lr11.data().exists("MONOTONIC"),
+           "unrecorded record read the clocks");
+
     cout << "Third record's properties:" << endl;
     cout << "  LEVEL: " << lr3.data().get<int>("LEVEL") << endl;
     cout << "  TIMESTAMP: " << lr3.data().get<DateTime>("TIMESTAMP").nsecs() << endl;
@@ -0,0 +1,177 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+ 
+/**
+ * @file test_recordFilter.cc
+ * @brief tests filtering records by content with RecordFilter
+ */
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/RecordFilter.h"
+#include "lsst/pex/exceptions.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <atomic>
+#include <thread>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::RecordFilter;
+using lsst::pex::logging::LogDestination;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+using lsst::pex::logging::prop;
+using lsst::daf::base::PropertySet;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+void assureBad(const string& expr) {
+    try {
+        RecordFilter filter(expr);
+    }
+    catch (lsst::pex::exceptions::InvalidParameterError& ex) {
+        return;
+    }
+    throw std::runtime_error("bad filter accepted: " + expr);
+}
+
+int main() {
+    PropertySet::Ptr preamble(new PropertySet());
+    preamble->set<string>("LOG", "pipe.io.butler");
+
+    LogRecord warn(Log::INFO, Log::WARN, preamble);
+    warn.addComment("disk nearly full");
+
+    LogRecord info(Log::INFO, Log::INFO, preamble);
+    info.addComment("read exposure");
+    info.addComment("cached");
+    info.addProperty("visit", 1234);
+    info.addProperty("ccd", 7L);
+    info.addProperty("seeing", 0.8);
+    info.addProperty("filter", string("r"));
+
+    PropertySet::Ptr other(new PropertySet());
+    other->set<string>("LOG", "pipe.astrom");
+    LogRecord dbg(Log::DEBUG, Log::DEBUG, other);
+    dbg.addComment("iterating");
+    dbg.addProperty("visit", 1234);
+
+    RecordFilter example("LEVEL>=WARN or (LOG startswith 'pipe.io' and "
+                         "PROPERTY visit==1234)");
+    assure(example.getExpression().find("pipe.io") != string::npos, 
+           "expression not kept");
+    assure(example.matches(warn), "example rejects warning");
+    assure(example.matches(info), "example rejects visit 1234 from pipe.io");
+    assure(! example.matches(dbg), "example passes pipe.astrom debug");
+
+    assure(RecordFilter("LEVEL == 0").matches(info), "numeric level");
+    assure(RecordFilter("LEVEL < INFO").matches(dbg), "level names");
+    assure(RecordFilter("LOG == \"pipe.astrom\"").matches(dbg), "LOG ==");
+    assure(RecordFilter("LOG endswith 'butler'").matches(info), "endswith");
+    assure(RecordFilter("COMMENT contains 'full'").matches(warn), 
+           "contains");
+    assure(RecordFilter("COMMENT == 'cached'").matches(info), 
+           "second comment not tested");
+    assure(RecordFilter("ccd >= 7 && seeing < 1").matches(info), 
+           "property without PROPERTY");
+    assure(RecordFilter("filter == 'r' and not filter != 'r'").matches(info),
+           "string property");
+    assure(! RecordFilter("filter == 3").matches(info), 
+           "string property equals a number");
+    assure(! RecordFilter("visit == '1234'").matches(info), 
+           "numeric property equals a string");
+    assure(! RecordFilter("missing != 3").matches(info), 
+           "comparison with missing property is true");
+    assure(RecordFilter("PROPERTY seeing exists").matches(info) && 
+           ! RecordFilter("seeing exists").matches(dbg), "exists");
+    assure(RecordFilter("!(LEVEL >= WARN || LEVEL <= DEBUG)").matches(info), 
+           "! and ||");
+    assure(RecordFilter("LEVEL>=WARN or LEVEL==INFO and ccd==8").matches(warn)
+           && ! RecordFilter("LEVEL>=WARN or LEVEL==INFO and ccd==8")
+                     .matches(info), "and binds tighter than or");
+
+    assureBad("");
+    assureBad("LEVEL >= LOUD");
+    assureBad("LOG == 3");
+    assureBad("(LEVEL > 1");
+    assureBad("LEVEL > 1 LEVEL < 2");
+    assureBad("visit startswith 12");
+    assureBad("LOG == 'pipe");
+    assureBad("LEVEL");
+
+    // filter records sent through a destination
+    std::ostringstream fout;
+    shared_ptr<LogDestination> 
+        dest(new LogDestination(&fout, 
+                                shared_ptr<LogFormatter>(new BriefFormatter())));
+    dest->setFilter(example.getExpression());
+    Log filtered(Log::DEBUG, "pipe");
+    filtered.addDestination(dest);
+    Log fio(filtered, "io"), fastrom(filtered, "astrom");
+    fio.info("kept", prop("visit", 1234));
+    fio.info("other visit", prop("visit", 99));
+    fastrom.info("wrong log", prop("visit", 1234));
+    fastrom.warn("loud");
+    assure(fout.str() == "pipe.io: kept\npipe.astrom WARNING: loud\n", 
+           "wrong filtered output: " + fout.str());
+    dest->clearFilter();
+    fastrom.info("unfiltered");
+    assure(fout.str().find("unfiltered") != string::npos, 
+           "filter not cleared");
+
+    // the filter can be replaced while another thread is writing
+    std::atomic<bool> stop(false);
+    std::thread writer([&fastrom, &stop]{
+        while (! stop) fastrom.info("busy", prop("visit", 1234));
+    });
+    shared_ptr<const RecordFilter> 
+        visits(new RecordFilter("visit == 1234"));
+    for(int i=0; i < 200; ++i) {
+        dest->setFilter(visits);
+        assure(dest->getFilter() == visits, "filter not set");
+        dest->setFilter("LEVEL >= 10");
+        dest->clearFilter();
+    }
+    stop = true;
+    writer.join();
+
+    // the cost of filtering a record
+    typedef std::chrono::steady_clock clock;
+    const int n = 200000;
+    int passed = 0;
+    clock::time_point start = clock::now();
+    for(int i=0; i < n; ++i) 
+        if (example.matches((i % 2) ? info : dbg)) ++passed;
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - 
+                                                          start).count();
+    assure(passed == n/2, "wrong number passed in timing loop");
+    std::cout << "filter cost: " << ns/n << " ns per record" << std::endl;
+
+    return 0;
+}
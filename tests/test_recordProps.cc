@@ -0,0 +1,110 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+ 
+/**
+ * @file test_recordProps.cc
+ * @brief tests sending messages with several properties in a single call
+ */
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/LogHandle.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::LogRec;
+using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::LogHandle;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::Prop;
+using lsst::pex::logging::PropRef;
+using lsst::pex::logging::prop;
+using lsst::pex::logging::IsRecordProperty;
+using lsst::daf::base::PropertySet;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+static_assert(IsRecordProperty<Prop<int> >::value, "Prop not a property");
+static_assert(IsRecordProperty<PropRef<double> >::value, 
+              "PropRef not a property");
+static_assert(! IsRecordProperty<string>::value, "string is a property");
+
+/*
+ * a formatter that keeps a copy of each record's properties
+ */
+class Keeper : public LogFormatter {
+public:
+    virtual void write(std::ostream *strm, const LogRecord& rec) {
+        kept.push_back(rec.getProperties().deepCopy());
+    }
+    std::vector<PropertySet::Ptr> kept;
+};
+
+int main() {
+    std::ostringstream out;
+    shared_ptr<Keeper> keeper(new Keeper());
+    Log root(Log::INFO);
+    root.addDestination(out, Log::DEBUG, keeper);
+    Log log(root, "props");
+
+    double flux = 12.5;
+    int ccd = 7;
+    string band("r");
+    log.info("measured source", 
+             prop("flux", flux), Prop<int>("ccd", ccd), prop("band", band));
+    log.log(Log::WARN, string("odd source"), prop("x", 3), prop("y", 4.0));
+    log.logdebug("rejected", prop("flux", flux));
+    LogHandle(root, "handle").fatal("handled", prop("ccd", ccd));
+    LogRec(log, Log::INFO) << "streamed" << prop("ccd", ccd) << LogRec::endr;
+
+    assure(keeper->kept.size() == 4, "wrong number of records sent");
+
+    PropertySet::Ptr rec = keeper->kept[0];
+    assure(rec->get<string>("COMMENT") == "measured source", "wrong comment");
+    assure(rec->get<double>("flux") == 12.5, "wrong flux");
+    assure(rec->get<int>("ccd") == 7, "wrong ccd");
+    assure(rec->get<string>("band") == "r", "wrong band");
+    assure(rec->get<int>("LEVEL") == Log::INFO, "wrong level");
+
+    rec = keeper->kept[1];
+    assure(rec->get<string>("COMMENT") == "odd source", "wrong comment");
+    assure(rec->get<int>("x") == 3 && rec->get<double>("y") == 4.0, 
+           "wrong position");
+    assure(rec->get<int>("LEVEL") == Log::WARN, "wrong level");
+
+    rec = keeper->kept[2];
+    assure(rec->get<string>("COMMENT") == "handled", "wrong comment");
+    assure(rec->get<int>("ccd") == 7, "wrong ccd from handle");
+
+    rec = keeper->kept[3];
+    assure(rec->get<string>("COMMENT") == "streamed", "wrong comment");
+    assure(rec->get<int>("ccd") == 7, "wrong streamed ccd");
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+/**
+ * @file test_scopedThreshold.cc
+ * @brief tests thread-local thresholds set via ScopedThreshold
+ */
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/logging/ScopedThreshold.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::ScopedThreshold;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+namespace threshold = lsst::pex::logging::threshold;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+int main() {
+    std::ostringstream out;
+    Log root(Log::INFO);
+    root.addDestination(out, threshold::PASS_ALL, 
+                        shared_ptr<LogFormatter>(new BriefFormatter()));
+    Log astrom(root, "pipe.astrom");
+    Log fit(astrom, "fit");
+    Log phot(root, "pipe.phot");
+
+    assure(! ScopedThreshold::isActive(), "scope active at start");
+    astrom.logdebug("hidden");
+    {
+        ScopedThreshold verbose("pipe.astrom", Log::DEBUG);
+        assure(ScopedThreshold::isActive(), "scope not active");
+        assure(astrom.getThreshold() == Log::DEBUG, "scope not applied");
+        assure(fit.getThreshold() == Log::DEBUG, 
+               "scope not applied to descendant");
+        assure(phot.getThreshold() == Log::INFO, "scope applied to sibling");
+
+        astrom.logdebug("shown");
+        fit.logdebug("shown too");
+        phot.logdebug("hidden");
+
+        // other threads are not affected
+        std::thread other([&astrom]() { 
+            assure(astrom.getThreshold() == Log::INFO, 
+                   "scope leaked to another thread");
+            astrom.logdebug("hidden in thread"); 
+        });
+        other.join();
+
+        {
+            ScopedThreshold quiet("pipe.astrom.fit", Log::WARN);
+            assure(fit.getThreshold() == Log::WARN, 
+                   "inner scope does not win");
+            fit.info("hidden");
+        }
+        assure(fit.getThreshold() == Log::DEBUG, "inner scope not undone");
+    }
+    assure(! ScopedThreshold::isActive(), "scope active at end");
+    assure(astrom.getThreshold() == Log::INFO, "scope not undone");
+    astrom.logdebug("hidden");
+
+    assure(out.str() == 
+           "pipe.astrom DEBUG: shown\npipe.astrom.fit DEBUG: shown too\n", 
+           "unexpected output: " + out.str());
+
+    std::cout << "ScopedThreshold tests passed" << std::endl;
+}
@@ -0,0 +1,142 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+ 
+/**
+ * @file test_textScan.cc
+ * @brief tests the treatment of line breaks and control characters in 
+ * the text of records
+ */
+#include "lsst/pex/logging/TextScan.h"
+#include "lsst/pex/logging/LogFormatter.h"
+#include "lsst/pex/logging/LogRecord.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <chrono>
+
+using lsst::pex::logging::findSpecial;
+using lsst::pex::logging::writeIndented;
+using lsst::pex::logging::writeEscaped;
+using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::BriefFormatter;
+using lsst::pex::logging::IndentedFormatter;
+using lsst::pex::logging::NetLoggerFormatter;
+using std::string;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+string indented(const string& text, const string& indent) {
+    std::ostringstream out;
+    writeIndented(&out, text, indent);
+    return out.str();
+}
+
+string escaped(const string& text) {
+    std::ostringstream out;
+    writeEscaped(&out, text);
+    return out.str();
+}
+
+int main() {
+
+    // a special character is found at every offset, whatever the 
+    // alignment of the text
+    string plain(100, 'x');
+    plain[37] = '\t';
+    const char specials[] = { '\n', '\r', '\x01', '\x1f', '\x7f', '\0' };
+    for(char c : specials) {
+        for(std::size_t start=0; start < 8; ++start) {
+            for(std::size_t at=start; at < plain.size(); ++at) {
+                string text(plain);
+                text[at] = c;
+                const char *begin = text.data() + start;
+                const char *end = text.data() + text.size();
+                assure(findSpecial(begin, end) == text.data() + at, 
+                       "special character missed");
+            }
+        }
+    }
+    const char *end = plain.data() + plain.size();
+    assure(findSpecial(plain.data(), end) == end, 
+           "tab or plain character found");
+    assure(findSpecial(plain.data(), end, 'x') == plain.data(), 
+           "delimiter missed");
+    string high(40, '\xe9');
+    assure(findSpecial(high.data(), high.data()+high.size()) == 
+           high.data()+high.size(), "byte above 0x7f found");
+
+    assure(indented("one line", "  ") == "one line", "plain text changed");
+    assure(indented("a\nb\r\nc", "  ") == "a\n  b\n  c", 
+           "continuation lines not indented");
+    assure(indented("bell\x07\r", "  ") == "bell\\x07\\x0d", 
+           "control characters not escaped");
+    assure(escaped("a\nb\r\\c\x01\td") == "a\\nb\\r\\\\c\\x01\td", 
+           "wrong escaping");
+
+    // formatters keep multi-line comments within their records
+    LogRecord rec(0, 0);
+    rec.addProperty("LOG", string("app"));
+    rec.addComment("Traceback:\n  frame 1\n  frame 2");
+    rec.addProperty("table", string("a b\n1 2"));
+
+    std::ostringstream out;
+    BriefFormatter brief(true);
+    brief.write(&out, rec);
+    assure(out.str().find("app: Traceback:\n      frame 1\n      frame 2\n")
+           == 0, "brief comment not indented: " + out.str());
+    assure(out.str().find("  table: a b\n    1 2\n") != string::npos,
+           "brief value not indented: " + out.str());
+
+    out.str("");
+    IndentedFormatter indentfmt;
+    LogRecord debugrec(-10, -2);
+    debugrec.addProperty("LOG", string("app"));
+    debugrec.addComment("one\ntwo");
+    indentfmt.write(&out, debugrec);
+    assure(out.str() == "  app DEBUG: one\n      two\n", 
+           "indented comment not indented: " + out.str());
+
+    out.str("");
+    NetLoggerFormatter netlogger;
+    netlogger.write(&out, rec);
+    assure(out.str().find("s COMMENT: Traceback:\\n  frame 1\\n  frame 2\n") 
+           != string::npos, "netlogger comment not escaped: " + out.str());
+    assure(out.str().find("s table: a b\\n1 2\n") != string::npos, 
+           "netlogger value not escaped: " + out.str());
+
+    // a multi-KB comment without special characters is scanned quickly
+    string blob(64*1024, 'y');
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    const char *found = 0;
+    for(int i=0; i < 1000; ++i) 
+        found = findSpecial(blob.data(), blob.data() + blob.size());
+    double secs = std::chrono::duration<double>(clock::now() - start).count();
+    assure(found == blob.data() + blob.size(), "blob scanned wrongly");
+    std::cout << "scanned " << 1000.0 * blob.size() / secs / 1.0e9 
+              << " GB/s" << std::endl;
+}
@@ -26,6 +26,7 @@
 
 #include "lsst/pex/logging/threshold/Memory.h"
 #include "lsst/pex/logging/LogRecord.h"
+#include "lsst/pex/logging/ScreenLog.h"
 #include <iostream>
 #include <sstream>
 
@@ -44,6 +45,8 @@ void tattle(bool mustBeTrue, const string& failureMsg, int line) {
 }
 
 using lsst::pex::logging::LogRecord;
+using lsst::pex::logging::Log;
+using lsst::pex::logging::ScreenLog;
 namespace Threshold = lsst::pex::logging::threshold;
 
 int main() {
@@ -70,5 +73,30 @@ int main() {
     Assert(mem.getThresholdFor("valley.of.the") == -11, 
            "wrong new inherited threshold");
 
+    Assert(mem.getLowestThreshold() == -11, "wrong lowest threshold");
+    Assert(! mem.mayPass(-12), "message below watermark passes");
+    mem.setThresholdFor("valley.of", 3);
+    Assert(mem.getLowestThreshold() == -2, 
+           "lowest threshold not raised with its source");
+    mem.setThresholdFor("valley.of.the.dolls", Threshold::INHERIT);
+    Assert(mem.getLowestThreshold() == 3, 
+           "lowest threshold not raised on reset");
+    mem.setThresholdFor("valley.of.the.dolls", -2);
     mem.printThresholds(cout);
+
+    mem.forgetAllNames();
+    Assert(mem.getLowestThreshold() == 5, 
+           "lowest threshold not reset with names");
+
+    // a Log's own threshold still counts when the shared tree forgets it
+    // or another Log of the same name raises it
+    ScreenLog root(true, Log::INFO);
+    Log child(root, "child", Log::DEBUG);
+    root.reset();
+    Assert(child.getThreshold() == Log::DEBUG, "child threshold lost");
+    Assert(child.sends(Log::DEBUG), "child rejects under its threshold");
+    Log child2(child);
+    child2.setThreshold(Log::WARN);
+    Assert(child.sends(Log::DEBUG), "copy's threshold rejects original's");
+    Assert(! child2.sends(Log::INFO), "copy passes below its threshold");
 }
@@ -0,0 +1,132 @@
+/* 
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ * 
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the LSST License Statement and 
+ * the GNU General Public License along with this program.  If not, 
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+ 
+/**
+ * @file test_uringFileDest.cc
+ * @brief tests the UringFileDestination class and compares its speed 
+ * with FileDestination
+ */
+#include "lsst/pex/logging/UringFileDestination.h"
+#include "lsst/pex/logging/FileDestination.h"
+#include "lsst/pex/logging/Log.h"
+#include "lsst/pex/exceptions.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/time.h>
+
+using lsst::pex::logging::Log;
+using lsst::pex::logging::LogDestination;
+using lsst::pex::logging::FileDestination;
+using lsst::pex::logging::UringFileDestination;
+using lsst::pex::logging::LogFormatter;
+using lsst::pex::logging::BriefFormatter;
+using std::string;
+using std::shared_ptr;
+
+void assure(bool mustBeTrue, const string& failureMsg) {
+    if (! mustBeTrue)
+        throw std::runtime_error(failureMsg);
+}
+
+string slurp(const string& path) {
+    std::ifstream in(path.c_str());
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+long now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+/*
+ * log n messages to a destination and return the time taken in usecs
+ */
+long logMessages(const shared_ptr<LogDestination>& dest, int n) {
+    Log log(Log::INFO, "bench");
+    log.addDestination(dest);
+    long t0 = now();
+    for(int i=0; i < n; ++i) 
+        log.infof("message %d of a steady stream of log records", i);
+    return now() - t0;
+}
+
+int main() {
+    const int n = 20000;
+    string upath("tests/testUringFileDestination-out.txt");
+    string fpath("tests/testFileDestination-bench.txt");
+    shared_ptr<LogFormatter> brief(new BriefFormatter());
+
+    long ut, ft;
+    bool uring;
+    {
+        shared_ptr<UringFileDestination> 
+            udest(new UringFileDestination(upath, brief, 0, true, 4096, 4));
+        uring = udest->usesUring();
+        ut = logMessages(udest, n);
+        udest->flush();
+    }
+    {
+        shared_ptr<LogDestination> 
+            fdest(new FileDestination(fpath, brief, 0, true));
+        ft = logMessages(fdest, n);
+    }
+
+    string uout = slurp(upath), fout = slurp(fpath);
+    assure(uout.length() > 0, "nothing written");
+    assure(uout == fout, "io_uring output differs from FileDestination's");
+
+    // appending continues where the file left off
+    {
+        shared_ptr<UringFileDestination> 
+            udest(new UringFileDestination(upath, brief));
+        Log log(Log::INFO, "bench");
+        log.addDestination(udest);
+        log.info("appended");
+    }
+    assure(slurp(upath) == uout + "bench: appended\n", "append failed");
+
+    // a write that cannot be completed is reported by flush()
+    {
+        shared_ptr<UringFileDestination> 
+            udest(new UringFileDestination(string("/dev/full"), brief));
+        Log log(Log::INFO, "bench");
+        log.addDestination(udest);
+        log.info("lost");
+        bool failed = false;
+        try {
+            udest->flush();
+        } catch (lsst::pex::exceptions::RuntimeError&) {
+            failed = true;
+        }
+        assure(failed, "failed write not reported");
+    }
+
+    std::cout << (uring ? "io_uring" : "pwritev fallback") << ": " 
+              << 1.0 * ut / n << " usec per record" << std::endl;
+    std::cout << "FileDestination: " << 1.0 * ft / n << " usec per record" 
+              << std::endl;
+}